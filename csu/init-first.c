@@ -26,6 +26,7 @@
 #include <sys/param.h>
 #include <sys/types.h>
 #include <libc-internal.h>
+#include <rseq-internal.h>
 
 #include <ldsodefs.h>
 
@@ -83,6 +84,11 @@ _init (int argc, char **argv, char **envp)
   /* Initialize ctype data.  */
   __ctype_init ();
 
+  /* Register the rseq area of the initial thread.  Tunables have been
+     initialized by now.  */
+  if (!__libc_multiple_libcs)
+    rseq_register_main_thread ();
+
 #if defined SHARED && !defined NO_CTORS_DTORS_SECTIONS
   __libc_global_ctors ();
 #endif
@@ -291,6 +291,49 @@ compare (const struct cache_entry *e1, const struct cache_entry *e2)
   return res;
 }
 
+/* Build the hash index of the NENTRIES cache entries, in the order in
+   which they are saved, and store its size in *SIZE.  */
+static struct cache_hash_index *
+make_hash_index (uint32_t nentries, size_t *size)
+{
+  /* Only the first entry for each name is entered into the index.  */
+  uint32_t nnames = 0;
+  const char *prev = NULL;
+  for (struct cache_entry *entry = entries; entry != NULL;
+       entry = entry->next)
+    {
+      if (prev == NULL || _dl_cache_libcmp (prev, entry->lib) != 0)
+	++nnames;
+      prev = entry->lib;
+    }
+
+  uint32_t nbuckets = nnames > 0 ? nnames : 1;
+  *size = (sizeof (struct cache_hash_index)
+	   + (nbuckets + 2 * (size_t) nentries) * sizeof (uint32_t));
+  struct cache_hash_index *index = xmalloc (*size);
+  memset (index, '\0', *size);
+  index->nbuckets = nbuckets;
+  uint32_t *chain = &index->buckets[nbuckets];
+  uint32_t *hashes = &chain[nentries];
+
+  uint32_t idx = 0;
+  prev = NULL;
+  for (struct cache_entry *entry = entries; entry != NULL;
+       entry = entry->next, ++idx)
+    {
+      hashes[idx] = _dl_cache_hash (entry->lib);
+      if (prev == NULL || _dl_cache_libcmp (prev, entry->lib) != 0)
+	{
+	  uint32_t *bucket = &index->buckets[hashes[idx] % nbuckets];
+	  chain[idx] = *bucket;
+	  *bucket = idx + 1;
+	}
+      prev = entry->lib;
+    }
+
+  return index;
+}
+
 /* Save the contents of the cache.  */
 void
 save_cache (const char *cache_name)
@@ -424,6 +467,18 @@ save_cache (const char *cache_name)
       && idx_old < cache_entry_old_count)
     file_entries->libs[idx_old] = file_entries->libs[idx_old - 1];
 
+  /* The hash index of the new format follows its string table.  */
+  struct cache_hash_index *hash_index = NULL;
+  size_t hash_index_size = 0;
+  size_t hash_pad = 0;
+  if (opt_format != 0)
+    {
+      hash_index = make_hash_index (cache_entry_count, &hash_index_size);
+      size_t end = file_entries_new_size + total_strlen;
+      hash_pad = ALIGN_CACHE_HASH (end) - end;
+      file_entries_new->hash_offset = end + hash_pad;
+    }
+
   /* Write out the cache.  */
 
   /* Write cache first to a temporary file and rename it later.  */
@@ -462,6 +517,16 @@ save_cache (const char *cache_name)
   if (write (fd, strings, total_strlen) != (ssize_t) total_strlen)
     error (EXIT_FAILURE, errno, _("Writing of cache data failed"));
 
+  if (opt_format != 0)
+    {
+      char zero[hash_pad + 1];
+      memset (zero, '\0', hash_pad);
+      if (write (fd, zero, hash_pad) != (ssize_t) hash_pad
+	  || (write (fd, hash_index, hash_index_size)
+	      != (ssize_t) hash_index_size))
+	error (EXIT_FAILURE, errno, _("Writing of cache data failed"));
+    }
+
   /* Make sure user can always read cache file */
   if (chmod (temp_name, S_IROTH|S_IRGRP|S_IRUSR|S_IWUSR))
     error (EXIT_FAILURE, errno,
@@ -481,6 +546,7 @@ save_cache (const char *cache_name)
   free (file_entries_new);
   free (file_entries);
   free (strings);
+  free (hash_index);
 
   while (entries)
     {
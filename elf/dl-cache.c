@@ -34,10 +34,78 @@
 static struct cache_file *cache;
 static struct cache_file_new *cache_new;
 static size_t cachesize;
+/* The hash index of the new format, or NULL if there is none.  */
+static const struct cache_hash_index *cache_hash;
 
 /* 1 if cache_data + PTR points into the cache.  */
 #define _dl_cache_verify_ptr(ptr) (ptr < cache_data_size)
 
+/* Select the best of the entries starting at MIDDLE, which is the first
+   entry for NAME.  LEFT is the last entry known to be for NAME.  */
+#define SEARCH_CACHE_MATCHES(cache) \
+do									      \
+  {									      \
+    int flags;								      \
+    __typeof__ (cache->libs[0]) *lib = &cache->libs[middle];		      \
+									      \
+    /* Only perform the name test if necessary.  */			      \
+    if (middle > left							      \
+	/* We haven't seen this string so far.  Test whether the	      \
+	   index is ok and whether the name matches.  Otherwise		      \
+	   we are done.  */						      \
+	&& (! _dl_cache_verify_ptr (lib->key)				      \
+	    || (_dl_cache_libcmp (name, cache_data + lib->key)		      \
+		!= 0)))							      \
+      break;								      \
+									      \
+    flags = lib->flags;							      \
+    if (_dl_cache_check_flags (flags)					      \
+	&& _dl_cache_verify_ptr (lib->value))				      \
+      {									      \
+	if (best == NULL || flags == GLRO(dl_correct_cache_id))		      \
+	  {								      \
+	    HWCAP_CHECK;						      \
+	    best = cache_data + lib->value;				      \
+									      \
+	    if (flags == GLRO(dl_correct_cache_id))			      \
+	      /* We've found an exact match for the shared		      \
+		 object and no general `ELF' release.  Stop		      \
+		 searching.  */						      \
+	      break;							      \
+	  }								      \
+      }									      \
+  }									      \
+while (++middle <= right)
+
+/* Use the hash index CACHE_HASH of the new format to find the first
+   entry for NAME.  */
+#define HASH_SEARCH_CACHE(cache) \
+do									      \
+  {									      \
+    const uint32_t *chain = &cache_hash->buckets[cache_hash->nbuckets];	      \
+    const uint32_t *hashes = &chain[cache->nlibs];			      \
+    uint32_t hash = _dl_cache_hash (name);				      \
+    uint32_t idx = cache_hash->buckets[hash % cache_hash->nbuckets];	      \
+									      \
+    right = cache->nlibs - 1;						      \
+    /* Bound the walk in case the chains of the file are corrupt.  */	      \
+    for (uint32_t n = 0; idx != 0 && idx <= cache->nlibs		      \
+	   && n < cache->nlibs; idx = chain[idx - 1], ++n)		      \
+      {									      \
+	middle = idx - 1;						      \
+	if (hashes[middle] == hash					      \
+	    && _dl_cache_verify_ptr (cache->libs[middle].key)		      \
+	    && _dl_cache_libcmp (name,					      \
+				 cache_data + cache->libs[middle].key) == 0)  \
+	  {								      \
+	    left = middle;						      \
+	    SEARCH_CACHE_MATCHES (cache);				      \
+	    break;							      \
+	  }								      \
+      }									      \
+  }									      \
+while (0)
+
 #define SEARCH_CACHE(cache) \
 /* We use binary search since the table is sorted in the cache file.	      \
    The first matching entry in the table is returned.			      \
@@ -88,39 +156,7 @@ do									      \
 		--middle;						      \
 	      }								      \
 									      \
-	    do								      \
-	      {								      \
-		int flags;						      \
-		__typeof__ (cache->libs[0]) *lib = &cache->libs[middle];      \
-									      \
-		/* Only perform the name test if necessary.  */		      \
-		if (middle > left					      \
-		    /* We haven't seen this string so far.  Test whether the  \
-		       index is ok and whether the name matches.  Otherwise   \
-		       we are done.  */					      \
-		    && (! _dl_cache_verify_ptr (lib->key)		      \
-			|| (_dl_cache_libcmp (name, cache_data + lib->key)    \
-			    != 0)))					      \
-		  break;						      \
-									      \
-		flags = lib->flags;					      \
-		if (_dl_cache_check_flags (flags)			      \
-		    && _dl_cache_verify_ptr (lib->value))		      \
-		  {							      \
-		    if (best == NULL || flags == GLRO(dl_correct_cache_id))   \
-		      {							      \
-			HWCAP_CHECK;					      \
-			best = cache_data + lib->value;			      \
-									      \
-			if (flags == GLRO(dl_correct_cache_id))		      \
-			  /* We've found an exact match for the shared	      \
-			     object and no general `ELF' release.  Stop	      \
-			     searching.  */				      \
-			  break;					      \
-		      }							      \
-		  }							      \
-	      }								      \
-	    while (++middle <= right);					      \
+	    SEARCH_CACHE_MATCHES (cache);				      \
 	    break;							      \
 	}								      \
 									      \
@@ -172,6 +208,28 @@ _dl_cache_libcmp (const char *p1, const char *p2)
 }
 
 
+/* Return the hash index of CACHE_NEW, which extends over SIZE bytes of
+   the cache, or NULL if it has none or the index is not valid.  */
+static const struct cache_hash_index *
+cache_hash_index (const struct cache_file_new *cache_new, size_t size)
+{
+  size_t offset = cache_new->hash_offset;
+  if (offset == 0 || offset != ALIGN_CACHE_HASH (offset)
+      || size < sizeof (struct cache_hash_index)
+      || offset > size - sizeof (struct cache_hash_index))
+    return NULL;
+
+  const struct cache_hash_index *index
+    = (const void *) ((const char *) cache_new + offset);
+  if (index->nbuckets == 0
+      /* Check that the arrays fit, avoiding overflow.  */
+      || ((size - offset - sizeof (*index)) / sizeof (uint32_t)
+	  < index->nbuckets + 2 * (uint64_t) cache_new->nlibs))
+    return NULL;
+  return index;
+}
+
+
 /* Look up NAME in ld.so.cache and return the file name stored there, or null
    if none is found.  The cache is loaded if it was not already.  If loading
    the cache previously failed there will be no more attempts to load it.
@@ -237,6 +295,13 @@ _dl_load_cache_lookup (const char *name)
 	  cache = (void *) -1;
 	}
 
+      if (cache != (void *) -1 && cache_new != (void *) -1)
+	cache_hash = cache_hash_index (cache_new,
+				       (char *) cache + cachesize
+				       - (char *) cache_new);
+      else
+	cache_hash = NULL;
+
       assert (cache != NULL);
     }
 
@@ -276,7 +341,10 @@ _dl_load_cache_lookup (const char *name)
 	  && (lib->hwcap & _DL_HWCAP_PLATFORM) != 0			      \
 	  && (lib->hwcap & _DL_HWCAP_PLATFORM) != platform)		      \
 	continue
-      SEARCH_CACHE (cache_new);
+      if (cache_hash != NULL)
+	HASH_SEARCH_CACHE (cache_new);
+      else
+	SEARCH_CACHE (cache_new);
     }
   else
     {
@@ -0,0 +1,38 @@
+/* Read directory entries in the dynamic linker.  Generic version.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#ifndef _DL_GETDENTS_H
+#define _DL_GETDENTS_H	1
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Fill BUF, which is LEN bytes long, with struct dirent64 records for
+   the next entries of the directory open on FD.  Return the number of
+   bytes filled in, 0 at the end of the directory, or -1 if the entries
+   cannot be read.  The dynamic linker uses this to index the
+   directories of library search paths; without it, every directory is
+   searched with open.  */
+
+static inline ssize_t
+_dl_getdents64 (int fd, void *buf, size_t len)
+{
+  return -1;
+}
+
+#endif  /* dl-getdents.h */
@@ -0,0 +1,70 @@
+/* Helper threads for the dynamic linker.  Generic version.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#ifndef _DL_HELPER_THREAD_H
+#define _DL_HELPER_THREAD_H	1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* The dynamic linker can start helper threads while it loads the
+   initial objects, before the thread library is initialized.  They
+   share the thread control block of the main thread, so they must not
+   use thread-local data.  This version does not support them.  */
+
+struct dl_helper_thread
+{
+  int unused;
+};
+
+/* Start a thread which calls FN (ARG) on a stack of STACK_SIZE bytes.
+   Return false if that is not possible.  */
+static inline bool
+_dl_helper_thread_start (struct dl_helper_thread *t, int (*fn) (void *),
+			 void *arg, size_t stack_size)
+{
+  return false;
+}
+
+/* Wait until the thread T has terminated and free its stack.  */
+static inline void
+_dl_helper_thread_join (struct dl_helper_thread *t)
+{
+}
+
+/* Return a number which identifies the calling thread.  */
+static inline int
+_dl_helper_thread_self (void)
+{
+  return 0;
+}
+
+/* Block while *ADDR is equal to VAL.  Spurious wake-ups are
+   possible.  */
+static inline void
+_dl_helper_thread_wait (unsigned int *addr, unsigned int val)
+{
+}
+
+/* Wake all threads blocked on ADDR.  */
+static inline void
+_dl_helper_thread_wake_all (unsigned int *addr)
+{
+}
+
+#endif  /* dl-helper-thread.h */
@@ -16,6 +16,7 @@
    License along with the GNU C Library; if not, see
    <http://www.gnu.org/licenses/>.  */
 
+#include <dirent.h>
 #include <elf.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -71,6 +72,8 @@ struct filebuf
 #include <dl-machine-reject-phdr.h>
 #include <dl-sysdep-open.h>
 #include <dl-prop.h>
+#include <dl-getdents.h>
+#include <dl-hash.h>
 #include <not-cancel.h>
 
 #include <endian.h>
@@ -526,6 +529,7 @@ fillin_rpath (char *rpath, struct r_search_path_elem **result, const char *sep,
 	  init_val = cp[0] != '/' ? existing : unknown;
 	  for (cnt = 0; cnt < ncapstr; ++cnt)
 	    dirp->status[cnt] = init_val;
+	  dirp->dir_index = NULL;
 
 	  dirp->what = what;
 	  if (__glibc_likely (where != NULL))
@@ -738,6 +742,7 @@ _dl_init_paths (const char *llp)
       assert (pelem->dirname[0] == '/');
       for (cnt = 0; cnt < ncapstr; ++cnt)
 	pelem->status[cnt] = unknown;
+      pelem->dir_index = NULL;
 
       pelem->next = (++idx == nsystem_dirs_len ? NULL : (pelem + round_size));
 
@@ -1745,6 +1750,167 @@ open_verify (const char *name, int fd,
 
   return fd;
 }
+
+/* Index of the file names in a search path directory.  Searching a
+   long path such as LD_LIBRARY_PATH for each needed object would
+   otherwise try to open the object in every directory, which is slow
+   on network file systems.  Only the hashes of the names are recorded,
+   so a name which is found in the index might still not exist; the
+   directory is then searched with open as usual.  */
+struct r_dir_index
+{
+  /* Number of slots in HASHES minus one.  */
+  size_t mask;
+  /* Open-addressing hash table.  Empty slots are zero.  */
+  uint32_t hashes[];
+};
+
+/* Marks a directory which cannot be indexed.  */
+#define DIR_INDEX_NONE ((struct r_dir_index *) -1l)
+
+/* Directory indexes are only used while the initial objects are
+   loaded.  Later on, the directories might have changed.  */
+static inline bool
+dir_index_enabled (void)
+{
+#ifdef SHARED
+  return !rtld_active ();
+#else
+  return false;
+#endif
+}
+
+static inline uint32_t
+dir_index_hash (const char *name)
+{
+  uint32_t hash = _dl_elf_hash (name);
+  return hash != 0 ? hash : 1;
+}
+
+/* Return false if the index of the capability subdirectory CNT of
+   THIS_DIR shows that it has no file whose name has hash HASH.  */
+static bool
+dir_index_may_contain (struct r_search_path_elem *this_dir, size_t cnt,
+		       uint32_t hash)
+{
+  if (this_dir->dir_index == NULL)
+    return true;
+  struct r_dir_index *index = this_dir->dir_index[cnt];
+  if (index == NULL || index == DIR_INDEX_NONE)
+    return true;
+
+  size_t i = hash & index->mask;
+  while (index->hashes[i] != 0)
+    {
+      if (index->hashes[i] == hash)
+	return true;
+      i = (i + 1) & index->mask;
+    }
+  return false;
+}
+
+/* Read the directory DIRNAME and return an index of the names in it,
+   or DIR_INDEX_NONE if it cannot be read.  */
+static struct r_dir_index *
+dir_index_read (const char *dirname)
+{
+  int fd = __open64_nocancel (dirname, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd == -1)
+    return DIR_INDEX_NONE;
+
+  /* Collect the hashes first.  The array is always the last memory
+     block allocated, so the minimal malloc can grow it in place.  */
+  uint32_t *hashes = NULL;
+  size_t nhashes = 0;
+  size_t allocated = 0;
+  char buf[4096] __attribute__ ((aligned (__alignof__ (struct dirent64))));
+  ssize_t len;
+  while ((len = _dl_getdents64 (fd, buf, sizeof (buf))) > 0)
+    for (ssize_t pos = 0; pos < len; )
+      {
+	struct dirent64 *d = (struct dirent64 *) (buf + pos);
+	pos += d->d_reclen;
+
+	if (d->d_name[0] == '.'
+	    && (d->d_name[1] == '\0'
+		|| (d->d_name[1] == '.' && d->d_name[2] == '\0')))
+	  continue;
+
+	if (nhashes == allocated)
+	  {
+	    allocated = allocated == 0 ? 256 : 2 * allocated;
+	    uint32_t *newp = realloc (hashes, allocated * sizeof (*hashes));
+	    if (newp == NULL)
+	      {
+		len = -1;
+		break;
+	      }
+	    hashes = newp;
+	  }
+	hashes[nhashes++] = dir_index_hash (d->d_name);
+      }
+  __close_nocancel (fd);
+
+  struct r_dir_index *index = NULL;
+  if (len == 0)
+    {
+      /* Keep the table at most half full.  */
+      size_t size = 16;
+      while (size < 2 * nhashes)
+	size *= 2;
+      /* Build the table in the memory block of the hashes, which are
+	 moved behind it first, and cut them off afterwards.  The
+	 minimal malloc could not give back the hashes if the table
+	 were allocated after them.  */
+      size_t table_size = sizeof (*index) + size * sizeof (uint32_t);
+      void *block = realloc (hashes,
+			     table_size + nhashes * sizeof (*hashes));
+      if (block != NULL)
+	{
+	  hashes = memmove ((char *) block + table_size, block,
+			    nhashes * sizeof (*hashes));
+	  index = block;
+	  memset (index, 0, table_size);
+	  index->mask = size - 1;
+	  for (size_t cnt = 0; cnt < nhashes; ++cnt)
+	    {
+	      size_t i = hashes[cnt] & index->mask;
+	      while (index->hashes[i] != 0 && index->hashes[i] != hashes[cnt])
+		i = (i + 1) & index->mask;
+	      index->hashes[i] = hashes[cnt];
+	    }
+	  hashes = NULL;
+	  /* This shrinks the block in place.  */
+	  block = realloc (index, table_size);
+	  if (block != NULL)
+	    index = block;
+	}
+    }
+  free (hashes);
+  return index != NULL ? index : DIR_INDEX_NONE;
+}
+
+/* Index the capability subdirectory CNT of THIS_DIR, whose name is
+   DIRNAME, unless that has been tried before.  */
+static void
+dir_index_add (struct r_search_path_elem *this_dir, size_t cnt,
+	       const char *dirname)
+{
+  if (this_dir->dir_index == NULL)
+    {
+      this_dir->dir_index = calloc (ncapstr, sizeof (struct r_dir_index *));
+      if (this_dir->dir_index == NULL)
+	return;
+    }
+  if (this_dir->dir_index[cnt] != NULL)
+    return;
+
+  /* The caller still needs the error from the failed open.  */
+  int err = errno;
+  this_dir->dir_index[cnt] = dir_index_read (dirname);
+  __set_errno (err);
+}
+
 
 /* Try to open NAME in one of the directories in *DIRSP.
    Return the fd, or -1.  If successful, fill in *REALNAME
@@ -1770,6 +1936,14 @@ open_path (const char *name, size_t namelen, int mode,
        given on the command line when rtld is run directly.  */
     return -1;
 
+  /* Only absolute directories are indexed.  Auditing code is loaded
+     without updating the directory information.  */
+  uint32_t namehash = 0;
+  if (dir_index_enabled ()
+      && (loader == NULL
+	  || GL(dl_ns)[loader->l_ns]._ns_loaded->l_auditing == 0))
+    namehash = dir_index_hash (name);
+
   buf = alloca (max_dirnamelen + max_capstrlen + namelen);
   do
     {
@@ -1796,11 +1970,18 @@ open_path (const char *name, size_t namelen, int mode,
 	  if (this_dir->status[cnt] == nonexisting)
 	    continue;
 
-	  buflen =
-	    ((char *) __mempcpy (__mempcpy (edp, capstr[cnt].str,
-					    capstr[cnt].len),
-				 name, namelen)
-	     - buf);
+	  /* Skip this directory if its index shows that the file is not
+	     there.  Only existing directories are indexed.  */
+	  if (namehash != 0
+	      && !dir_index_may_contain (this_dir, cnt, namehash))
+	    {
+	      here_any = 1;
+	      __set_errno (ENOENT);
+	      continue;
+	    }
+
+	  char *namep = __mempcpy (edp, capstr[cnt].str, capstr[cnt].len);
+	  buflen = (char *) __mempcpy (namep, name, namelen) - buf;
 
 	  /* Print name we try if this is wanted.  */
 	  if (__glibc_unlikely (GLRO(dl_debug_mask) & DL_DEBUG_LIBS))
@@ -1808,6 +1989,16 @@ open_path (const char *name, size_t namelen, int mode,
 
 	  fd = open_verify (buf, -1, fbp, loader, whatcode, mode,
 			    found_other_class, false);
+
+	  /* Other objects are likely to be searched for in this
+	     directory as well.  Index it so that they need no open
+	     call if they are not there.  */
+	  if (fd == -1 && namehash != 0 && this_dir->dirname[0] == '/')
+	    {
+	      *namep = '\0';
+	      dir_index_add (this_dir, cnt, buf);
+	    }
+
 	  if (this_dir->status[cnt] == unknown)
 	    {
 	      if (fd != -1)
@@ -18,9 +18,11 @@
 
 #include <alloca.h>
 #include <libintl.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <ldsodefs.h>
 #include <dl-hash.h>
 #include <dl-machine.h>
@@ -47,9 +49,11 @@ struct sym_val
   };
 
 
-/* Statistics function.  */
+/* Statistics function.  The initial objects may be relocated by
+   several threads, see dl-reloc-parallel.c.  */
 #ifdef SHARED
-# define bump_num_relocations() ++GL(dl_num_relocations)
+# define bump_num_relocations() \
+  ((void) atomic_fetch_add_relaxed (&GL(dl_num_relocations), 1))
 #else
 # define bump_num_relocations() ((void) 0)
 #endif
@@ -776,6 +780,175 @@ _dl_debug_bindings (const char *undef_name, struct link_map *undef_map,
 		    int protected);
 
 
+#ifdef SHARED
+/* The lookup memo is an open-addressing hash table of the definitions
+   found by _dl_lookup_symbol_x in a single scope, which is used while
+   the initial objects are relocated.  Large programs refer to the same
+   symbols, such as those of the C++ standard library, from many
+   objects, and each such reference would otherwise search all objects
+   of the scope again.  Only the results of lookups which do not depend
+   on the object containing the reference are remembered: the
+   reference must not be protected, and the definition must not be
+   unique or in a dynamically loaded object.  */
+
+struct lookup_memo_entry
+{
+  const char *name;
+  const struct r_found_version *version;
+  const ElfW(Sym) *sym;
+  struct link_map *map;
+  uint_fast32_t hash;
+  int type_class;
+};
+
+/* Initial number of entries in the memo.  Must be a power of two.  */
+#define LOOKUP_MEMO_SIZE 4096
+
+static struct
+{
+  struct r_scope_elem *scope;
+  struct lookup_memo_entry *entries;
+  size_t mask;
+  size_t used;
+} lookup_memo;
+
+static struct lookup_memo_entry *
+lookup_memo_alloc (size_t size)
+{
+  void *p = __mmap (NULL, size * sizeof (struct lookup_memo_entry),
+		    PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+  return p == MAP_FAILED ? NULL : p;
+}
+
+void
+_dl_lookup_memo_start (struct r_scope_elem *symbol_scope)
+{
+  lookup_memo.entries = lookup_memo_alloc (LOOKUP_MEMO_SIZE);
+  if (lookup_memo.entries == NULL)
+    return;
+  lookup_memo.scope = symbol_scope;
+  lookup_memo.mask = LOOKUP_MEMO_SIZE - 1;
+  lookup_memo.used = 0;
+}
+
+void
+_dl_lookup_memo_end (void)
+{
+  if (lookup_memo.entries != NULL)
+    __munmap (lookup_memo.entries,
+	      (lookup_memo.mask + 1) * sizeof (struct lookup_memo_entry));
+  lookup_memo.entries = NULL;
+}
+
+static bool
+lookup_memo_same_version (const struct r_found_version *a,
+			  const struct r_found_version *b)
+{
+  if (a == b)
+    return true;
+  if (a == NULL || b == NULL)
+    return false;
+  return (a->hash == b->hash && a->hidden == b->hidden
+	  && strcmp (a->name, b->name) == 0
+	  && (a->filename == b->filename
+	      || (a->filename != NULL && b->filename != NULL
+		  && strcmp (a->filename, b->filename) == 0)));
+}
+
+static inline size_t
+lookup_memo_index (uint_fast32_t hash, const struct r_found_version *version,
+		   int type_class)
+{
+  if (version != NULL)
+    hash ^= version->hash * 31;
+  return (hash ^ type_class) & lookup_memo.mask;
+}
+
+/* Return the memo entry for a lookup, or NULL if the lookup cannot use
+   the memo.  The SYM member of the entry is NULL if the symbol has not
+   been looked up yet; the entry can then be filled by
+   lookup_memo_insert.  */
+static struct lookup_memo_entry *
+lookup_memo_find (const char *undef_name, uint_fast32_t new_hash,
+		  const ElfW(Sym) *ref, struct link_map *undef_map,
+		  struct r_scope_elem *symbol_scope[],
+		  const struct r_found_version *version, int type_class,
+		  int flags, struct link_map *skip_map)
+{
+  if (symbol_scope[0] != lookup_memo.scope || symbol_scope[1] != NULL
+      || undef_map == NULL || skip_map != NULL
+      || (flags & ~(DL_LOOKUP_ADD_DEPENDENCY | DL_LOOKUP_GSCOPE_LOCK)) != 0
+      || (ref != NULL
+	  && ELFW(ST_VISIBILITY) (ref->st_other) == STV_PROTECTED)
+      || (GLRO(dl_debug_mask) & DL_DEBUG_SYMBOLS) != 0)
+    return NULL;
+
+  size_t i = lookup_memo_index (new_hash, version, type_class);
+  while (true)
+    {
+      struct lookup_memo_entry *e = &lookup_memo.entries[i];
+      if (e->sym == NULL
+	  || (e->hash == new_hash && e->type_class == type_class
+	      && lookup_memo_same_version (e->version, version)
+	      && strcmp (e->name, undef_name) == 0))
+	return e;
+      i = (i + 1) & lookup_memo.mask;
+    }
+}
+
+/* Double the size of the memo, or disable it if that fails.  */
+static void
+lookup_memo_grow (void)
+{
+  size_t size = 2 * (lookup_memo.mask + 1);
+  struct lookup_memo_entry *old = lookup_memo.entries;
+  size_t old_size = lookup_memo.mask + 1;
+
+  struct lookup_memo_entry *entries = lookup_memo_alloc (size);
+  if (entries == NULL)
+    {
+      _dl_lookup_memo_end ();
+      return;
+    }
+  lookup_memo.entries = entries;
+  lookup_memo.mask = size - 1;
+  for (size_t i = 0; i < old_size; ++i)
+    if (old[i].sym != NULL)
+      {
+	size_t j = lookup_memo_index (old[i].hash, old[i].version,
+				      old[i].type_class);
+	while (entries[j].sym != NULL)
+	  j = (j + 1) & lookup_memo.mask;
+	entries[j] = old[i];
+      }
+  __munmap (old, old_size * sizeof (struct lookup_memo_entry));
+}
+
+/* Fill the empty entry E returned by lookup_memo_find with the result
+   VALUE of the lookup.  */
+static void
+lookup_memo_insert (struct lookup_memo_entry *e, const char *undef_name,
+		    uint_fast32_t new_hash,
+		    const struct r_found_version *version, int type_class,
+		    const struct sym_val *value)
+{
+  if (ELFW(ST_BIND) (value->s->st_info) == STB_GNU_UNIQUE
+      || value->m->l_type == lt_loaded)
+    return;
+
+  e->name = undef_name;
+  e->version = version;
+  e->sym = value->s;
+  e->map = value->m;
+  e->hash = new_hash;
+  e->type_class = type_class;
+  /* Keep the load factor below 3/4.  */
+  if (++lookup_memo.used > lookup_memo.mask / 4 * 3)
+    lookup_memo_grow ();
+}
+#endif
+
+
 /* Search loaded objects' symbol tables for a definition of the symbol
    UNDEF_NAME, perhaps with a requested version for the symbol.
 
@@ -808,6 +981,23 @@ _dl_lookup_symbol_x (const char *undef_name, struct link_map *undef_map,
     while ((*scope)->r_list[i] != skip_map)
       ++i;
 
+#ifdef SHARED
+  struct lookup_memo_entry *memo = NULL;
+  if (__glibc_unlikely (lookup_memo.entries != NULL))
+    {
+      memo = lookup_memo_find (undef_name, new_hash, *ref, undef_map,
+			       symbol_scope, version, type_class, flags,
+			       skip_map);
+      if (memo != NULL && memo->sym != NULL)
+	{
+	  ++GL(dl_num_memo_relocations);
+	  current_value.s = memo->sym;
+	  current_value.m = memo->map;
+	  goto found;
+	}
+    }
+#endif
+
   /* Search the relevant loaded objects for a definition.  */
   for (size_t start = i; *scope != NULL; start = 0, ++scope)
     {
@@ -862,6 +1052,13 @@ _dl_lookup_symbol_x (const char *undef_name, struct link_map *undef_map,
       return 0;
     }
 
+#ifdef SHARED
+  if (memo != NULL && lookup_memo.entries != NULL)
+    lookup_memo_insert (memo, undef_name, new_hash, version, type_class,
+			&current_value);
+
+ found:;
+#endif
   int protected = (*ref
 		   && ELFW(ST_VISIBILITY) ((*ref)->st_other) == STV_PROTECTED);
   if (__glibc_unlikely (protected != 0))
@@ -327,6 +327,17 @@ dl_open_worker (void *a)
   while (l != NULL);
   _dl_sort_maps (maps, nmaps, NULL, false);
 
+  /* Place the TLS blocks of the new objects in the static TLS area if
+     they fit into the part of the surplus set aside for this.  Their
+     variables are then accessed without allocating memory in
+     __tls_get_addr, and TLS descriptors referring to them resolve to
+     the static block.  This must be decided before relocation.  */
+  for (unsigned int i = 0; i < nmaps; ++i)
+    if (maps[i]->l_tls_blocksize > 0
+	&& maps[i]->l_tls_offset == NO_TLS_OFFSET
+	&& GL(dl_tls_static_optional) > 0)
+      (void) _dl_try_allocate_static_tls (maps[i], true);
+
   int relocation_in_progress = 0;
 
   for (unsigned int i = nmaps; i-- > 0; )
@@ -465,10 +476,17 @@ dl_open_worker (void *a)
 	_dl_show_scope (imap, from_scope);
     }
 
-  /* Bump the generation number if necessary.  */
-  if (any_tls && __builtin_expect (++GL(dl_tls_generation) == 0, 0))
-    _dl_fatal_printf (N_("\
+  /* Bump the generation number if necessary.  This synchronizes with
+     the acquire MO load in __tls_get_addr, which then sees the new
+     slotinfo entries.  */
+  if (any_tls)
+    {
+      size_t newgen = GL(dl_tls_generation) + 1;
+      if (__glibc_unlikely (newgen == 0))
+	_dl_fatal_printf (N_("\
 TLS generation counter wrapped!  Please report this."));
+      atomic_store_release (&GL(dl_tls_generation), newgen);
+    }
 
   /* We need a second pass for static tls data, because _dl_update_slotinfo
      must not be run while calls to _dl_add_to_slotinfo are still pending.  */
@@ -486,7 +504,7 @@ TLS generation counter wrapped!  Please report this."));
 #ifdef SHARED
 	  /* Update the slot information data for at least the
 	     generation of the DSO we are allocating data for.  */
-	  _dl_update_slotinfo (imap->l_tls_modid);
+	  _dl_update_slotinfo (imap->l_tls_modid, GL(dl_tls_generation));
 #endif
 
 	  GL(dl_init_static_tls) (imap);
@@ -0,0 +1,190 @@
+/* Relocate the initial objects in parallel.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include <alloca.h>
+#include <atomic.h>
+#include <ldsodefs.h>
+#include <dl-helper-thread.h>
+
+#if HAVE_TUNABLES
+# define TUNABLE_NAMESPACE rtld
+# include <dl-tunables.h>
+#endif
+
+/* Stack size of the helper threads.  IFUNC resolvers run on it.  */
+#define RELOC_THREAD_STACK_SIZE (1024 * 1024)
+
+/* The objects are relocated in the same order as by dl_main, but an
+   object only waits until the objects it depends on and which come
+   earlier in that order are relocated, so that their IFUNC resolvers
+   can be called.  The main program, which contains the copy
+   relocations, is relocated afterwards by dl_main.  */
+struct reloc_work
+{
+  /* The objects to relocate, in order.  */
+  struct link_map **maps;
+  unsigned int nmaps;
+  /* Nonzero for each object which has been relocated.  */
+  unsigned int *done;
+  /* Index of the next object to relocate.  */
+  unsigned int next;
+  /* Incremented when an object has been relocated.  */
+  unsigned int done_seq;
+  int reloc_mode;
+};
+
+#if defined _LIBC_REENTRANT && defined __rtld_lock_default_lock_recursive
+/* The recursive locks of the dynamic linker do not exclude other
+   threads before the thread library has been initialized.  While
+   helper threads run, all of them are replaced by this lock.  It is
+   only used when unique symbols are looked up.  0 means unlocked, 1
+   locked, and 2 locked with waiters.  */
+static unsigned int reloc_lock;
+static int reloc_lock_owner;
+static unsigned int reloc_lock_count;
+
+static void
+reloc_lock_lock (void *lock)
+{
+  int self = _dl_helper_thread_self ();
+  if (atomic_load_relaxed (&reloc_lock_owner) == self)
+    {
+      ++reloc_lock_count;
+      return;
+    }
+
+  if (atomic_compare_and_exchange_bool_acq (&reloc_lock, 1, 0) != 0)
+    while (atomic_exchange_acq (&reloc_lock, 2) != 0)
+      _dl_helper_thread_wait (&reloc_lock, 2);
+  atomic_store_relaxed (&reloc_lock_owner, self);
+  reloc_lock_count = 1;
+}
+
+static void
+reloc_lock_unlock (void *lock)
+{
+  if (--reloc_lock_count != 0)
+    return;
+
+  atomic_store_relaxed (&reloc_lock_owner, 0);
+  if (atomic_exchange_rel (&reloc_lock, 0) == 2)
+    _dl_helper_thread_wake_all (&reloc_lock);
+}
+
+/* Wait until the object at index IDX of WORK has been relocated.  */
+static void
+reloc_wait (struct reloc_work *work, unsigned int idx)
+{
+  while (true)
+    {
+      unsigned int seq = atomic_load_acquire (&work->done_seq);
+      if (atomic_load_acquire (&work->done[idx]) != 0)
+	return;
+      _dl_helper_thread_wait (&work->done_seq, seq);
+    }
+}
+
+/* Relocate objects of WORK until there are none left.  */
+static int
+reloc_worker (void *arg)
+{
+  struct reloc_work *work = arg;
+
+  while (true)
+    {
+      unsigned int idx = atomic_fetch_add_relaxed (&work->next, 1);
+      if (idx >= work->nmaps)
+	break;
+
+      struct link_map *l = work->maps[idx];
+      if (l->l_initfini != NULL)
+	for (struct link_map **dep = &l->l_initfini[1]; *dep != NULL; ++dep)
+	  if ((*dep)->l_idx >= 0 && (unsigned int) (*dep)->l_idx < idx)
+	    reloc_wait (work, (*dep)->l_idx);
+
+      _dl_relocate_object (l, l->l_scope, work->reloc_mode, 0);
+
+      atomic_store_release (&work->done[idx], 1);
+      atomic_fetch_add_release (&work->done_seq, 1);
+      _dl_helper_thread_wake_all (&work->done_seq);
+    }
+
+  return 0;
+}
+#endif
+
+void
+_dl_relocate_parallel (struct link_map *main_map, int reloc_mode)
+{
+#if HAVE_TUNABLES \
+    && defined _LIBC_REENTRANT && defined __rtld_lock_default_lock_recursive
+  int32_t nthreads = TUNABLE_GET (reloc_threads, int32_t, NULL);
+
+  /* Debugging output and auditing modules expect the objects to be
+     relocated one after the other.  */
+  if (nthreads < 2 || GLRO(dl_debug_mask) != 0 || GLRO(dl_naudit) > 0)
+    return;
+
+  struct reloc_work work = { .reloc_mode = reloc_mode };
+  unsigned int nlist = main_map->l_searchlist.r_nlist;
+  work.maps = alloca (nlist * sizeof (struct link_map *));
+  work.done = alloca (nlist * sizeof (unsigned int));
+
+  /* Use l_idx for the position of each object in the relocation
+     order, or -1 if the object is not relocated here.  */
+  for (struct link_map *l = GL(dl_ns)[LM_ID_BASE]._ns_loaded; l != NULL;
+       l = l->l_next)
+    l->l_idx = -1;
+  for (unsigned int i = nlist; i-- > 0; )
+    {
+      struct link_map *l = main_map->l_initfini[i];
+      if (l != main_map && l != &GL(dl_rtld_map) && !l->l_relocated)
+	{
+	  l->l_idx = work.nmaps;
+	  work.done[work.nmaps] = 0;
+	  work.maps[work.nmaps++] = l;
+	}
+    }
+  if (work.nmaps < 2)
+    return;
+
+  if ((unsigned int) nthreads > work.nmaps)
+    nthreads = work.nmaps;
+  struct dl_helper_thread *threads
+    = alloca ((nthreads - 1) * sizeof (struct dl_helper_thread));
+
+  void (*lock) (void *) = GL(dl_rtld_lock_recursive);
+  void (*unlock) (void *) = GL(dl_rtld_unlock_recursive);
+  GL(dl_rtld_lock_recursive) = reloc_lock_lock;
+  GL(dl_rtld_unlock_recursive) = reloc_lock_unlock;
+
+  /* The main thread relocates objects as well.  If a thread cannot be
+     started, the others do its work.  */
+  int started = 0;
+  while (started < nthreads - 1
+	 && _dl_helper_thread_start (&threads[started], reloc_worker, &work,
+				     RELOC_THREAD_STACK_SIZE))
+    ++started;
+  reloc_worker (&work);
+  for (int i = 0; i < started; ++i)
+    _dl_helper_thread_join (&threads[i]);
+
+  GL(dl_rtld_lock_recursive) = lock;
+  GL(dl_rtld_unlock_recursive) = unlock;
+#endif
+}
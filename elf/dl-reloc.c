@@ -16,8 +16,10 @@
    License along with the GNU C Library; if not, see
    <http://www.gnu.org/licenses/>.  */
 
+#include <atomic.h>
 #include <errno.h>
 #include <libintl.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <ldsodefs.h>
@@ -28,9 +30,11 @@
 #include <libc-pointer-arith.h>
 #include "dynamic-link.h"
 
-/* Statistics function.  */
+/* Statistics function.  The initial objects may be relocated by
+   several threads, see dl-reloc-parallel.c.  */
 #ifdef SHARED
-# define bump_num_cache_relocations() ++GL(dl_num_cache_relocations)
+# define bump_num_cache_relocations() \
+  ((void) atomic_fetch_add_relaxed (&GL(dl_num_cache_relocations), 1))
 #else
 # define bump_num_cache_relocations() ((void) 0)
 #endif
@@ -43,9 +47,12 @@
    we set MAP->l_tls_offset and return.
    This function intentionally does not return any value but signals error
    directly, as static TLS should be rare and code handling it should
-   not be inlined as much as possible.  */
+   not be inlined as much as possible.
+   If OPTIONAL is true, the object does not need static TLS and the
+   block is only placed there if it fits into what remains of
+   GL(dl_tls_static_optional).  */
 int
-_dl_try_allocate_static_tls (struct link_map *map)
+_dl_try_allocate_static_tls (struct link_map *map, bool optional)
 {
   /* If we've already used the variable with dynamic access, or if the
      alignment requirements are too high, fail.  */
@@ -70,8 +77,7 @@ _dl_try_allocate_static_tls (struct link_map *map)
 
   size_t offset = GL(dl_tls_static_used) + (freebytes - n * map->l_tls_align
 					    - map->l_tls_firstbyte_offset);
-
-  map->l_tls_offset = GL(dl_tls_static_used) = offset;
+  size_t used = offset;
 #elif TLS_DTV_AT_TP
   /* dl_tls_static_used includes the TCB at the beginning.  */
   size_t offset = (ALIGN_UP(GL(dl_tls_static_used)
@@ -82,14 +88,26 @@ _dl_try_allocate_static_tls (struct link_map *map)
 
   if (used > GL(dl_tls_static_size))
     goto fail;
-
-  map->l_tls_offset = offset;
-  map->l_tls_firstbyte_offset = GL(dl_tls_static_used);
-  GL(dl_tls_static_used) = used;
 #else
 # error "Either TLS_TCB_AT_TP or TLS_DTV_AT_TP must be defined"
 #endif
 
+  if (optional && used - GL(dl_tls_static_used) > GL(dl_tls_static_optional))
+    goto fail;
+
+  /* __tls_get_addr decides without taking the lock that a block which
+     is not yet in static TLS is dynamic.  */
+  if (atomic_compare_and_exchange_bool_acq (&map->l_tls_offset, offset,
+					    NO_TLS_OFFSET))
+    goto fail;
+
+  if (optional)
+    GL(dl_tls_static_optional) -= used - GL(dl_tls_static_used);
+#if TLS_DTV_AT_TP
+  map->l_tls_firstbyte_offset = GL(dl_tls_static_used);
+#endif
+  GL(dl_tls_static_used) = used;
+
   /* If the object is not yet relocated we cannot initialize the
      static TLS region.  Delay it.  */
   if (map->l_real->l_relocated)
@@ -99,7 +117,8 @@ _dl_try_allocate_static_tls (struct link_map *map)
 			    0))
 	/* Update the slot information data for at least the generation of
 	   the DSO we are allocating data for.  */
-	(void) _dl_update_slotinfo (map->l_tls_modid);
+	(void) _dl_update_slotinfo (map->l_tls_modid,
+				    GL(dl_tls_generation));
 #endif
 
       GL(dl_init_static_tls) (map);
@@ -115,7 +134,7 @@ __attribute_noinline__
 _dl_allocate_static_tls (struct link_map *map)
 {
   if (map->l_tls_offset == FORCED_DYNAMIC_TLS_OFFSET
-      || _dl_try_allocate_static_tls (map))
+      || _dl_try_allocate_static_tls (map, false))
     {
       _dl_signal_error (0, map->l_name, NULL, N_("\
 cannot allocate memory in static TLS block"));
@@ -29,6 +29,11 @@
 #include <dl-tls.h>
 #include <ldsodefs.h>
 
+#if HAVE_TUNABLES
+# define TUNABLE_NAMESPACE rtld
+# include <dl-tunables.h>
+#endif
+
 /* Amount of excess space to allocate in the static TLS area
    to allow dynamic loading of modules defining IE-model TLS data.  */
 #define TLS_STATIC_SURPLUS	64 + DL_NNS * 100
@@ -145,6 +150,13 @@ _dl_determine_tlsoffset (void)
 
   struct dtv_slotinfo *slotinfo = GL(dl_tls_dtv_slotinfo_list)->slotinfo;
 
+#if HAVE_TUNABLES
+  /* Room for dlopened objects which do not need static TLS but are
+     faster to access there.  */
+  GL(dl_tls_static_optional) = TUNABLE_GET (optional_static_tls, size_t,
+					    NULL);
+#endif
+
   /* Determining the offset of the various parts of the static TLS
      block has several dependencies.  In addition we have to work
      around bugs in some toolchains.
@@ -218,7 +230,8 @@ _dl_determine_tlsoffset (void)
     }
 
   GL(dl_tls_static_used) = offset;
-  GL(dl_tls_static_size) = (roundup (offset + TLS_STATIC_SURPLUS, max_align)
+  GL(dl_tls_static_size) = (roundup (offset + TLS_STATIC_SURPLUS
+				     + GL(dl_tls_static_optional), max_align)
 			    + TLS_TCB_SIZE);
 #elif TLS_DTV_AT_TP
   /* The TLS blocks start right after the TCB.  */
@@ -262,7 +275,8 @@ _dl_determine_tlsoffset (void)
     }
 
   GL(dl_tls_static_used) = offset;
-  GL(dl_tls_static_size) = roundup (offset + TLS_STATIC_SURPLUS,
+  GL(dl_tls_static_size) = roundup (offset + TLS_STATIC_SURPLUS
+				    + GL(dl_tls_static_optional),
 				    TLS_TCB_ALIGN);
 #else
 # error "Either TLS_TCB_AT_TP or TLS_DTV_AT_TP must be defined"
@@ -619,7 +633,7 @@ allocate_and_init (struct link_map *map)
 
 
 struct link_map *
-_dl_update_slotinfo (unsigned long int req_modid)
+_dl_update_slotinfo (unsigned long int req_modid, size_t new_gen)
 {
   struct link_map *the_map = NULL;
   dtv_t *dtv = THREAD_DTV ();
@@ -636,9 +650,11 @@ _dl_update_slotinfo (unsigned long int req_modid)
      code and therefore add to the slotinfo list.  This is a problem
      since we must not pick up any information about incomplete work.
      The solution to this is to ignore all dtv slots which were
-     created after the one we are currently interested.  We know that
-     dynamic loading for this module is completed and this is the last
-     load operation we know finished.  */
+     created after NEW_GEN.  The caller read NEW_GEN from
+     dl_tls_generation with acquire MO, so the dynamic loading for all
+     older slots has completed.  Updating to that generation rather
+     than to the one of the requested module ensures that the next
+     __tls_get_addr call takes the fast path again.  */
   unsigned long int idx = req_modid;
   struct dtv_slotinfo_list *listp = GL(dl_tls_dtv_slotinfo_list);
 
@@ -648,13 +664,12 @@ _dl_update_slotinfo (unsigned long int req_modid)
       listp = listp->next;
     }
 
-  if (dtv[0].counter < listp->slotinfo[idx].gen)
+  assert (listp->slotinfo[idx].gen <= new_gen);
+  if (dtv[0].counter < new_gen)
     {
-      /* The generation counter for the slot is higher than what the
-	 current dtv implements.  We have to update the whole dtv but
-	 only those entries with a generation counter <= the one for
-	 the entry we need.  */
-      size_t new_gen = listp->slotinfo[idx].gen;
+      /* The generation counter is higher than what the current dtv
+	 implements.  We have to update the whole dtv but only those
+	 entries with a generation counter <= NEW_GEN.  */
       size_t total = 0;
 
       /* We have to look through the entire dtv slotinfo list.  */
@@ -751,21 +766,25 @@ tls_get_addr_tail (GET_ADDR_ARGS, dtv_t *dtv, struct link_map *the_map)
       the_map = listp->slotinfo[idx].map;
     }
 
-  /* Make sure that, if a dlopen running in parallel forces the
-     variable into static storage, we'll wait until the address in the
-     static TLS block is set up, and use that.  If we're undecided
-     yet, make sure we make the decision holding the lock as well.  */
-  if (__glibc_unlikely (the_map->l_tls_offset
-			!= FORCED_DYNAMIC_TLS_OFFSET))
+  /* If we're undecided yet, decide that the block is dynamic unless
+     a dlopen running in parallel forces the variable into static
+     storage first.  _dl_try_allocate_static_tls uses the same
+     compare-and-exchange, so this needs no lock.  */
+  ptrdiff_t offset = atomic_load_acquire (&the_map->l_tls_offset);
+  if (__glibc_likely (offset == NO_TLS_OFFSET)
+      && !atomic_compare_and_exchange_bool_acq (&the_map->l_tls_offset,
+						FORCED_DYNAMIC_TLS_OFFSET,
+						NO_TLS_OFFSET))
+    offset = FORCED_DYNAMIC_TLS_OFFSET;
+
+  /* Make sure that, if the variable is in static storage, we'll wait
+     until the address in the static TLS block is set up, and use
+     that.  */
+  if (__glibc_unlikely (offset != FORCED_DYNAMIC_TLS_OFFSET))
     {
       __rtld_lock_lock_recursive (GL(dl_load_lock));
-      if (__glibc_likely (the_map->l_tls_offset == NO_TLS_OFFSET))
-	{
-	  the_map->l_tls_offset = FORCED_DYNAMIC_TLS_OFFSET;
-	  __rtld_lock_unlock_recursive (GL(dl_load_lock));
-	}
-      else if (__glibc_likely (the_map->l_tls_offset
-			       != FORCED_DYNAMIC_TLS_OFFSET))
+      if (__glibc_likely (the_map->l_tls_offset
+			  != FORCED_DYNAMIC_TLS_OFFSET))
 	{
 #if TLS_TCB_AT_TP
 	  void *p = (char *) THREAD_SELF - the_map->l_tls_offset;
@@ -796,7 +815,10 @@ static struct link_map *
 __attribute_noinline__
 update_get_addr (GET_ADDR_ARGS)
 {
-  struct link_map *the_map = _dl_update_slotinfo (GET_ADDR_MODULE);
+  /* Synchronizes with the release MO store in dlopen and dlclose, so
+     that all slotinfo entries up to this generation are visible.  */
+  size_t gen = atomic_load_acquire (&GL(dl_tls_generation));
+  struct link_map *the_map = _dl_update_slotinfo (GET_ADDR_MODULE, gen);
   dtv_t *dtv = THREAD_DTV ();
 
   void *p = dtv[GET_ADDR_MODULE].pointer.val;
@@ -825,7 +847,11 @@ __tls_get_addr (GET_ADDR_ARGS)
 {
   dtv_t *dtv = THREAD_DTV ();
 
-  if (__glibc_unlikely (dtv[0].counter != GL(dl_tls_generation)))
+  /* Concurrent dlopen and dlclose calls update the generation.  If
+     this thread misses an increment, update_get_addr reads it again
+     with acquire MO.  */
+  if (__glibc_unlikely (dtv[0].counter
+			!= atomic_load_relaxed (&GL(dl_tls_generation))))
     return update_get_addr (GET_ADDR_PARAM);
 
   void *p = dtv[GET_ADDR_MODULE].pointer.val;
@@ -848,7 +874,8 @@ _dl_tls_get_addr_soft (struct link_map *l)
     return NULL;
 
   dtv_t *dtv = THREAD_DTV ();
-  if (__glibc_unlikely (dtv[0].counter != GL(dl_tls_generation)))
+  if (__glibc_unlikely (dtv[0].counter
+			!= atomic_load_relaxed (&GL(dl_tls_generation))))
     {
       /* This thread's DTV is not completely current,
 	 but it might already cover this module.  */
@@ -40,9 +40,7 @@
     (__builtin_expect ((sym_map)->l_tls_offset				\
 		       != FORCED_DYNAMIC_TLS_OFFSET, 1)			\
      && (__builtin_expect ((sym_map)->l_tls_offset != NO_TLS_OFFSET, 1)	\
-	 || _dl_try_allocate_static_tls (sym_map) == 0))
-
-int _dl_try_allocate_static_tls (struct link_map *map) attribute_hidden;
+	 || _dl_try_allocate_static_tls (sym_map, false) == 0))
 
 #include <elf.h>
 
@@ -2235,6 +2235,16 @@ ERROR: '%s': cannot process note segment.\n", _dl_argv[0]);
 
       RTLD_TIMING_VAR (start);
       rtld_timer_start (&start);
+
+      /* The profiling code needs the objects to be relocated in
+	 order.  */
+      if (!consider_profiling)
+	_dl_relocate_parallel (main_map, GLRO(dl_lazy) ? RTLD_LAZY : 0);
+
+      /* Most objects look up their symbols in the global scope alone,
+	 and many of them refer to the same symbols.  */
+      _dl_lookup_memo_start (&main_map->l_searchlist);
+
       unsigned i = main_map->l_searchlist.r_nlist;
       while (i-- > 0)
 	{
@@ -2261,6 +2271,7 @@ ERROR: '%s': cannot process note segment.\n", _dl_argv[0]);
 	  if (l->l_tls_blocksize != 0 && tls_init_tp_called)
 	    _dl_add_to_slotinfo (l);
 	}
+      _dl_lookup_memo_end ();
       rtld_timer_stop (&relocate_time, start);
 
       /* Now enable profiling if needed.  Like the previous call,
@@ -2823,9 +2834,11 @@ print_statistics (const hp_timing_t *rtld_total_timep)
 
   _dl_debug_printf ("                 number of relocations: %lu\n"
 		    "      number of relocations from cache: %lu\n"
+		    "       number of relocations from memo: %lu\n"
 		    "        number of relative relocations: %lu\n",
 		    GL(dl_num_relocations),
 		    GL(dl_num_cache_relocations),
+		    GL(dl_num_memo_relocations),
 		    num_relative_relocations);
 
 #if HP_TIMING_INLINE
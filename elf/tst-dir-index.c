@@ -0,0 +1,88 @@
+/* Test the search path directory index used during startup.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* The program has the search path $ORIGIN/tst-dir-index-dir1 and
+   $ORIGIN/tst-dir-index-dir2.  tst-dir-index-lib1.so is only in the
+   first directory, tst-dir-index-lib2.so only in the second one, and
+   tst-dir-index-mod3.so in neither.  The preloaded object
+   tst-dir-index-missing.so does not exist anywhere, so both directories
+   are indexed when it is searched for.  Afterwards, the needed objects
+   must still be found: tst-dir-index-lib1.so in the first directory,
+   tst-dir-index-lib2.so in the second one after the index of the first
+   one has ruled it out, and tst-dir-index-mod3.so in the build
+   directory after both indexes have ruled it out.  */
+
+#include <array_length.h>
+#include <link.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <support/check.h>
+
+extern int dir_index_mod1 (void);
+extern int dir_index_mod2 (void);
+extern int dir_index_mod3 (void);
+
+static const char *const objects[] =
+  {
+    "/tst-dir-index-dir1/tst-dir-index-lib1.so",
+    "/tst-dir-index-dir2/tst-dir-index-lib2.so",
+    "/tst-dir-index-mod3.so",
+  };
+
+static bool found[array_length (objects)];
+
+/* Return true if NAME ends in SUFFIX.  */
+static bool
+ends_with (const char *name, const char *suffix)
+{
+  size_t name_len = strlen (name);
+  size_t suffix_len = strlen (suffix);
+  return name_len >= suffix_len
+    && strcmp (name + name_len - suffix_len, suffix) == 0;
+}
+
+static int
+callback (struct dl_phdr_info *info, size_t size, void *closure)
+{
+  TEST_VERIFY (strstr (info->dlpi_name, "tst-dir-index-missing") == NULL);
+  for (size_t i = 0; i < array_length (objects); ++i)
+    if (ends_with (info->dlpi_name, objects[i]))
+      found[i] = true;
+  return 0;
+}
+
+static int
+do_test (void)
+{
+  TEST_COMPARE (dir_index_mod1 (), 1);
+  TEST_COMPARE (dir_index_mod2 (), 2);
+  TEST_COMPARE (dir_index_mod3 (), 3);
+
+  dl_iterate_phdr (callback, NULL);
+  for (size_t i = 0; i < array_length (objects); ++i)
+    if (!found[i])
+      {
+	support_record_failure ();
+	printf ("error: object not loaded from the expected directory: %s\n",
+		objects[i]);
+      }
+  return 0;
+}
+
+#include <support/test-driver.c>
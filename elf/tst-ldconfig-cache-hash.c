@@ -0,0 +1,168 @@
+/* Test lookups in ld.so.cache with and without the hash index.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* The directory /tst-ldconfig-cache-hash is only listed in
+   /etc/ld.so.conf, so objects in it can only be found through
+   /etc/ld.so.cache.  The test runs ldconfig, checks that the cache has
+   a hash index, and loads an object through it.  Then it removes the
+   index, as in caches written by older versions of ldconfig, and loads
+   another object through the binary search.  Names which are not in
+   the cache must not be found either way.  */
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xdlfcn.h>
+#include <support/xunistd.h>
+
+#define CACHE_DIR "/tst-ldconfig-cache-hash"
+#define CACHE_PATH "/etc/ld.so.cache"
+
+/* The magic string of the new format in <dl-cache.h>.  */
+#define CACHE_MAGIC_NEW "glibc-ld.so.cache1.1"
+
+/* The beginning of struct cache_file_new in <dl-cache.h>.  */
+struct cache_header
+{
+  char magic[sizeof CACHE_MAGIC_NEW - 1];
+  uint32_t nlibs;
+  uint32_t len_strings;
+  uint32_t hash_offset;
+};
+
+/* Copy the module NAME from the build directory to CACHE_DIR/SONAME.  */
+static void
+copy_module (const char *name, const char *soname)
+{
+  char *from = xasprintf ("%s/elf/%s", support_objdir_root, name);
+  char *to = xasprintf ("%s/%s", CACHE_DIR, soname);
+  int in = xopen (from, O_RDONLY, 0);
+  int out = xopen (to, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+  struct stat64 st;
+  xfstat (in, &st);
+  xcopy_file_range (in, NULL, out, NULL, st.st_size, 0);
+  xclose (out);
+  xclose (in);
+  free (to);
+  free (from);
+}
+
+static void
+run_ldconfig (void)
+{
+  char *prog = xasprintf ("%s/ldconfig", support_install_rootsbindir);
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      execl (prog, prog, NULL);
+      _exit (1);
+    }
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_COMPARE (status, 0);
+  free (prog);
+}
+
+/* Remove the hash index from the cache if REMOVE, after checking that
+   it has one.  */
+static void
+check_hash_index (bool remove)
+{
+  int fd = xopen (CACHE_PATH, O_RDWR, 0);
+  struct stat64 st;
+  xfstat (fd, &st);
+  char *cache = xmmap (NULL, st.st_size, PROT_READ | PROT_WRITE,
+		       MAP_SHARED, fd);
+
+  /* The new format follows the old one in the default format of
+     ldconfig.  */
+  char *start = memmem (cache, st.st_size, CACHE_MAGIC_NEW,
+			sizeof CACHE_MAGIC_NEW - 1);
+  TEST_VERIFY_EXIT (start != NULL);
+  struct cache_header *header = (struct cache_header *) start;
+  size_t size = cache + st.st_size - start;
+  TEST_VERIFY (header->nlibs > 0);
+  TEST_VERIFY (header->hash_offset != 0);
+  TEST_VERIFY (header->hash_offset % sizeof (uint32_t) == 0);
+  TEST_VERIFY_EXIT (header->hash_offset < size);
+
+  /* The index starts with the number of buckets, and has one
+     element for each bucket and two for each entry.  */
+  uint32_t nbuckets;
+  memcpy (&nbuckets, start + header->hash_offset, sizeof (nbuckets));
+  TEST_VERIFY (nbuckets > 0);
+  TEST_VERIFY ((size - header->hash_offset) / sizeof (uint32_t)
+	       >= 2 + nbuckets + 2 * (uint64_t) header->nlibs);
+
+  if (remove)
+    {
+      off64_t length = start + header->hash_offset - cache;
+      header->hash_offset = 0;
+      xmunmap (cache, st.st_size);
+      xftruncate (fd, length);
+    }
+  else
+    xmunmap (cache, st.st_size);
+  xclose (fd);
+}
+
+/* Load NAME, which must be found, and MISSING, which must not.  */
+static void
+check_lookup (const char *name, const char *func, int expected,
+	      const char *missing)
+{
+  void *handle = xdlopen (name, RTLD_NOW);
+  int (*fptr) (void) = xdlsym (handle, func);
+  TEST_COMPARE (fptr (), expected);
+  xdlclose (handle);
+
+  TEST_VERIFY (dlopen (missing, RTLD_NOW) == NULL);
+}
+
+static int
+do_test (void)
+{
+  xmkdirp (CACHE_DIR, 0777);
+  copy_module ("tst-ldconfig-cache-hash-mod1.so",
+	       "libtst-ldconfig-cache-hash1.so.1");
+  copy_module ("tst-ldconfig-cache-hash-mod2.so",
+	       "libtst-ldconfig-cache-hash2.so.1");
+  run_ldconfig ();
+
+  /* The cache is read again for each dlopen call.  */
+  check_hash_index (false);
+  check_lookup ("libtst-ldconfig-cache-hash1.so.1", "cache_hash_mod1", 1,
+		"libtst-ldconfig-cache-hash3.so.1");
+
+  check_hash_index (true);
+  check_lookup ("libtst-ldconfig-cache-hash2.so.1", "cache_hash_mod2", 2,
+		"libtst-ldconfig-cache-hash3.so.1");
+  return 0;
+}
+
+#include <support/test-driver.c>
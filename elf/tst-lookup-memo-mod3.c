@@ -0,0 +1,39 @@
+/* Symbol lookup memo test.  Module referring to the definitions.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+extern int memo_var;
+extern int memo_protected;
+extern int memo_func (void);
+
+int *
+mod3_var_address (void)
+{
+  return &memo_var;
+}
+
+void *
+mod3_func_address (void)
+{
+  return memo_func;
+}
+
+int *
+mod3_protected_address (void)
+{
+  return &memo_protected;
+}
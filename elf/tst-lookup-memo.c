@@ -0,0 +1,51 @@
+/* Test that memoized symbol lookups bind all objects alike.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* The dynamic linker remembers the definitions found while the initial
+   objects are relocated and reuses them for the same symbol in other
+   objects.  tst-lookup-memo-mod1.so interposes the definitions of
+   tst-lookup-memo-mod2.so, and all objects must be bound to the
+   interposing definitions, except for the protected symbol in
+   tst-lookup-memo-mod2.so.  */
+
+#include <support/check.h>
+
+extern int memo_var;
+extern int memo_func (void);
+extern int *mod2_var_address (void);
+extern void *mod2_func_address (void);
+extern int *mod2_protected_address (void);
+extern int *mod3_var_address (void);
+extern void *mod3_func_address (void);
+extern int *mod3_protected_address (void);
+
+static int
+do_test (void)
+{
+  TEST_COMPARE (memo_var, 1);
+  TEST_COMPARE (memo_func (), 1);
+  TEST_VERIFY (mod2_var_address () == &memo_var);
+  TEST_VERIFY (mod3_var_address () == &memo_var);
+  TEST_VERIFY (mod2_func_address () == (void *) memo_func);
+  TEST_VERIFY (mod3_func_address () == (void *) memo_func);
+  TEST_COMPARE (*mod2_protected_address (), 2);
+  TEST_VERIFY (mod3_protected_address () == mod2_protected_address ());
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,64 @@
+/* Parallel relocation test.  Body of the modules.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Each module defines RELOC_PARALLEL_VARS variables which point to
+   themselves, and a table of their addresses, so that it needs twice
+   as many symbol relocations.  The modules do not depend on each other
+   and are relocated by different threads.  MOD is the prefix of the
+   names of the symbols of the module, and MOD_NUMBER its position in
+   the search list.  */
+
+#include <string.h>
+#include "tst-reloc-parallel.h"
+
+#define CONCAT_1(a, b) a##b
+#define CONCAT(a, b) CONCAT_1 (a, b)
+#define VAR(n) CONCAT (CONCAT (MOD, _var), n)
+
+#define DEFINE_VAR(n) void *VAR (n) = &VAR (n);
+#define VAR_ADDRESS(n) &VAR (n),
+
+RELOC_PARALLEL_LIST (DEFINE_VAR)
+
+static void *const table[] = { RELOC_PARALLEL_LIST (VAR_ADDRESS) };
+
+/* All modules define this variable.  The definition in the module which
+   comes first in the search list is used.  */
+int reloc_parallel_var = MOD_NUMBER;
+
+void *const *
+CONCAT (MOD, _table) (void)
+{
+  _Static_assert (sizeof (table) / sizeof (table[0]) == RELOC_PARALLEL_VARS,
+		  "size of table");
+  return table;
+}
+
+int *
+CONCAT (MOD, _var_address) (void)
+{
+  return &reloc_parallel_var;
+}
+
+/* strlen is an IFUNC on many targets, so its resolver is called while
+   the module is relocated.  */
+void *
+CONCAT (MOD, _strlen_address) (void)
+{
+  return strlen;
+}
@@ -0,0 +1,85 @@
+/* Test relocation of the initial objects in parallel.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* The four modules only depend on libc.so.6, so they are relocated by
+   different threads once libc.so.6 has been relocated.  Every symbol
+   relocation must be bound as if a single thread had done it.  */
+
+#include <array_length.h>
+#include <string.h>
+#include <support/check.h>
+#include "tst-reloc-parallel.h"
+
+extern int reloc_parallel_var;
+
+#define DECLARE_MOD(mod)			\
+  extern void *const *mod##_table (void);	\
+  extern int *mod##_var_address (void);		\
+  extern void *mod##_strlen_address (void);
+
+DECLARE_MOD (mod1)
+DECLARE_MOD (mod2)
+DECLARE_MOD (mod3)
+DECLARE_MOD (mod4)
+
+static const struct
+{
+  void *const *(*table) (void);
+  int *(*var_address) (void);
+  void *(*strlen_address) (void);
+} mods[] =
+  {
+#define MOD_ENTRY(mod) \
+    { mod##_table, mod##_var_address, mod##_strlen_address }
+    MOD_ENTRY (mod1),
+    MOD_ENTRY (mod2),
+    MOD_ENTRY (mod3),
+    MOD_ENTRY (mod4),
+  };
+
+static int
+do_test (void)
+{
+  /* The copy of reloc_parallel_var in the main program is initialized
+     from tst-reloc-parallel-mod1.so, which comes first in the search
+     list.  */
+  TEST_COMPARE (reloc_parallel_var, 1);
+
+  for (size_t i = 0; i < array_length (mods); ++i)
+    {
+      void *const *table = mods[i].table ();
+      for (int j = 0; j < RELOC_PARALLEL_VARS; ++j)
+	{
+	  /* Each variable points to itself, and the variables are
+	     distinct.  */
+	  TEST_VERIFY (*(void **) table[j] == table[j]);
+	  if (j > 0)
+	    TEST_VERIFY (table[j] != table[j - 1]);
+	}
+      TEST_VERIFY (mods[i].var_address () == &reloc_parallel_var);
+      TEST_VERIFY (mods[i].strlen_address () == (void *) strlen);
+    }
+
+  /* The tables of different modules refer to different variables.  */
+  TEST_VERIFY (mods[0].table ()[0] != mods[1].table ()[0]);
+  TEST_VERIFY (mods[2].table ()[0] != mods[3].table ()[0]);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,33 @@
+/* Parallel relocation test.  Definitions shared by the modules.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Call F with the 512 numbers 000 to 777, which are pasted to the
+   names of the variables.  */
+#define RELOC_PARALLEL_LIST_1(F, p) \
+  F (p##0) F (p##1) F (p##2) F (p##3) F (p##4) F (p##5) F (p##6) F (p##7)
+#define RELOC_PARALLEL_LIST_2(F, p) \
+  RELOC_PARALLEL_LIST_1 (F, p##0) RELOC_PARALLEL_LIST_1 (F, p##1) \
+  RELOC_PARALLEL_LIST_1 (F, p##2) RELOC_PARALLEL_LIST_1 (F, p##3) \
+  RELOC_PARALLEL_LIST_1 (F, p##4) RELOC_PARALLEL_LIST_1 (F, p##5) \
+  RELOC_PARALLEL_LIST_1 (F, p##6) RELOC_PARALLEL_LIST_1 (F, p##7)
+#define RELOC_PARALLEL_LIST(F) \
+  RELOC_PARALLEL_LIST_2 (F, 0) RELOC_PARALLEL_LIST_2 (F, 1) \
+  RELOC_PARALLEL_LIST_2 (F, 2) RELOC_PARALLEL_LIST_2 (F, 3) \
+  RELOC_PARALLEL_LIST_2 (F, 4) RELOC_PARALLEL_LIST_2 (F, 5) \
+  RELOC_PARALLEL_LIST_2 (F, 6) RELOC_PARALLEL_LIST_2 (F, 7)
+#define RELOC_PARALLEL_VARS 512
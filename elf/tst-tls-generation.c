@@ -0,0 +1,69 @@
+/* Test that the DTV generation is current after a TLS access.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* After a dlopen of another TLS module, the first access to a
+   variable of an already used module updates the DTV of the thread to
+   the global generation, not only to the generation of the module, so
+   that later accesses take the fast path of __tls_get_addr.  The
+   test runs with glibc.rtld.optional_static_tls=0, so that both
+   modules use dynamic TLS and dlopen does not update the DTV.  */
+
+#include <dlfcn.h>
+#include <stddef.h>
+#include <tls.h>
+#include <support/check.h>
+#include <support/xdlfcn.h>
+
+static size_t
+dtv_generation (void)
+{
+  return THREAD_DTV ()[0].counter;
+}
+
+static int
+do_test (void)
+{
+  void *small_handle = xdlopen ("tst-tls-optional-static-mod1.so",
+				RTLD_NOW);
+  int *(*small_var_address) (void)
+    = xdlsym (small_handle, "small_var_address");
+  TEST_COMPARE (*small_var_address (), 42);
+  size_t first_gen = dtv_generation ();
+
+  void *large_handle = xdlopen ("tst-tls-optional-static-mod2.so",
+				RTLD_NOW);
+  char *(*large_var_address) (void)
+    = xdlsym (large_handle, "large_var_address");
+  TEST_COMPARE (dtv_generation (), first_gen);
+
+  /* Accessing the old module brings the DTV up to date, although the
+     generation of the module is older.  */
+  TEST_COMPARE (*small_var_address (), 42);
+  size_t current_gen = dtv_generation ();
+  TEST_VERIFY (current_gen > first_gen);
+
+  /* The new module is already covered.  */
+  TEST_COMPARE (large_var_address ()[0], 1);
+  TEST_COMPARE (dtv_generation (), current_gen);
+
+  xdlclose (large_handle);
+  xdlclose (small_handle);
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,108 @@
+/* Test the placement of dlopened TLS blocks in static TLS.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* dlopen places the TLS block of tst-tls-optional-static-mod1.so in
+   the static TLS area, which is at the top of the stack block of each
+   thread, because it fits into glibc.rtld.optional_static_tls.  The
+   block of tst-tls-optional-static-mod2.so is too large and is
+   allocated by __tls_get_addr.  Both must be initialized in threads
+   which existed before dlopen and in threads created after it.  */
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <support/check.h>
+#include <support/xdlfcn.h>
+#include <support/xthread.h>
+
+static int *(*small_var_address) (void);
+static char *(*large_var_address) (void);
+static pthread_barrier_t barrier;
+
+/* Return true if ADDRESS is within the stack block of the calling
+   thread.  */
+static bool
+in_stack_block (void *address)
+{
+  pthread_attr_t attr;
+  void *stackaddr;
+  size_t stacksize;
+  TEST_COMPARE (pthread_getattr_np (pthread_self (), &attr), 0);
+  TEST_COMPARE (pthread_attr_getstack (&attr, &stackaddr, &stacksize), 0);
+  xpthread_attr_destroy (&attr);
+
+  uintptr_t addr = (uintptr_t) address;
+  uintptr_t start = (uintptr_t) stackaddr;
+  return addr >= start && addr - start < stacksize;
+}
+
+static void *
+check_thread (void *closure)
+{
+  int *small = small_var_address ();
+  TEST_COMPARE (*small, 42);
+  TEST_VERIFY (in_stack_block (small));
+  *small = 1;
+  TEST_VERIFY (small_var_address () == small);
+  TEST_COMPARE (*small, 1);
+
+  char *large = large_var_address ();
+  TEST_COMPARE (large[0], 1);
+  TEST_COMPARE (large[4095], 0);
+  TEST_VERIFY (!in_stack_block (large));
+  return NULL;
+}
+
+static void *
+early_thread (void *closure)
+{
+  xpthread_barrier_wait (&barrier);
+  return check_thread (closure);
+}
+
+static int
+do_test (void)
+{
+  xpthread_barrier_init (&barrier, NULL, 2);
+  pthread_t early = xpthread_create (NULL, early_thread, NULL);
+
+  void *small_handle = xdlopen ("tst-tls-optional-static-mod1.so",
+				RTLD_NOW);
+  void *large_handle = xdlopen ("tst-tls-optional-static-mod2.so",
+				RTLD_NOW);
+  small_var_address = xdlsym (small_handle, "small_var_address");
+  large_var_address = xdlsym (large_handle, "large_var_address");
+
+  TEST_COMPARE (*small_var_address (), 42);
+  TEST_COMPARE (large_var_address ()[0], 1);
+
+  xpthread_barrier_wait (&barrier);
+  xpthread_join (early);
+  xpthread_join (xpthread_create (NULL, check_thread, NULL));
+
+  /* The value set by the threads is not visible here.  */
+  TEST_COMPARE (*small_var_address (), 42);
+
+  xdlclose (large_handle);
+  xdlclose (small_handle);
+  xpthread_barrier_destroy (&barrier);
+  return 0;
+}
+
+#include <support/test-driver.c>
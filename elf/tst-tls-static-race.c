@@ -0,0 +1,103 @@
+/* Test a first TLS access racing with dlopen forcing static TLS.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* A thread accesses a variable of tst-tls-static-race-mod1.so for the
+   first time while the main thread dlopens tst-tls-static-race-mod2.so,
+   which uses the initial-exec model for the same variable and thus
+   forces the block into static TLS.  Either __tls_get_addr decides
+   first and the dlopen fails, or the dlopen succeeds and the thread
+   uses the static TLS block.  In both cases the thread must find the
+   initialized variable, and both models must agree on its address.
+   The test runs with glibc.rtld.optional_static_tls=0, so that dlopen
+   does not place the block in static TLS by itself.  */
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/xdlfcn.h>
+#include <support/xthread.h>
+
+enum { iterations = 200 };
+
+static int *(*race_var_address) (void);
+static int *(*race_var_address_ie) (void);
+static pthread_barrier_t barrier;
+
+static void *
+thread_func (void *closure)
+{
+  xpthread_barrier_wait (&barrier);
+  int *var = race_var_address ();
+  TEST_COMPARE (*var, 17);
+
+  /* Wait for the dlopen of the second module.  */
+  xpthread_barrier_wait (&barrier);
+  if (race_var_address_ie != NULL)
+    TEST_VERIFY (race_var_address_ie () == var);
+  TEST_VERIFY (race_var_address () == var);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  int static_count = 0;
+  int dynamic_count = 0;
+
+  xpthread_barrier_init (&barrier, NULL, 2);
+  for (int i = 0; i < iterations; ++i)
+    {
+      void *handle1 = xdlopen ("tst-tls-static-race-mod1.so", RTLD_NOW);
+      race_var_address = xdlsym (handle1, "race_var_address");
+      race_var_address_ie = NULL;
+      pthread_t thr = xpthread_create (NULL, thread_func, NULL);
+
+      xpthread_barrier_wait (&barrier);
+      void *handle2 = dlopen ("tst-tls-static-race-mod2.so", RTLD_NOW);
+      if (handle2 != NULL)
+	{
+	  race_var_address_ie = xdlsym (handle2, "race_var_address_ie");
+	  ++static_count;
+	}
+      else
+	{
+	  const char *message = dlerror ();
+	  if (strstr (message, "static TLS") == NULL)
+	    FAIL_EXIT1 ("dlopen: %s", message);
+	  ++dynamic_count;
+	}
+      xpthread_barrier_wait (&barrier);
+      xpthread_join (thr);
+
+      if (handle2 != NULL)
+	{
+	  TEST_VERIFY (race_var_address_ie () == race_var_address ());
+	  xdlclose (handle2);
+	}
+      xdlclose (handle1);
+    }
+  xpthread_barrier_destroy (&barrier);
+
+  printf ("info: static TLS: %d, dynamic TLS: %d\n",
+	  static_count, dynamic_count);
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -57,10 +57,11 @@ typedef struct _heap_info
   size_t size;   /* Current size in bytes. */
   size_t mprotect_size; /* Size in bytes that has been mprotected
                            PROT_READ|PROT_WRITE.  */
+  size_t pagesize; /* Page size used when allocating the heap.  */
   /* Make sure the following data is properly aligned, particularly
      that sizeof (heap_info) + 2 * SIZE_SZ is a multiple of
      MALLOC_ALIGNMENT. */
-  char pad[-6 * SIZE_SZ & MALLOC_ALIGN_MASK];
+  char pad[-7 * SIZE_SZ & MALLOC_ALIGN_MASK];
 } heap_info;
 
 /* Get a compile-time error if the heap_info padding is not correct
@@ -96,6 +97,10 @@ static mstate free_list;
    acquired.  */
 __libc_lock_define_initialized (static, list_lock);
 
+/* Arenas created by malloc_arena_create, linked through their next
+   member.  Protected by list_lock.  */
+static mstate private_arenas;
+
 /* Already initialized? */
 int __malloc_initialized = -1;
 
@@ -117,11 +122,29 @@ int __malloc_initialized = -1;
 
 #define arena_lock(ptr, size) do {					      \
       if (ptr)								      \
-        __libc_lock_lock (ptr->mutex);					      \
+        {								      \
+          if (__libc_lock_trylock (ptr->mutex) != 0)			      \
+            ptr = arena_contended (ptr, (size));			      \
+          else								      \
+            ++ptr->lock_acquisitions;					      \
+        }								      \
       else								      \
         ptr = arena_get2 ((size), NULL);				      \
   } while (0)
 
+/* Lock the mutex of arena AV for an allocation or deallocation, and
+   count the acquisition for malloc_arena_stats.  */
+static __always_inline void
+arena_mutex_lock (mstate av)
+{
+  if (__libc_lock_trylock (av->mutex) != 0)
+    {
+      __libc_lock_lock (av->mutex);
+      ++av->lock_contentions;
+    }
+  ++av->lock_acquisitions;
+}
+
 /* find the heap and corresponding arena for a given ptr */
 
 #define heap_for_ptr(ptr) \
@@ -158,6 +181,11 @@ __malloc_fork_lock_parent (void)
       if (ar_ptr == &main_arena)
         break;
     }
+  for (mstate ar_ptr = private_arenas; ar_ptr != NULL; ar_ptr = ar_ptr->next)
+    __libc_lock_lock (ar_ptr->mutex);
+
+  slab_fork_lock ();
+  profile_fork_lock ();
 }
 
 void
@@ -166,6 +194,11 @@ __malloc_fork_unlock_parent (void)
   if (__malloc_initialized < 1)
     return;
 
+  profile_fork_unlock ();
+  slab_fork_unlock ();
+
+  for (mstate ar_ptr = private_arenas; ar_ptr != NULL; ar_ptr = ar_ptr->next)
+    __libc_lock_unlock (ar_ptr->mutex);
   for (mstate ar_ptr = &main_arena;; )
     {
       __libc_lock_unlock (ar_ptr->mutex);
@@ -182,6 +215,15 @@ __malloc_fork_unlock_child (void)
   if (__malloc_initialized < 1)
     return;
 
+  slab_fork_reinit ();
+  profile_fork_reinit ();
+#if USE_TCACHE
+  __libc_lock_init (tcache_stats_lock);
+#endif
+#if !__HAVE_64B_ATOMICS
+  __libc_lock_init (mmap_calls_lock);
+#endif
+
   /* Push all arenas to the free list, except thread_arena, which is
      attached to the current thread.  */
   __libc_lock_init (free_list_lock);
@@ -202,6 +244,8 @@ __malloc_fork_unlock_child (void)
       if (ar_ptr == &main_arena)
         break;
     }
+  for (mstate ar_ptr = private_arenas; ar_ptr != NULL; ar_ptr = ar_ptr->next)
+    __libc_lock_init (ar_ptr->mutex);
 
   __libc_lock_init (list_lock);
 }
@@ -231,10 +275,20 @@ TUNABLE_CALLBACK_FNDECL (set_perturb_byte, int32_t)
 TUNABLE_CALLBACK_FNDECL (set_trim_threshold, size_t)
 TUNABLE_CALLBACK_FNDECL (set_arena_max, size_t)
 TUNABLE_CALLBACK_FNDECL (set_arena_test, size_t)
+TUNABLE_CALLBACK_FNDECL (set_hugetlb, size_t)
+TUNABLE_CALLBACK_FNDECL (set_remote_free, size_t)
+TUNABLE_CALLBACK_FNDECL (set_slab_max, size_t)
+TUNABLE_CALLBACK_FNDECL (set_arena_per_cpu, size_t)
+TUNABLE_CALLBACK_FNDECL (set_arena_per_node, size_t)
+TUNABLE_CALLBACK_FNDECL (set_decay_time, size_t)
+TUNABLE_CALLBACK_FNDECL (set_profile_rate, size_t)
+TUNABLE_CALLBACK_FNDECL (set_realloc_mmap_threshold, size_t)
 #if USE_TCACHE
 TUNABLE_CALLBACK_FNDECL (set_tcache_max, size_t)
 TUNABLE_CALLBACK_FNDECL (set_tcache_count, size_t)
 TUNABLE_CALLBACK_FNDECL (set_tcache_unsorted_limit, size_t)
+TUNABLE_CALLBACK_FNDECL (set_tcache_batch, size_t)
+TUNABLE_CALLBACK_FNDECL (set_tcache_count_max, size_t)
 #endif
 #else
 /* Initialization routine. */
@@ -317,11 +371,23 @@ ptmalloc_init (void)
   TUNABLE_GET (mmap_max, int32_t, TUNABLE_CALLBACK (set_mmaps_max));
   TUNABLE_GET (arena_max, size_t, TUNABLE_CALLBACK (set_arena_max));
   TUNABLE_GET (arena_test, size_t, TUNABLE_CALLBACK (set_arena_test));
+  TUNABLE_GET (hugetlb, size_t, TUNABLE_CALLBACK (set_hugetlb));
+  TUNABLE_GET (remote_free, size_t, TUNABLE_CALLBACK (set_remote_free));
+  TUNABLE_GET (slab_max, size_t, TUNABLE_CALLBACK (set_slab_max));
+  TUNABLE_GET (arena_per_cpu, size_t, TUNABLE_CALLBACK (set_arena_per_cpu));
+  TUNABLE_GET (arena_per_node, size_t, TUNABLE_CALLBACK (set_arena_per_node));
+  TUNABLE_GET (decay_time, size_t, TUNABLE_CALLBACK (set_decay_time));
+  TUNABLE_GET (profile_rate, size_t, TUNABLE_CALLBACK (set_profile_rate));
+  TUNABLE_GET (realloc_mmap_threshold, size_t,
+	       TUNABLE_CALLBACK (set_realloc_mmap_threshold));
 # if USE_TCACHE
   TUNABLE_GET (tcache_max, size_t, TUNABLE_CALLBACK (set_tcache_max));
   TUNABLE_GET (tcache_count, size_t, TUNABLE_CALLBACK (set_tcache_count));
   TUNABLE_GET (tcache_unsorted_limit, size_t,
 	       TUNABLE_CALLBACK (set_tcache_unsorted_limit));
+  TUNABLE_GET (tcache_batch, size_t, TUNABLE_CALLBACK (set_tcache_batch));
+  TUNABLE_GET (tcache_count_max, size_t,
+	       TUNABLE_CALLBACK (set_tcache_count_max));
 # endif
 #else
   const char *s = NULL;
@@ -390,12 +456,18 @@ ptmalloc_init (void)
     __malloc_check_init ();
 #endif
 
+  slab_init ();
+
 #if HAVE_MALLOC_INIT_HOOK
   void (*hook) (void) = atomic_forced_read (__malloc_initialize_hook);
   if (hook != NULL)
     (*hook)();
 #endif
   __malloc_initialized = 1;
+
+  /* This may allocate memory, so it has to come last.  */
+  if (mp_.profile_rate != 0)
+    profile_init ();
 }
 
 /* Managing heaps and arenas (for concurrent threads) */
@@ -445,12 +517,13 @@ dump_heap (heap_info *heap)
 static char *aligned_heap_area;
 
 /* Create a new heap.  size is automatically rounded up to a multiple
-   of the page size. */
+   of PAGESIZE, and MMAP_FLAGS are added to the flags of the mmap
+   calls.  If NODE is not -1, the heap is bound to that NUMA node.  */
 
 static heap_info *
-new_heap (size_t size, size_t top_pad)
+alloc_new_heap (size_t size, size_t top_pad, size_t pagesize,
+		int mmap_flags, int node)
 {
-  size_t pagesize = GLRO (dl_pagesize);
   char *p1, *p2;
   unsigned long ul;
   heap_info *h;
@@ -473,7 +546,7 @@ new_heap (size_t size, size_t top_pad)
   if (aligned_heap_area)
     {
       p2 = (char *) MMAP (aligned_heap_area, HEAP_MAX_SIZE, PROT_NONE,
-                          MAP_NORESERVE);
+                          mmap_flags | MAP_NORESERVE);
       aligned_heap_area = NULL;
       if (p2 != MAP_FAILED && ((unsigned long) p2 & (HEAP_MAX_SIZE - 1)))
         {
@@ -483,7 +556,8 @@ new_heap (size_t size, size_t top_pad)
     }
   if (p2 == MAP_FAILED)
     {
-      p1 = (char *) MMAP (0, HEAP_MAX_SIZE << 1, PROT_NONE, MAP_NORESERVE);
+      p1 = (char *) MMAP (0, HEAP_MAX_SIZE << 1, PROT_NONE,
+			  mmap_flags | MAP_NORESERVE);
       if (p1 != MAP_FAILED)
         {
           p2 = (char *) (((unsigned long) p1 + (HEAP_MAX_SIZE - 1))
@@ -499,7 +573,8 @@ new_heap (size_t size, size_t top_pad)
         {
           /* Try to take the chance that an allocation of only HEAP_MAX_SIZE
              is already aligned. */
-          p2 = (char *) MMAP (0, HEAP_MAX_SIZE, PROT_NONE, MAP_NORESERVE);
+          p2 = (char *) MMAP (0, HEAP_MAX_SIZE, PROT_NONE,
+			      mmap_flags | MAP_NORESERVE);
           if (p2 == MAP_FAILED)
             return 0;
 
@@ -510,25 +585,57 @@ new_heap (size_t size, size_t top_pad)
             }
         }
     }
+  /* Heaps are aligned to HEAP_MAX_SIZE, so the kernel can back the
+     whole reservation with transparent huge pages as it grows.  */
+  if (mmap_flags == 0)
+    madvise_thp (p2, HEAP_MAX_SIZE);
+  /* Set the policy of the whole reservation before any page is
+     touched, so that it also covers the pages added by grow_heap.  */
+  if (node >= 0)
+    malloc_bind_node (p2, HEAP_MAX_SIZE, node);
+
   if (__mprotect (p2, size, PROT_READ | PROT_WRITE) != 0)
     {
       __munmap (p2, HEAP_MAX_SIZE);
       return 0;
     }
+
   h = (heap_info *) p2;
   h->size = size;
   h->mprotect_size = size;
+  h->pagesize = pagesize;
   LIBC_PROBE (memory_heap_new, 2, h, h->size);
   return h;
 }
 
+static heap_info *
+new_heap (size_t size, size_t top_pad, int node)
+{
+  /* Try explicit huge pages first.  A heap must start at a multiple
+     of HEAP_MAX_SIZE, so larger huge pages cannot be used here.  */
+  if (__glibc_unlikely (mp_.hp_pagesize != 0
+			&& mp_.hp_pagesize <= HEAP_MAX_SIZE))
+    {
+      heap_info *h = alloc_new_heap (size, top_pad, mp_.hp_pagesize,
+				     mp_.hp_flags, node);
+      if (h != NULL)
+	return h;
+    }
+  /* With transparent huge pages, grow and shrink heaps in units of
+     whole huge pages.  */
+  size_t pagesize = GLRO (dl_pagesize);
+  if (mp_.thp_pagesize != 0 && mp_.thp_pagesize <= HEAP_MAX_SIZE)
+    pagesize = mp_.thp_pagesize;
+  return alloc_new_heap (size, top_pad, pagesize, 0, node);
+}
+
 /* Grow a heap.  size is automatically rounded up to a
    multiple of the page size. */
 
 static int
 grow_heap (heap_info *h, long diff)
 {
-  size_t pagesize = GLRO (dl_pagesize);
+  size_t pagesize = h->pagesize;
   long new_size;
 
   diff = ALIGN_UP (diff, pagesize);
@@ -594,10 +701,12 @@ static int
 heap_trim (heap_info *heap, size_t pad)
 {
   mstate ar_ptr = heap->ar_ptr;
-  unsigned long pagesz = GLRO (dl_pagesize);
   mchunkptr top_chunk = top (ar_ptr), p;
   heap_info *prev_heap;
   long new_size, top_size, top_area, extra, prev_size, misalign;
+  /* Trim in units of the page size the heap was mapped with, so that
+     huge pages are never split.  */
+  unsigned long pagesz = heap->pagesize;
 
   /* Can this heap go away completely? */
   while (top_chunk == chunk_at_offset (heap, sizeof (*heap)))
@@ -621,6 +730,7 @@ heap_trim (heap_info *heap, size_t pad)
       LIBC_PROBE (memory_heap_free, 2, heap, heap->size);
       delete_heap (heap);
       heap = prev_heap;
+      pagesz = heap->pagesize;
       if (!prev_inuse (p)) /* consolidate backward */
         {
           p = prev_chunk (p);
@@ -680,8 +790,11 @@ detach_arena (mstate replaced_arena)
     }
 }
 
+/* Allocate the first heap of a new arena, with room for SIZE bytes,
+   and set up the arena state at its start.  The heaps of the arena are
+   bound to NUMA node NODE, unless it is -1.  */
 static mstate
-_int_new_arena (size_t size)
+alloc_arena_heap (size_t size, int node)
 {
   mstate a;
   heap_info *h;
@@ -689,20 +802,21 @@ _int_new_arena (size_t size)
   unsigned long misalign;
 
   h = new_heap (size + (sizeof (*h) + sizeof (*a) + MALLOC_ALIGNMENT),
-                mp_.top_pad);
+                mp_.top_pad, node);
   if (!h)
     {
       /* Maybe size is too large to fit in a single heap.  So, just try
          to create a minimally-sized arena and let _int_malloc() attempt
          to deal with the large request via mmap_chunk().  */
-      h = new_heap (sizeof (*h) + sizeof (*a) + MALLOC_ALIGNMENT, mp_.top_pad);
+      h = new_heap (sizeof (*h) + sizeof (*a) + MALLOC_ALIGNMENT, mp_.top_pad,
+		    node);
       if (!h)
         return 0;
     }
   a = h->ar_ptr = (mstate) (h + 1);
   malloc_init_state (a);
-  a->attached_threads = 1;
   /*a->next = NULL;*/
+  a->node = node;
   a->system_mem = a->max_system_mem = h->size;
 
   /* Set up the top chunk, with proper alignment. */
@@ -714,6 +828,16 @@ _int_new_arena (size_t size)
   set_head (top (a), (((char *) h + h->size) - ptr) | PREV_INUSE);
 
   LIBC_PROBE (memory_arena_new, 2, a, size);
+  return a;
+}
+
+static mstate
+_int_new_arena (size_t size, int node)
+{
+  mstate a = alloc_arena_heap (size, node);
+  if (a == NULL)
+    return 0;
+  a->attached_threads = 1;
   mstate replaced_arena = thread_arena;
   thread_arena = a;
   __libc_lock_init (a->mutex);
@@ -744,11 +868,56 @@ _int_new_arena (size_t size)
      but this could result in a deadlock with
      __malloc_fork_lock_parent.  */
 
-  __libc_lock_lock (a->mutex);
+  arena_mutex_lock (a);
 
   return a;
 }
 
+/* Create an arena for malloc_arena_create.  It is neither attached to
+   a thread nor added to the main_arena.next list, so arena_get never
+   returns it.  */
+static mstate
+_int_new_private_arena (void)
+{
+  mstate a = alloc_arena_heap (0, -1);
+  if (a == NULL)
+    return NULL;
+  set_arena_private (a);
+  __libc_lock_init (a->mutex);
+
+  __libc_lock_lock (list_lock);
+  a->next = private_arenas;
+  private_arenas = a;
+  __libc_lock_unlock (list_lock);
+
+  return a;
+}
+
+/* Release the private arena AV and all chunks allocated from it.  All
+   of them are located in its heaps, which are unmapped from the most
+   recent one back to the first, which contains AV itself.  */
+static void
+_int_delete_private_arena (mstate av)
+{
+  __libc_lock_lock (list_lock);
+  for (mstate *p = &private_arenas; *p != NULL; p = &(*p)->next)
+    if (*p == av)
+      {
+	*p = av->next;
+	break;
+      }
+  __libc_lock_unlock (list_lock);
+
+  heap_info *heap = heap_for_ptr (top (av));
+  while (heap != NULL)
+    {
+      heap_info *prev = heap->prev;
+      LIBC_PROBE (memory_heap_free, 2, heap, heap->size);
+      delete_heap (heap);
+      heap = prev;
+    }
+}
+
 
 /* Remove an arena from free_list.  */
 static mstate
@@ -775,7 +944,7 @@ get_free_list (void)
       if (result != NULL)
         {
           LIBC_PROBE (memory_arena_reuse_free_list, 1, result);
-          __libc_lock_lock (result->mutex);
+          arena_mutex_lock (result);
 	  thread_arena = result;
         }
     }
@@ -803,6 +972,33 @@ remove_from_free_list (mstate arena)
     }
 }
 
+/* Attach ARENA to the current thread, detaching it from its previous
+   arena.  */
+static void
+attach_arena (mstate arena)
+{
+  /* Update the arena thread attachment counters.   */
+  mstate replaced_arena = thread_arena;
+  __libc_lock_lock (free_list_lock);
+  detach_arena (replaced_arena);
+
+  /* We may have picked up an arena on the free list.  We need to
+     preserve the invariant that no arena on the free list has a
+     positive attached_threads counter (otherwise,
+     arena_thread_freeres cannot use the counter to determine if the
+     arena needs to be put on the free list).  We unconditionally
+     remove the selected arena from the free list.  The list is short,
+     as arenas are only put on it when threads exit and taken off
+     again when new threads need an arena.  */
+  remove_from_free_list (arena);
+
+  ++arena->attached_threads;
+
+  __libc_lock_unlock (free_list_lock);
+
+  thread_arena = arena;
+}
+
 /* Lock and return an arena that can be reused for memory allocation.
    Avoid AVOID_ARENA as we have already failed to allocate memory in
    it and it is currently locked.  */
@@ -821,7 +1017,10 @@ reused_arena (mstate avoid_arena)
   do
     {
       if (!__libc_lock_trylock (result->mutex))
-        goto out;
+        {
+          ++result->lock_acquisitions;
+          goto out;
+        }
 
       /* FIXME: This is a data race, see _int_new_arena.  */
       result = result->next;
@@ -835,38 +1034,157 @@ reused_arena (mstate avoid_arena)
 
   /* No arena available without contention.  Wait for the next in line.  */
   LIBC_PROBE (memory_arena_reuse_wait, 3, &result->mutex, result, avoid_arena);
-  __libc_lock_lock (result->mutex);
+  arena_mutex_lock (result);
 
 out:
-  /* Attach the arena to the current thread.  */
-  {
-    /* Update the arena thread attachment counters.   */
-    mstate replaced_arena = thread_arena;
-    __libc_lock_lock (free_list_lock);
-    detach_arena (replaced_arena);
-
-    /* We may have picked up an arena on the free list.  We need to
-       preserve the invariant that no arena on the free list has a
-       positive attached_threads counter (otherwise,
-       arena_thread_freeres cannot use the counter to determine if the
-       arena needs to be put on the free list).  We unconditionally
-       remove the selected arena from the free list.  The caller of
-       reused_arena checked the free list and observed it to be empty,
-       so the list is very short.  */
-    remove_from_free_list (result);
-
-    ++result->attached_threads;
-
-    __libc_lock_unlock (free_list_lock);
-  }
+  /* Attach the arena to the current thread.  The caller of reused_arena
+     checked the free list and observed it to be empty, so the list is
+     very short.  */
+  attach_arena (result);
 
   LIBC_PROBE (memory_arena_reuse, 2, result, avoid_arena);
-  thread_arena = result;
   next_to_use = result->next;
 
   return result;
 }
 
+/* With glibc.malloc.arena_per_cpu, each CPU is assigned an arena,
+   which is created when a thread first needs it on that CPU.  The
+   table is indexed by the CPU number modulo cpu_arenas_count, which is
+   the number of online CPUs, or arena_max if that is smaller.  Entries
+   never change once set.
+
+   With glibc.malloc.arena_per_node, the table is split into
+   cpu_arenas_nodes groups of cpu_arenas_per_node entries, one group
+   for each NUMA node, and a CPU uses the group of its node.  The heaps
+   of these arenas are bound to the node, and the main arena, whose
+   memory comes from sbrk, is not part of the table.  */
+static mstate *cpu_arenas;
+static size_t cpu_arenas_count;
+static size_t cpu_arenas_nodes;
+static size_t cpu_arenas_per_node;
+
+/* Allocate cpu_arenas.  Return false on failure.  */
+static bool
+cpu_arenas_init (void)
+{
+  int nprocs = __get_nprocs ();
+  size_t count = nprocs >= 1 ? nprocs : 1;
+  if (mp_.arena_max != 0 && mp_.arena_max < count)
+    count = mp_.arena_max;
+
+  /* Every node gets at least one arena, even if that exceeds
+     arena_max.  */
+  size_t nodes = 0;
+  size_t per_node = 0;
+  if (mp_.arena_per_node)
+    {
+      int n = malloc_numa_nodes ();
+      if (n >= 1)
+	{
+	  nodes = n;
+	  per_node = (count + nodes - 1) / nodes;
+	  count = nodes * per_node;
+	}
+    }
+
+  size_t size = ALIGN_UP (count * sizeof (mstate), GLRO (dl_pagesize));
+  mstate *table = __mmap (NULL, size, PROT_READ | PROT_WRITE,
+			  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (table == MAP_FAILED)
+    return false;
+  if (nodes == 0)
+    table[0] = &main_arena;
+
+  /* Another thread may have been faster.  */
+  __libc_lock_lock (list_lock);
+  if (cpu_arenas == NULL)
+    {
+      cpu_arenas_count = count;
+      cpu_arenas_nodes = nodes;
+      cpu_arenas_per_node = per_node;
+      atomic_store_release (&cpu_arenas, table);
+      table = NULL;
+    }
+  __libc_lock_unlock (list_lock);
+  if (table != NULL)
+    __munmap (table, size);
+  return true;
+}
+
+/* Lock and return the arena of the CPU the thread is running on,
+   attaching it to the thread, or return NULL if the thread should keep
+   using CURRENT (which is not locked), or if no arena could be
+   determined.  */
+static mstate
+arena_get_cpu (size_t size, mstate current)
+{
+  int node = -1;
+  int cpu = malloc_getcpu (mp_.arena_per_node ? &node : NULL);
+  if (cpu < 0)
+    return NULL;
+
+  if (atomic_load_acquire (&cpu_arenas) == NULL && !cpu_arenas_init ())
+    return NULL;
+
+  size_t index;
+  if (node >= 0 && (size_t) node < cpu_arenas_nodes)
+    index = node * cpu_arenas_per_node + cpu % cpu_arenas_per_node;
+  else
+    {
+      index = cpu % cpu_arenas_count;
+      node = -1;
+    }
+  mstate *slot = &cpu_arenas[index];
+  mstate a = atomic_load_acquire (slot);
+  if (a != NULL && a == current)
+    return NULL;
+
+  if (a == NULL)
+    {
+      /* _int_new_arena attaches the new arena to this thread and locks
+	 it.  If another thread creates an arena for this CPU at the
+	 same time, the one of the loser stays in the list of arenas and
+	 is used by reused_arena.  */
+      catomic_increment (&narenas);
+      a = _int_new_arena (size, node);
+      if (__glibc_unlikely (a == NULL))
+	{
+	  catomic_decrement (&narenas);
+	  return NULL;
+	}
+      catomic_compare_and_exchange_bool_acq (slot, a, NULL);
+    }
+  else
+    {
+      arena_mutex_lock (a);
+      attach_arena (a);
+    }
+
+  LIBC_PROBE (memory_arena_cpu, 3, a, current, cpu);
+  return a;
+}
+
+/* Called by arena_lock if the lock of ARENA, the arena of the current
+   thread, is held by another thread.  With glibc.malloc.arena_per_cpu
+   or glibc.malloc.arena_per_node, switch to the arena of the CPU the
+   thread is running on.  Lock and return the arena to use.  */
+static mstate
+arena_contended (mstate arena, size_t size)
+{
+  if (mp_.arena_per_cpu || mp_.arena_per_node)
+    {
+      mstate a = arena_get_cpu (size, arena);
+      if (a != NULL)
+	return a;
+    }
+
+  __libc_lock_lock (arena->mutex);
+  ++arena->lock_acquisitions;
+  ++arena->lock_contentions;
+  return arena;
+}
+
 static mstate
 arena_get2 (size_t size, mstate avoid_arena)
 {
@@ -874,6 +1192,13 @@ arena_get2 (size_t size, mstate avoid_arena)
 
   static size_t narenas_limit;
 
+  if ((mp_.arena_per_cpu || mp_.arena_per_node) && avoid_arena == NULL)
+    {
+      a = arena_get_cpu (size, NULL);
+      if (a != NULL)
+	return a;
+    }
+
   a = get_free_list ();
   if (a == NULL)
     {
@@ -907,7 +1232,7 @@ arena_get2 (size_t size, mstate avoid_arena)
         {
           if (catomic_compare_and_exchange_bool_acq (&narenas, n + 1, n))
             goto repeat;
-          a = _int_new_arena (size);
+          a = _int_new_arena (size, -1);
 	  if (__glibc_unlikely (a == NULL))
             catomic_decrement (&narenas);
         }
@@ -929,7 +1254,7 @@ arena_get_retry (mstate ar_ptr, size_t bytes)
     {
       __libc_lock_unlock (ar_ptr->mutex);
       ar_ptr = &main_arena;
-      __libc_lock_lock (ar_ptr->mutex);
+      arena_mutex_lock (ar_ptr);
     }
   else
     {
@@ -947,12 +1272,22 @@ __malloc_arena_thread_freeres (void)
      the thread arena, so do this before we put the arena on the free
      list.  */
   tcache_thread_shutdown ();
+  slab_thread_shutdown ();
 
   mstate a = thread_arena;
   thread_arena = NULL;
 
   if (a != NULL)
     {
+      /* This thread no longer allocates from the arena, so free the
+	 chunks other threads have queued for it.  */
+      if (atomic_load_relaxed (&a->remote_frees) != NULL)
+	{
+	  arena_mutex_lock (a);
+	  remote_free_drain (a);
+	  __libc_lock_unlock (a->mutex);
+	}
+
       __libc_lock_lock (free_list_lock);
       /* If this was the last attached thread for this arena, put the
 	 arena on the free list.  */
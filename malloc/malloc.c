@@ -247,6 +247,12 @@
 /* For SINGLE_THREAD_P.  */
 #include <sysdep-cancel.h>
 
+/* For clock_gettime, used by malloc_decay.  */
+#include <time.h>
+
+/* For the backtraces of the heap profiler.  */
+#include <execinfo.h>
+
 /*
   Debugging:
 
@@ -300,15 +306,33 @@ __malloc_assert (const char *assertion, const char *file, unsigned int line,
 #endif
 
 #if USE_TCACHE
-/* We want 64 entries.  This is an arbitrary limit, which tunables can reduce.  */
-# define TCACHE_MAX_BINS		64
-# define MAX_TCACHE_SIZE	tidx2usize (TCACHE_MAX_BINS-1)
+/* We want 64 entries of exact sizes.  This is an arbitrary limit, which
+   tunables can reduce.  */
+# define TCACHE_SMALL_BINS	64
 
 /* Only used to pre-fill the tunables.  */
 # define tidx2usize(idx)	(((size_t) idx) * MALLOC_ALIGNMENT + MINSIZE - SIZE_SZ)
 
+/* Largest chunk size held in the exact bins, and the logarithm of the
+   power of two just below it.  */
+# define TCACHE_SMALL_MAX_CSIZE	(tidx2usize (TCACHE_SMALL_BINS - 1) + SIZE_SZ)
+# define TCACHE_SMALL_MAX_LOG	(TCACHE_SMALL_MAX_CSIZE >= 1024 ? 10 : 9)
+
+/* Larger chunks, up to 1 << TCACHE_LARGE_MAX_LOG bytes, are held in bins
+   which split each power of two into four ranges.  These bins hold
+   chunks of different sizes, and are searched first-fit.  They are
+   only used if the glibc.malloc.tcache_max tunable is raised.  */
+# define TCACHE_LARGE_MAX_LOG	18
+# define TCACHE_LARGE_BINS	(4 * (TCACHE_LARGE_MAX_LOG - TCACHE_SMALL_MAX_LOG))
+
+# define TCACHE_MAX_BINS	(TCACHE_SMALL_BINS + TCACHE_LARGE_BINS)
+# define MAX_TCACHE_SIZE	(((size_t) 1 << TCACHE_LARGE_MAX_LOG) - SIZE_SZ)
+
 /* When "x" is from chunksize().  */
-# define csize2tidx(x) (((x) - MINSIZE + MALLOC_ALIGNMENT - 1) / MALLOC_ALIGNMENT)
+# define csize2tidx(x)							      \
+  ((x) <= TCACHE_SMALL_MAX_CSIZE					      \
+   ? ((x) - MINSIZE + MALLOC_ALIGNMENT - 1) / MALLOC_ALIGNMENT		      \
+   : tcache_large_index (x))
 /* When "x" is a user-provided size.  */
 # define usize2tidx(x) csize2tidx (request2size (x))
 
@@ -316,6 +340,12 @@ __malloc_assert (const char *assertion, const char *file, unsigned int line,
    idx 0   bytes 0..24 (64-bit) or 0..12 (32-bit)
    idx 1   bytes 25..40 or 13..20
    idx 2   bytes 41..56 or 21..28
+   etc., up to idx 63 for 1032 or 1020 bytes.  After that,
+   idx 64  bytes 1033..1272 (64-bit)
+   idx 65  bytes 1273..1528
+   idx 66  bytes 1529..1784
+   idx 67  bytes 1785..2040
+   idx 68  bytes 2041..2552
    etc.  */
 
 /* This is another arbitrary limit, which tunables can change.  Each
@@ -964,6 +994,20 @@ int      __posix_memalign(void **, size_t, size_t);
 #define DEFAULT_MMAP_THRESHOLD DEFAULT_MMAP_THRESHOLD_MIN
 #endif
 
+/*
+  If mp_.realloc_mmap_threshold is nonzero, realloc moves a chunk which
+  is not mmapped and cannot grow in place into a mapping of its own
+  once it grows to at least that many bytes, so that further growth is
+  handled by mremap instead of copying.  This is independent of the
+  dynamic mmap threshold, which rises when mmapped chunks are freed and
+  then keeps large buffers in the heaps, but it is not done if the
+  mmap threshold has been set explicitly.
+*/
+
+#ifndef DEFAULT_REALLOC_MMAP_THRESHOLD
+#define DEFAULT_REALLOC_MMAP_THRESHOLD 0
+#endif
+
 /*
   M_MMAP_MAX is the maximum number of requests to simultaneously
   service using mmap. This parameter exists because
@@ -995,6 +1039,10 @@ typedef struct malloc_chunk* mchunkptr;
 
 static void*  _int_malloc(mstate, size_t);
 static void     _int_free(mstate, mchunkptr, int);
+static void     _int_free_chunk (mstate, mchunkptr, INTERNAL_SIZE_T, int);
+static void     remote_free_drain (mstate);
+static void     malloc_decay (mstate);
+static inline void decay_unlink (mstate, mchunkptr);
 static void*  _int_realloc(mstate, mchunkptr, INTERNAL_SIZE_T,
 			   INTERNAL_SIZE_T);
 static void*  _int_memalign(mstate, size_t, size_t);
@@ -1446,6 +1494,36 @@ typedef struct malloc_chunk *mbinptr;
 #define bin_index(sz) \
   ((in_smallbin_range (sz)) ? smallbin_index (sz) : largebin_index (sz))
 
+/* Marks of free chunks whose pages have been released, see
+   malloc_decay.  The mark is stored in the word following the
+   malloc_chunk fields.  A chunk in a large bin whose pages have been
+   released with MADV_DONTNEED is marked DECAY_ZEROED, and the two
+   words after the mark hold the range of pages which read as zero.
+   All chunks leave the large bins through unlink_chunk, which clears
+   the mark, so the range stays valid while the chunk is marked.  A
+   chunk marked DECAY_SEEN holds the number of the pass which marked
+   it in the word after the mark.  */
+#define DECAY_HEADER (sizeof (struct malloc_chunk) + 3 * sizeof (uintptr_t))
+#define decay_mark(p) \
+  (((uintptr_t *) ((char *) (p) + sizeof (struct malloc_chunk)))[0])
+#define decay_zeroed_start(p) \
+  (((char **) ((char *) (p) + sizeof (struct malloc_chunk)))[1])
+#define decay_zeroed_end(p) \
+  (((char **) ((char *) (p) + sizeof (struct malloc_chunk)))[2])
+#define decay_seen_pass(p) \
+  (((uintptr_t *) ((char *) (p) + sizeof (struct malloc_chunk)))[1])
+#define DECAY_SEEN ((uintptr_t) 0x9e3779b9)
+#define DECAY_PURGED ((uintptr_t) 0x7f4a7c15)
+#define DECAY_ZEROED ((uintptr_t) 0x5bd1e995)
+#define decay_key(p, kind) ((uintptr_t) (p) ^ chunksize (p) ^ (kind))
+
+/* The range of zero pages of the last marked chunk taken off a large
+   bin by unlink_chunk in this thread.  calloc resets it before calling
+   _int_malloc, and need not clear the part of the returned chunk which
+   lies in it.  */
+static __thread char *zeroed_start;
+static __thread char *zeroed_end;
+
 /* Take a chunk off a bin list.  */
 static void
 unlink_chunk (mstate av, mchunkptr p)
@@ -1459,6 +1537,7 @@ unlink_chunk (mstate av, mchunkptr p)
   if (__builtin_expect (fd->bk != p || bk->fd != p, 0))
     malloc_printerr ("corrupted double-linked list");
 
+  decay_unlink (av, p);
   fd->bk = bk;
   bk->fd = fd;
   if (!in_smallbin_range (chunksize_nomask (p)) && p->fd_nextsize != NULL)
@@ -1485,6 +1564,15 @@ unlink_chunk (mstate av, mchunkptr p)
 	  p->bk_nextsize->fd_nextsize = p->fd_nextsize;
 	}
     }
+  if (!in_smallbin_range (chunksize_nomask (p)))
+    {
+      if (__glibc_unlikely (decay_mark (p) == decay_key (p, DECAY_ZEROED)))
+	{
+	  zeroed_start = decay_zeroed_start (p);
+	  zeroed_end = decay_zeroed_end (p);
+	}
+      decay_mark (p) = 0;
+    }
 }
 
 /*
@@ -1607,6 +1695,19 @@ typedef struct malloc_chunk *mfastbinptr;
 #define set_noncontiguous(M)   ((M)->flags |= NONCONTIGUOUS_BIT)
 #define set_contiguous(M)      ((M)->flags &= ~NONCONTIGUOUS_BIT)
 
+/*
+   ARENA_PRIVATE_BIT marks arenas created by malloc_arena_create.  Such
+   an arena is never handed out by arena_get, and all of its memory
+   comes from its heaps, so that malloc_arena_destroy can release it
+   by unmapping them.  Its chunks must therefore never be served from
+   mmap or cached in a tcache.
+ */
+
+#define ARENA_PRIVATE_BIT     (4U)
+
+#define arena_is_private(M)    (((M)->flags & ARENA_PRIVATE_BIT) != 0)
+#define set_arena_private(M)   ((M)->flags |= ARENA_PRIVATE_BIT)
+
 /* Maximum size of memory handled in fastbins.  */
 static INTERNAL_SIZE_T global_max_fast;
 
@@ -1651,6 +1752,10 @@ get_max_fast (void)
    use relaxed atomic accesses.
  */
 
+/* Maximum number of chunks on the remote free list of an arena.  Once
+   the list is this long, free takes the arena lock and empties it, so
+   that the chunks are not kept if the owner of the arena is idle.  */
+#define REMOTE_FREE_MAX 64
 
 struct malloc_state
 {
@@ -1694,6 +1799,37 @@ struct malloc_state
   /* Memory allocated from the system in this arena.  */
   INTERNAL_SIZE_T system_mem;
   INTERNAL_SIZE_T max_system_mem;
+
+  /* NUMA node to which the heaps of this arena are bound, or -1.  */
+  int node;
+
+  /* Chunks freed by threads not attached to this arena, linked through
+     their fd fields.  Pushed to without holding the mutex and drained
+     by remote_free_drain with the mutex held.  remote_free_count is
+     the approximate length of the list; it may be briefly negative
+     while a push races with a drain.  */
+  mchunkptr remote_frees;
+  int remote_free_count;
+
+  /* State of malloc_decay: operations since the last check of the
+     clock, the next bin to visit in the current pass (0 if no pass is
+     in progress), the next chunk to visit in that bin (NULL to start
+     at its last chunk), the number of the current or last pass, and
+     the time at which the next pass starts.  */
+  unsigned int decay_ticks;
+  int decay_bin;
+  mchunkptr decay_cursor;
+  uintptr_t decay_pass;
+  uint64_t decay_next;
+
+  /* Memory of free chunks released to the system by malloc_decay.  */
+  INTERNAL_SIZE_T purged_mem;
+
+  /* Number of times the mutex was acquired by arena_mutex_lock and
+     arena_lock, and how many of those had to wait for another
+     thread.  Protected by the mutex.  */
+  uint64_t lock_acquisitions;
+  uint64_t lock_contentions;
 };
 
 struct malloc_par
@@ -1717,19 +1853,63 @@ struct malloc_par
   /* Statistics */
   INTERNAL_SIZE_T mmapped_mem;
   INTERNAL_SIZE_T max_mmapped_mem;
+  /* Number of mmap, munmap and mremap calls for chunks.  Use
+     count_mmap_call to increment them.  */
+  uint64_t mmap_calls;
+  uint64_t munmap_calls;
+  uint64_t mremap_calls;
 
   /* First address handed out by MORECORE/sbrk.  */
   char *sbrk_base;
 
+  /* Size of a transparent huge page, if malloc should advise the
+     kernel to use them, or 0.  */
+  INTERNAL_SIZE_T thp_pagesize;
+  /* If not 0, mmap large chunks and heaps in multiples of hp_pagesize
+     with the additional flags hp_flags (e.g. MAP_HUGETLB).  */
+  INTERNAL_SIZE_T hp_pagesize;
+  int hp_flags;
+
+  /* Free chunks of other threads' arenas through their remote free
+     lists.  */
+  int remote_free;
+
+  /* Largest request served by the slab allocator, or 0.  */
+  size_t slab_max;
+
+  /* Assign arenas to CPUs rather than to threads.  */
+  int arena_per_cpu;
+
+  /* Likewise, but group the arenas by NUMA node and bind their heaps
+     to the node.  */
+  int arena_per_node;
+
+  /* Release the pages of chunks which have been free for this many
+     milliseconds, or 0.  */
+  size_t decay_time;
+
+  /* Average number of bytes allocated between two samples of the heap
+     profiler, or 0.  */
+  size_t profile_rate;
+
+  /* Size from which realloc moves growing chunks to mmap, or 0.  */
+  size_t realloc_mmap_threshold;
+
 #if USE_TCACHE
   /* Maximum number of buckets to use.  */
   size_t tcache_bins;
   size_t tcache_max_bytes;
   /* Maximum number of chunks in each bucket.  */
   size_t tcache_count;
+  /* Upper limit for the adaptive number of chunks in a bin.  */
+  size_t tcache_count_max;
   /* Maximum number of chunks to remove from the unsorted list, which
      aren't used to prefill the cache.  */
   size_t tcache_unsorted_limit;
+  /* Number of chunks moved between a tcache bin and the arena under a
+     single acquisition of the arena lock, or 0 to move one at a
+     time.  */
+  size_t tcache_batch;
 #endif
 };
 
@@ -1743,6 +1923,7 @@ static struct malloc_state main_arena =
 {
   .mutex = _LIBC_LOCK_INITIALIZER,
   .next = &main_arena,
+  .node = -1,
   .attached_threads = 1
 };
 
@@ -1767,17 +1948,49 @@ static struct malloc_par mp_ =
   .n_mmaps_max = DEFAULT_MMAP_MAX,
   .mmap_threshold = DEFAULT_MMAP_THRESHOLD,
   .trim_threshold = DEFAULT_TRIM_THRESHOLD,
+  .realloc_mmap_threshold = DEFAULT_REALLOC_MMAP_THRESHOLD,
 #define NARENAS_FROM_NCORES(n) ((n) * (sizeof (long) == 4 ? 2 : 8))
   .arena_test = NARENAS_FROM_NCORES (1)
 #if USE_TCACHE
   ,
   .tcache_count = TCACHE_FILL_COUNT,
-  .tcache_bins = TCACHE_MAX_BINS,
-  .tcache_max_bytes = tidx2usize (TCACHE_MAX_BINS-1),
+  .tcache_bins = TCACHE_SMALL_BINS,
+  .tcache_max_bytes = tidx2usize (TCACHE_SMALL_BINS-1),
   .tcache_unsorted_limit = 0 /* No limit.  */
 #endif
 };
 
+/* Increment the counter of mp_ for the system call CALL (mmap, munmap
+   or mremap).  Without 64-bit atomics, the counters are protected by
+   mmap_calls_lock, so that no update is lost and malloc_global_stats
+   does not read a torn value.  The lock is only taken next to a system
+   call, which costs far more.  */
+#if __HAVE_64B_ATOMICS
+# define count_mmap_call(call) \
+  atomic_fetch_add_relaxed (&mp_.call##_calls, 1)
+#else
+__libc_lock_define_initialized (static, mmap_calls_lock);
+# define count_mmap_call(call)			\
+  do						\
+    {						\
+      __libc_lock_lock (mmap_calls_lock);	\
+      ++mp_.call##_calls;			\
+      __libc_lock_unlock (mmap_calls_lock);	\
+    }						\
+  while (0)
+#endif
+
+#if USE_TCACHE
+/* Tcache hits and misses of all threads, as far as they have been
+   added by tcache_stats_flush.  */
+static struct
+{
+  uint64_t hits;
+  uint64_t misses;
+} tcache_stats_total;
+__libc_lock_define_initialized (static, tcache_stats_lock);
+#endif
+
 /*
    Initialize a malloc_state struct.
 
@@ -1809,6 +2022,119 @@ malloc_init_state (mstate av)
   av->top = initial_top (av);
 }
 
+/*
+   Advise the kernel that the region starting at P of SIZE bytes is a
+   good candidate for transparent huge pages.  Does nothing unless THP
+   usage was requested with the glibc.malloc.hugetlb tunable.
+ */
+
+static inline void
+madvise_thp (void *p, INTERNAL_SIZE_T size)
+{
+#ifdef MADV_HUGEPAGE
+  /* Do not consider areas smaller than a huge page or if the tunable is
+     not active.  */
+  if (mp_.thp_pagesize == 0 || size < mp_.thp_pagesize)
+    return;
+
+  /* Linux requires page alignment for madvise.  */
+  char *q = PTR_ALIGN_DOWN ((char *) p, GLRO (dl_pagesize));
+  size += (char *) p - q;
+
+  __madvise (q, size, MADV_HUGEPAGE);
+#endif
+}
+
+/*
+   Releasing the pages of free chunks
+
+   If glibc.malloc.decay_time is set, malloc_decay periodically walks
+   the unsorted and large bins of an arena and releases the pages of
+   chunks which have been free for at least that long.  Each pass marks
+   the chunks it finds, in words following the malloc_chunk fields,
+   with the number of the pass.  The pages of chunks which carry the
+   mark of an earlier pass are released; passes start at least
+   decay_time apart, so these chunks have been free since before that.
+   The mark incorporates the address and size of the chunk, so chunks
+   which have been allocated, split or coalesced since are treated as
+   new.
+
+   A pass is spread over several calls of malloc_decay, each of which
+   resumes at the chunk where the previous one stopped; decay_unlink
+   moves that position along when the chunk is taken off its bin.  A
+   call visits at most DECAY_BUDGET chunks, whether it marks, releases
+   or skips them, plus the headers of the empty bins, so the time it
+   holds the arena lock does not depend on the number of free chunks.
+ */
+
+/* Number of locked operations on an arena between checks of the
+   clock.  */
+#define DECAY_TICKS 256
+
+/* Maximum number of chunks visited by one call of malloc_decay.  */
+#define DECAY_BUDGET 256
+
+/* Release the pages of the free chunk P which lie entirely after the
+   first HEADER bytes of the chunk, using page size PS and madvise
+   advice ADVICE.  Return the number of bytes released, which is 0 if
+   madvise fails.  */
+static size_t
+release_chunk_pages (mchunkptr p, size_t header, size_t ps, int advice)
+{
+  INTERNAL_SIZE_T size = chunksize (p);
+  const size_t psm1 = ps - 1;
+
+  if (size <= psm1 + header)
+    return 0;
+
+  /* See whether the chunk contains at least one unused page.  */
+  char *paligned_mem = (char *) (((uintptr_t) p + header + psm1) & ~psm1);
+
+  assert ((char *) chunk2mem (p) + 4 * SIZE_SZ <= paligned_mem);
+  assert ((char *) p + size > paligned_mem);
+
+  /* This is the size we could potentially free.  */
+  size -= paligned_mem - (char *) p;
+  if (size <= psm1)
+    return 0;
+
+#if MALLOC_DEBUG
+  /* When debugging we simulate destroying the memory content.  */
+  memset (paligned_mem, 0x89, size & ~psm1);
+#endif
+  if (__madvise (paligned_mem, size & ~psm1, advice) != 0)
+    return 0;
+  return size & ~psm1;
+}
+
+/* Mark the free chunk P in a large bin, of which RELEASED bytes have
+   been released by release_chunk_pages (P, DECAY_HEADER, PS,
+   MADV_DONTNEED).  */
+static void
+mark_chunk_zeroed (mchunkptr p, size_t ps, size_t released)
+{
+  char *start = (char *) ALIGN_UP ((uintptr_t) p + DECAY_HEADER, ps);
+  decay_zeroed_start (p) = start;
+  decay_zeroed_end (p) = start + released;
+  decay_mark (p) = decay_key (p, DECAY_ZEROED);
+}
+
+/* Called when P is taken off its bin.  If malloc_decay was to resume
+   at P, make it resume at the chunk it would have visited next.  */
+static inline void
+decay_unlink (mstate av, mchunkptr p)
+{
+  if (__glibc_unlikely (p == av->decay_cursor))
+    av->decay_cursor = p->bk;
+}
+
+static __always_inline void
+malloc_decay_tick (mstate av)
+{
+  if (++av->decay_ticks >= DECAY_TICKS)
+    malloc_decay (av);
+}
+
 /*
    Other internal utilities operating on mstates
  */
@@ -1880,6 +2206,12 @@ free_perturb (char *p, size_t n)
 
 #include <stap-probe.h>
 
+/* ------------------- Slab allocator for small requests ------------------- */
+#include "slab.c"
+
+/* ------------------------- Sampling heap profiler ------------------------- */
+#include "profile.c"
+
 /* ------------------- Support for multiple arenas -------------------- */
 #include "arena.c"
 
@@ -2243,6 +2575,93 @@ do_check_malloc_state (mstate av)
 
 /* ----------- Routines dealing with system allocation -------------- */
 
+/*
+   sysmalloc_mmap directly maps a chunk of at least NB bytes, rounded up
+   to a multiple of PAGESIZE, with the additional mmap flags
+   EXTRA_FLAGS.  It returns the user pointer of the new chunk, or
+   MAP_FAILED if the mapping could not be created.
+ */
+
+static void *
+sysmalloc_mmap (INTERNAL_SIZE_T nb, size_t pagesize, int extra_flags,
+		mstate av)
+{
+  long int size;
+
+  /*
+     Round up size to nearest page.  For mmapped chunks, the overhead
+     is one SIZE_SZ unit larger than for normal chunks, because there
+     is no following chunk whose prev_size field could be used.
+
+     See the front_misalign handling below, for glibc there is no
+     need for further alignments unless we have have high alignment.
+   */
+  if (MALLOC_ALIGNMENT == 2 * SIZE_SZ)
+    size = ALIGN_UP (nb + SIZE_SZ, pagesize);
+  else
+    size = ALIGN_UP (nb + SIZE_SZ + MALLOC_ALIGN_MASK, pagesize);
+
+  /* Don't try if size wraps around 0.  */
+  if ((unsigned long) (size) <= (unsigned long) (nb))
+    return MAP_FAILED;
+
+  char *mm = (char *) MMAP (0, size, PROT_READ | PROT_WRITE, extra_flags);
+  if (mm == MAP_FAILED)
+    return mm;
+
+  if (extra_flags == 0)
+    madvise_thp (mm, size);
+
+  /*
+     The offset to the start of the mmapped region is stored in the
+     prev_size field of the chunk.  This allows us to adjust returned
+     start address to meet alignment requirements here and in memalign(),
+     and still be able to compute proper address argument for later
+     munmap in free() and realloc().
+   */
+
+  INTERNAL_SIZE_T front_misalign; /* unusable bytes at front of new space */
+  mchunkptr p;                    /* the allocated/returned chunk */
+
+  if (MALLOC_ALIGNMENT == 2 * SIZE_SZ)
+    {
+      /* For glibc, chunk2mem increases the address by 2*SIZE_SZ and
+	 MALLOC_ALIGN_MASK is 2*SIZE_SZ-1.  Each mmap'ed area is page
+	 aligned and therefore definitely MALLOC_ALIGN_MASK-aligned.  */
+      assert (((INTERNAL_SIZE_T) chunk2mem (mm) & MALLOC_ALIGN_MASK) == 0);
+      front_misalign = 0;
+    }
+  else
+    front_misalign = (INTERNAL_SIZE_T) chunk2mem (mm) & MALLOC_ALIGN_MASK;
+
+  if (front_misalign > 0)
+    {
+      ptrdiff_t correction = MALLOC_ALIGNMENT - front_misalign;
+      p = (mchunkptr) (mm + correction);
+      set_prev_size (p, correction);
+      set_head (p, (size - correction) | IS_MMAPPED);
+    }
+  else
+    {
+      p = (mchunkptr) mm;
+      set_prev_size (p, 0);
+      set_head (p, size | IS_MMAPPED);
+    }
+
+  /* update statistics */
+  int new = atomic_exchange_and_add (&mp_.n_mmaps, 1) + 1;
+  atomic_max (&mp_.max_n_mmaps, new);
+  count_mmap_call (mmap);
+
+  unsigned long sum;
+  sum = atomic_exchange_and_add (&mp_.mmapped_mem, size) + size;
+  atomic_max (&mp_.max_mmapped_mem, sum);
+
+  check_chunk (av, p);
+
+  return chunk2mem (p);
+}
+
 /*
    sysmalloc handles malloc cases requiring more memory from the system.
    On entry, it is assumed that av->top does not have enough
@@ -2285,78 +2704,23 @@ sysmalloc (INTERNAL_SIZE_T nb, mstate av)
 
   if (av == NULL
       || ((unsigned long) (nb) >= (unsigned long) (mp_.mmap_threshold)
-	  && (mp_.n_mmaps < mp_.n_mmaps_max)))
+	  && (mp_.n_mmaps < mp_.n_mmaps_max)
+	  && !arena_is_private (av)))
     {
-      char *mm;           /* return value from mmap call*/
+      char *mm;
 
-    try_mmap:
-      /*
-         Round up size to nearest page.  For mmapped chunks, the overhead
-         is one SIZE_SZ unit larger than for normal chunks, because there
-         is no following chunk whose prev_size field could be used.
-
-         See the front_misalign handling below, for glibc there is no
-         need for further alignments unless we have have high alignment.
-       */
-      if (MALLOC_ALIGNMENT == 2 * SIZE_SZ)
-        size = ALIGN_UP (nb + SIZE_SZ, pagesize);
-      else
-        size = ALIGN_UP (nb + SIZE_SZ + MALLOC_ALIGN_MASK, pagesize);
+      /* There is no need to advise the kernel about transparent huge
+	 pages if the request is backed by hugetlbfs pages directly.  */
+      if (mp_.hp_pagesize > 0 && nb >= mp_.hp_pagesize)
+	{
+	  mm = sysmalloc_mmap (nb, mp_.hp_pagesize, mp_.hp_flags, av);
+	  if (mm != MAP_FAILED)
+	    return mm;
+	}
+      mm = sysmalloc_mmap (nb, pagesize, 0, av);
+      if (mm != MAP_FAILED)
+	return mm;
       tried_mmap = true;
-
-      /* Don't try if size wraps around 0 */
-      if ((unsigned long) (size) > (unsigned long) (nb))
-        {
-          mm = (char *) (MMAP (0, size, PROT_READ | PROT_WRITE, 0));
-
-          if (mm != MAP_FAILED)
-            {
-              /*
-                 The offset to the start of the mmapped region is stored
-                 in the prev_size field of the chunk. This allows us to adjust
-                 returned start address to meet alignment requirements here
-                 and in memalign(), and still be able to compute proper
-                 address argument for later munmap in free() and realloc().
-               */
-
-              if (MALLOC_ALIGNMENT == 2 * SIZE_SZ)
-                {
-                  /* For glibc, chunk2mem increases the address by 2*SIZE_SZ and
-                     MALLOC_ALIGN_MASK is 2*SIZE_SZ-1.  Each mmap'ed area is page
-                     aligned and therefore definitely MALLOC_ALIGN_MASK-aligned.  */
-                  assert (((INTERNAL_SIZE_T) chunk2mem (mm) & MALLOC_ALIGN_MASK) == 0);
-                  front_misalign = 0;
-                }
-              else
-                front_misalign = (INTERNAL_SIZE_T) chunk2mem (mm) & MALLOC_ALIGN_MASK;
-              if (front_misalign > 0)
-                {
-                  correction = MALLOC_ALIGNMENT - front_misalign;
-                  p = (mchunkptr) (mm + correction);
-		  set_prev_size (p, correction);
-                  set_head (p, (size - correction) | IS_MMAPPED);
-                }
-              else
-                {
-                  p = (mchunkptr) mm;
-		  set_prev_size (p, 0);
-                  set_head (p, size | IS_MMAPPED);
-                }
-
-              /* update statistics */
-
-              int new = atomic_exchange_and_add (&mp_.n_mmaps, 1) + 1;
-              atomic_max (&mp_.max_n_mmaps, new);
-
-              unsigned long sum;
-              sum = atomic_exchange_and_add (&mp_.mmapped_mem, size) + size;
-              atomic_max (&mp_.max_mmapped_mem, sum);
-
-              check_chunk (av, p);
-
-              return chunk2mem (p);
-            }
-        }
     }
 
   /* There are no usable arenas and mmap also failed.  */
@@ -2400,7 +2764,8 @@ sysmalloc (INTERNAL_SIZE_T nb, mstate av)
           set_head (old_top, (((char *) old_heap + old_heap->size) - (char *) old_top)
                     | PREV_INUSE);
         }
-      else if ((heap = new_heap (nb + (MINSIZE + sizeof (*heap)), mp_.top_pad)))
+      else if ((heap = new_heap (nb + (MINSIZE + sizeof (*heap)), mp_.top_pad,
+				       av->node)))
         {
           /* Use a newly allocated heap.  */
           heap->ar_ptr = av;
@@ -2430,9 +2795,14 @@ sysmalloc (INTERNAL_SIZE_T nb, mstate av)
               set_foot (old_top, (old_size + 2 * SIZE_SZ));
             }
         }
-      else if (!tried_mmap)
-        /* We can at least try to use to mmap memory.  */
-        goto try_mmap;
+      else if (!tried_mmap && !arena_is_private (av))
+	{
+	  /* We can at least try to use to mmap memory.  If new_heap
+	     failed, it is unlikely that huge pages are available.  */
+	  char *mm = sysmalloc_mmap (nb, pagesize, 0, av);
+	  if (mm != MAP_FAILED)
+	    return mm;
+	}
     }
   else     /* av == main_arena */
 
@@ -2455,9 +2825,24 @@ sysmalloc (INTERNAL_SIZE_T nb, mstate av)
          with whole-page arguments.  And if MORECORE is contiguous and
          this is not first time through, this preserves page-alignment of
          previous calls. Otherwise, we correct to page-align below.
+
+         If transparent huge pages are in use, extend the break up to
+         the next huge page boundary instead, so that the kernel can back
+         the whole region with huge pages.
        */
 
-      size = ALIGN_UP (size, pagesize);
+#ifdef MADV_HUGEPAGE
+      if (__glibc_unlikely (mp_.thp_pagesize != 0))
+	{
+	  /* Defined in brk.c.  */
+	  extern void *__curbrk;
+	  uintptr_t top = ALIGN_UP ((uintptr_t) __curbrk + size,
+				    mp_.thp_pagesize);
+	  size = top - (uintptr_t) __curbrk;
+	}
+      else
+#endif
+	size = ALIGN_UP (size, pagesize);
 
       /*
          Don't try to call MORECORE if argument is so big as to appear
@@ -2473,6 +2858,8 @@ sysmalloc (INTERNAL_SIZE_T nb, mstate av)
 
       if (brk != (char *) (MORECORE_FAILURE))
         {
+	  madvise_thp (brk, size);
+
           /* Call the `morecore' hook if necessary.  */
           void (*hook) (void) = atomic_forced_read (__after_morecore_hook);
           if (__builtin_expect (hook != NULL, 0))
@@ -2504,6 +2891,8 @@ sysmalloc (INTERNAL_SIZE_T nb, mstate av)
 
               if (mbrk != MAP_FAILED)
                 {
+		  madvise_thp (mbrk, size);
+
                   /* We do not need, and cannot use, another sbrk call to find end */
                   brk = mbrk;
                   snd_brk = brk + size;
@@ -2748,7 +3137,12 @@ systrim (size_t pad, mstate av)
   size_t pagesize;
   long top_area;
 
-  pagesize = GLRO (dl_pagesize);
+  /* Do not split a transparent huge page when trimming: keep the break
+     aligned to the huge page size used to extend it.  */
+  if (__glibc_unlikely (mp_.thp_pagesize != 0))
+    pagesize = mp_.thp_pagesize;
+  else
+    pagesize = GLRO (dl_pagesize);
   top_size = chunksize (av->top);
 
   top_area = top_size - MINSIZE - 1;
@@ -2829,8 +3223,12 @@ munmap_chunk (mchunkptr p)
       || __glibc_unlikely (!powerof2 (mem & (pagesize - 1))))
     malloc_printerr ("munmap_chunk(): invalid pointer");
 
+  if (__glibc_unlikely (mp_.profile_rate != 0) && profile_chunk_p (p))
+    profile_forget (p);
+
   atomic_decrement (&mp_.n_mmaps);
   atomic_add (&mp_.mmapped_mem, -total_size);
+  count_mmap_call (munmap);
 
   /* If munmap failed the process virtual memory address space is in a
      bad shape.  Just leave the block hanging around, the process will
@@ -2857,6 +3255,11 @@ mremap_chunk (mchunkptr p, size_t new_size)
       || __glibc_unlikely (!powerof2 (mem & (pagesize - 1))))
     malloc_printerr("mremap_chunk(): invalid pointer");
 
+  /* The record of a sampled allocation is linked into the list of
+     samples and must not move.  The caller copies the chunk instead.  */
+  if (__glibc_unlikely (mp_.profile_rate != 0) && profile_chunk_p (p))
+    return 0;
+
   /* Note the extra SIZE_SZ overhead as in mmap_chunk(). */
   new_size = ALIGN_UP (new_size + offset + SIZE_SZ, pagesize);
 
@@ -2870,6 +3273,7 @@ mremap_chunk (mchunkptr p, size_t new_size)
   if (cp == MAP_FAILED)
     return 0;
 
+  count_mmap_call (mremap);
   p = (mchunkptr) (cp + offset);
 
   assert (aligned_OK (chunk2mem (p)));
@@ -2889,6 +3293,15 @@ mremap_chunk (mchunkptr p, size_t new_size)
 
 #if USE_TCACHE
 
+/* Return the index of the large tcache bin for chunk size CSIZE.  */
+static __always_inline size_t
+tcache_large_index (size_t csize)
+{
+  unsigned int log = (sizeof (long) * 8 - 1) - __builtin_clzl (csize - 1);
+  return (TCACHE_SMALL_BINS + (log - TCACHE_SMALL_MAX_LOG) * 4
+	  + (((csize - 1) >> (log - 2)) & 3));
+}
+
 /* We overlay this structure on the user-data portion of a chunk when
    the chunk is stored in the per-thread cache.  */
 typedef struct tcache_entry
@@ -2906,12 +3319,62 @@ typedef struct tcache_entry
 typedef struct tcache_perthread_struct
 {
   uint16_t counts[TCACHE_MAX_BINS];
+  /* Maximum number of chunks in each bin.  Adapted at run time if the
+     glibc.malloc.tcache_count_max tunable is set.  */
+  uint16_t limits[TCACHE_MAX_BINS];
+  /* Set when an allocation found the bin empty.  */
+  uint8_t drained[TCACHE_MAX_BINS];
   tcache_entry *entries[TCACHE_MAX_BINS];
 } tcache_perthread_struct;
 
 static __thread bool tcache_shutting_down = false;
 static __thread tcache_perthread_struct *tcache = NULL;
 
+/* True if chunks of arena AV may be put into the tcache of the current
+   thread.  */
+#define tcache_for_arena(av) (tcache != NULL && !arena_is_private (av))
+
+/* Allocations of the current thread which were served by the tcache
+   (hits) or found the tcache bin empty (misses), and the parts of
+   those counts which have already been added to tcache_stats_total.
+   This happens after every TCACHE_STATS_FLUSH hits or misses, and on
+   thread exit.  */
+static __thread struct
+{
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t flushed_hits;
+  uint64_t flushed_misses;
+} tcache_stats;
+
+#define TCACHE_STATS_FLUSH 4096
+
+static void
+tcache_stats_flush (void)
+{
+  __libc_lock_lock (tcache_stats_lock);
+  tcache_stats_total.hits += tcache_stats.hits - tcache_stats.flushed_hits;
+  tcache_stats_total.misses
+    += tcache_stats.misses - tcache_stats.flushed_misses;
+  __libc_lock_unlock (tcache_stats_lock);
+  tcache_stats.flushed_hits = tcache_stats.hits;
+  tcache_stats.flushed_misses = tcache_stats.misses;
+}
+
+static __always_inline void
+tcache_count_hit (void)
+{
+  if (__glibc_unlikely (++tcache_stats.hits % TCACHE_STATS_FLUSH == 0))
+    tcache_stats_flush ();
+}
+
+static __always_inline void
+tcache_count_miss (void)
+{
+  if (__glibc_unlikely (++tcache_stats.misses % TCACHE_STATS_FLUSH == 0))
+    tcache_stats_flush ();
+}
+
 /* Caller must ensure that we know tc_idx is valid and there's room
    for more chunks.  */
 static __always_inline void
@@ -2940,6 +3403,153 @@ tcache_get (size_t tc_idx)
   return (void *) e;
 }
 
+/* Remove and return one of the first TCACHE_ALIGNED_SCAN chunks in
+   tcache bin TC_IDX whose user pointer is a multiple of ALIGNMENT and
+   which holds at least NB bytes, or return NULL if there is none.
+   Memory freed after an aligned allocation is usually still aligned
+   when the same request comes again, so this avoids splitting a larger
+   chunk in _int_memalign.  */
+#define TCACHE_ALIGNED_SCAN 8
+
+static void *
+tcache_get_aligned (size_t tc_idx, size_t alignment, INTERNAL_SIZE_T nb)
+{
+  tcache_entry **ep = &tcache->entries[tc_idx];
+  for (int n = 0; *ep != NULL && n < TCACHE_ALIGNED_SCAN;
+       ep = &(*ep)->next, n++)
+    {
+      tcache_entry *e = *ep;
+      if (((uintptr_t) e & (alignment - 1)) == 0
+	  && chunksize (mem2chunk (e)) >= nb)
+	{
+	  *ep = e->next;
+	  --(tcache->counts[tc_idx]);
+	  e->key = NULL;
+	  return (void *) e;
+	}
+    }
+  return NULL;
+}
+
+/* Remove and return the first chunk of at least NB bytes from the large
+   tcache bin TC_IDX, or return NULL if there is none.  */
+static void *
+tcache_get_large (size_t tc_idx, INTERNAL_SIZE_T nb)
+{
+  for (tcache_entry **ep = &tcache->entries[tc_idx]; *ep != NULL;
+       ep = &(*ep)->next)
+    {
+      tcache_entry *e = *ep;
+      if (chunksize (mem2chunk (e)) >= nb)
+	{
+	  *ep = e->next;
+	  --(tcache->counts[tc_idx]);
+	  e->key = NULL;
+	  return (void *) e;
+	}
+    }
+  return NULL;
+}
+
+/* Called when a chunk is freed into the full tcache bin TC_IDX.  If the
+   bin has run empty since it last filled up, allocations of this size
+   are frequent enough to warrant a larger bin, so double its limit up
+   to mp_.tcache_count_max.  Otherwise, halve the limit down to
+   mp_.tcache_count.  Return true if the chunk now fits into the
+   bin.  */
+static bool
+tcache_adapt (size_t tc_idx)
+{
+  size_t limit = tcache->limits[tc_idx];
+
+  if (mp_.tcache_count_max <= mp_.tcache_count)
+    return false;
+
+  if (tcache->drained[tc_idx])
+    {
+      tcache->drained[tc_idx] = 0;
+      limit = MIN (2 * limit, mp_.tcache_count_max);
+    }
+  else
+    limit = MAX (limit / 2, mp_.tcache_count);
+  tcache->limits[tc_idx] = limit;
+
+  return tcache->counts[tc_idx] < limit;
+}
+
+/* Return chunk P of SIZE bytes, which did not fit into the full tcache
+   bin TC_IDX, to arena AV together with up to mp_.tcache_batch chunks
+   taken from that bin.  Chunks belonging to AV are freed under a single
+   acquisition of its lock; chunks from other arenas, which are rare,
+   are freed one at a time afterwards.  */
+static void
+tcache_flush (mstate av, mchunkptr p, INTERNAL_SIZE_T size, size_t tc_idx,
+	      int have_lock)
+{
+  tcache_entry *foreign = NULL;
+
+  if (!have_lock)
+    arena_mutex_lock (av);
+
+  _int_free_chunk (av, p, size, 1);
+  for (size_t n = mp_.tcache_batch;
+       n > 0 && tcache->counts[tc_idx] > 0; n--)
+    {
+      tcache_entry *e = tcache_get (tc_idx);
+      mchunkptr c = mem2chunk (e);
+      if (arena_for_chunk (c) == av)
+	_int_free_chunk (av, c, chunksize (c), 1);
+      else
+	{
+	  e->next = foreign;
+	  foreign = e;
+	}
+    }
+
+  if (!have_lock)
+    __libc_lock_unlock (av->mutex);
+
+  while (foreign != NULL)
+    {
+      mchunkptr c = mem2chunk (foreign);
+      foreign = foreign->next;
+      _int_free_chunk (arena_for_chunk (c), c, chunksize (c), 0);
+    }
+}
+
+/* After allocating a chunk of NB bytes from the top chunk of arena AV,
+   carve up to mp_.tcache_batch further chunks of the same size from it
+   into the corresponding tcache bin, so that the following allocations
+   of this size do not need the arena lock.  The caller must hold the
+   arena lock.  */
+static void
+tcache_refill_from_top (mstate av, INTERNAL_SIZE_T nb)
+{
+  size_t tc_idx = csize2tidx (nb);
+
+  if (mp_.tcache_batch == 0 || !tcache_for_arena (av)
+      || tc_idx >= mp_.tcache_bins)
+    return;
+
+  mchunkptr top = av->top;
+  INTERNAL_SIZE_T size = chunksize (top);
+  for (size_t n = mp_.tcache_batch;
+       n > 0 && tcache->counts[tc_idx] < tcache->limits[tc_idx]
+       && (unsigned long) (size) >= (unsigned long) (nb + MINSIZE);
+       n--)
+    {
+      mchunkptr victim = top;
+      top = chunk_at_offset (victim, nb);
+      size -= nb;
+      set_head (victim, nb | PREV_INUSE
+		| (av != &main_arena ? NON_MAIN_ARENA : 0));
+      set_head (top, size | PREV_INUSE);
+      check_malloced_chunk (av, victim, nb);
+      tcache_put (victim, tc_idx);
+    }
+  av->top = top;
+}
+
 static void
 tcache_thread_shutdown (void)
 {
@@ -2949,6 +3559,8 @@ tcache_thread_shutdown (void)
   if (!tcache)
     return;
 
+  tcache_stats_flush ();
+
   /* Disable the tcache and prevent it from being reinitialized.  */
   tcache = NULL;
   tcache_shutting_down = true;
@@ -2999,6 +3611,8 @@ tcache_init(void)
     {
       tcache = (tcache_perthread_struct *) victim;
       memset (tcache, 0, sizeof (tcache_perthread_struct));
+      for (size_t i = 0; i < TCACHE_MAX_BINS; ++i)
+	tcache->limits[i] = mp_.tcache_count;
     }
 
 }
@@ -3031,6 +3645,21 @@ __libc_malloc (size_t bytes)
     = atomic_forced_read (__malloc_hook);
   if (__builtin_expect (hook != NULL, 0))
     return (*hook)(bytes, RETURN_ADDRESS (0));
+
+  if (__glibc_unlikely (mp_.profile_rate != 0) && profile_sample_p (bytes))
+    {
+      victim = profile_malloc (bytes);
+      if (victim != NULL)
+	return victim;
+    }
+
+  if (slab_eligible (bytes))
+    {
+      victim = slab_alloc (bytes);
+      if (victim != NULL)
+	return victim;
+    }
+
 #if USE_TCACHE
   /* int_free also calls request2size, be careful to not pad twice.  */
   size_t tbytes;
@@ -3045,10 +3674,27 @@ __libc_malloc (size_t bytes)
 
   DIAG_PUSH_NEEDS_COMMENT;
   if (tc_idx < mp_.tcache_bins
-      && tcache
-      && tcache->counts[tc_idx] > 0)
+      && tcache)
     {
-      return tcache_get (tc_idx);
+      if (tc_idx < TCACHE_SMALL_BINS)
+	{
+	  if (tcache->counts[tc_idx] > 0)
+	    {
+	      tcache_count_hit ();
+	      return tcache_get (tc_idx);
+	    }
+	}
+      else
+	{
+	  victim = tcache_get_large (tc_idx, tbytes);
+	  if (victim != NULL)
+	    {
+	      tcache_count_hit ();
+	      return victim;
+	    }
+	}
+      tcache->drained[tc_idx] = 1;
+      tcache_count_miss ();
     }
   DIAG_POP_NEEDS_COMMENT;
 #endif
@@ -3099,6 +3745,12 @@ __libc_free (void *mem)
   if (mem == 0)                              /* free(0) has no effect */
     return;
 
+  if (slab_owns (mem))
+    {
+      slab_free (mem);
+      return;
+    }
+
   p = mem2chunk (mem);
 
   if (chunk_is_mmapped (p))                       /* release mmapped memory. */
@@ -3126,13 +3778,63 @@ __libc_free (void *mem)
 }
 libc_hidden_def (__libc_free)
 
-void *
-__libc_realloc (void *oldmem, size_t bytes)
+/* Free MEM, which was allocated with a request for SIZE bytes.  If the
+   chunk goes to a tcache bin which has room, the bin is derived from
+   SIZE, and the chunk header is only compared with the expected size
+   instead of being decoded.  Everything else, including a size which
+   does not match, is left to __libc_free.  */
+void
+__libc_free_sized (void *mem, size_t size)
 {
-  mstate ar_ptr;
-  INTERNAL_SIZE_T nb;         /* padded request size */
-
-  void *newp;             /* chunk to return */
+#if USE_TCACHE
+  INTERNAL_SIZE_T nb;
+
+  if (__glibc_likely (atomic_forced_read (__free_hook) == NULL)
+      && tcache != NULL && mem != NULL && !slab_owns (mem)
+      && checked_request2size (size, &nb))
+    {
+      size_t tc_idx = csize2tidx (nb);
+      mchunkptr p = mem2chunk (mem);
+      tcache_entry *e = mem;
+
+      /* This also rejects mmapped chunks.  A key equal to TCACHE may
+	 indicate a double free, which _int_free checks.  */
+      if (tc_idx < TCACHE_SMALL_BINS && tc_idx < mp_.tcache_bins
+	  && (chunksize_nomask (p) & ~(PREV_INUSE | NON_MAIN_ARENA)) == nb
+	  && !misaligned_chunk (p)
+	  && (chunk_main_arena (p) || !arena_is_private (arena_for_chunk (p)))
+	  && e->key != tcache
+	  && tcache->counts[tc_idx] < tcache->limits[tc_idx])
+	{
+	  tcache_put (p, tc_idx);
+	  return;
+	}
+    }
+#endif
+
+  __libc_free (mem);
+}
+
+/* Free MEM, which was allocated with a request for SIZE bytes aligned
+   to ALIGNMENT.  Chunks returned by _int_memalign may be larger than
+   SIZE requires, so only chunks from plain allocations take the fast
+   path.  */
+void
+__libc_free_aligned_sized (void *mem, size_t alignment, size_t size)
+{
+  if (alignment <= MALLOC_ALIGNMENT)
+    __libc_free_sized (mem, size);
+  else
+    __libc_free (mem);
+}
+
+void *
+__libc_realloc (void *oldmem, size_t bytes)
+{
+  mstate ar_ptr;
+  INTERNAL_SIZE_T nb;         /* padded request size */
+
+  void *newp;             /* chunk to return */
 
   void *(*hook) (void *, size_t, const void *) =
     atomic_forced_read (__realloc_hook);
@@ -3150,6 +3852,9 @@ __libc_realloc (void *oldmem, size_t bytes)
   if (oldmem == 0)
     return __libc_malloc (bytes);
 
+  if (slab_owns (oldmem))
+    return slab_realloc (oldmem, bytes);
+
   /* chunk corresponding to oldmem */
   const mchunkptr oldp = mem2chunk (oldmem);
   /* its size */
@@ -3230,7 +3935,7 @@ __libc_realloc (void *oldmem, size_t bytes)
       return newp;
     }
 
-  __libc_lock_lock (ar_ptr->mutex);
+  arena_mutex_lock (ar_ptr);
 
   newp = _int_realloc (ar_ptr, oldp, oldsize, nb);
 
@@ -3238,7 +3943,8 @@ __libc_realloc (void *oldmem, size_t bytes)
   assert (!newp || chunk_is_mmapped (mem2chunk (newp)) ||
           ar_ptr == arena_for_chunk (mem2chunk (newp)));
 
-  if (newp == NULL)
+  /* Blocks of a private arena stay in it.  */
+  if (newp == NULL && !arena_is_private (ar_ptr))
     {
       /* Try harder to allocate memory in other arenas.  */
       LIBC_PROBE (memory_realloc_retry, 2, bytes, oldmem);
@@ -3298,6 +4004,24 @@ _mid_memalign (size_t alignment, size_t bytes, void *address)
       alignment = a;
     }
 
+#if USE_TCACHE
+  size_t tbytes;
+  if (checked_request2size (bytes, &tbytes))
+    {
+      size_t tc_idx = csize2tidx (tbytes);
+
+      MAYBE_INIT_TCACHE ();
+
+      if (tc_idx < mp_.tcache_bins && tcache != NULL
+	  && tcache->counts[tc_idx] > 0)
+	{
+	  p = tcache_get_aligned (tc_idx, alignment, tbytes);
+	  if (p != NULL)
+	    return p;
+	}
+    }
+#endif
+
   if (SINGLE_THREAD_P)
     {
       p = _int_memalign (&main_arena, alignment, bytes);
@@ -3361,6 +4085,60 @@ __libc_pvalloc (size_t bytes)
   return _mid_memalign (pagesize, rounded_bytes, address);
 }
 
+/* Clearing at least this many bytes, calloc releases the whole pages
+   instead of writing them.  Large blocks are often touched only in
+   part, and the kernel supplies zero pages on demand.  */
+#define CALLOC_RELEASE_MIN (1024 * 1024)
+
+/* Clear the SIZE bytes at MEM, which belong to a chunk that calloc
+   returns.  */
+static void
+calloc_clear_range (char *mem, size_t size)
+{
+  if (size >= CALLOC_RELEASE_MIN)
+    {
+      const size_t ps = (mp_.thp_pagesize != 0
+			 ? mp_.thp_pagesize : GLRO (dl_pagesize));
+      char *start = PTR_ALIGN_UP (mem, ps);
+      char *end = PTR_ALIGN_DOWN (mem + size, ps);
+      int saved_errno = errno;
+      if (start < end && __madvise (start, end - start, MADV_DONTNEED) == 0)
+	{
+	  memset (mem, 0, start - mem);
+	  memset (end, 0, mem + size - end);
+	  return;
+	}
+      __set_errno (saved_errno);
+    }
+  memset (mem, 0, size);
+}
+
+/* Clear the first CLEARSIZE bytes of MEM, which calloc is about to
+   return, except for the zero pages recorded by unlink_chunk while
+   _int_malloc allocated MEM.  */
+static void *
+calloc_clear (void *mem, size_t clearsize)
+{
+  char *start = mem;
+  char *end = start + clearsize;
+  char *zstart = zeroed_start;
+  char *zend = zeroed_end;
+
+  /* The pages are still zero unless perturbation wrote to them.  A
+     range starting before MEM is ignored, because chunk headers may
+     have been written into it.  */
+  if (perturb_byte == 0 && zstart >= start && zstart < end)
+    {
+      if (zend > end)
+	zend = end;
+      calloc_clear_range (start, zstart - start);
+      calloc_clear_range (zend, end - zend);
+    }
+  else
+    calloc_clear_range (start, clearsize);
+  return mem;
+}
+
 void *
 __libc_calloc (size_t n, size_t elem_size)
 {
@@ -3391,6 +4169,21 @@ __libc_calloc (size_t n, size_t elem_size)
       return memset (mem, 0, sz);
     }
 
+  /* Sampled allocations are freshly mapped and need no clearing.  */
+  if (__glibc_unlikely (mp_.profile_rate != 0) && profile_sample_p (sz))
+    {
+      mem = profile_malloc (sz);
+      if (mem != NULL)
+	return mem;
+    }
+
+  if (slab_eligible (sz))
+    {
+      mem = slab_alloc (sz);
+      if (mem != NULL)
+	return memset (mem, 0, sz);
+    }
+
   MAYBE_INIT_TCACHE ();
 
   if (SINGLE_THREAD_P)
@@ -3425,6 +4218,7 @@ __libc_calloc (size_t n, size_t elem_size)
       oldtop = 0;
       oldtopsize = 0;
     }
+  zeroed_start = zeroed_end = NULL;
   mem = _int_malloc (av, sz);
 
   assert (!mem || chunk_is_mmapped (mem2chunk (mem)) ||
@@ -3436,6 +4230,7 @@ __libc_calloc (size_t n, size_t elem_size)
 	{
 	  LIBC_PROBE (memory_calloc_retry, 1, sz);
 	  av = arena_get_retry (av, sz);
+	  zeroed_start = zeroed_end = NULL;
 	  mem = _int_malloc (av, sz);
 	}
 
@@ -3477,7 +4272,7 @@ __libc_calloc (size_t n, size_t elem_size)
   assert (nclears >= 3);
 
   if (nclears > 9)
-    return memset (d, 0, clearsize);
+    return calloc_clear (d, clearsize);
 
   else
     {
@@ -3558,6 +4353,13 @@ _int_malloc (mstate av, size_t bytes)
       return p;
     }
 
+  /* Take back the chunks other threads have freed meanwhile.  */
+  if (atomic_load_relaxed (&av->remote_frees) != NULL)
+    remote_free_drain (av);
+
+  if (__glibc_unlikely (mp_.decay_time != 0))
+    malloc_decay_tick (av);
+
   /*
      If the size qualifies as a fastbin, first check corresponding bin.
      This code is safe to execute even if av is not yet initialized, so we
@@ -3597,12 +4399,12 @@ _int_malloc (mstate av, size_t bytes)
 	      /* While we're here, if we see other chunks of the same size,
 		 stash them in the tcache.  */
 	      size_t tc_idx = csize2tidx (nb);
-	      if (tcache && tc_idx < mp_.tcache_bins)
+	      if (tcache_for_arena (av) && tc_idx < mp_.tcache_bins)
 		{
 		  mchunkptr tc_victim;
 
 		  /* While bin not empty and tcache not full, copy chunks.  */
-		  while (tcache->counts[tc_idx] < mp_.tcache_count
+		  while (tcache->counts[tc_idx] < tcache->limits[tc_idx]
 			 && (tc_victim = *fb) != NULL)
 		    {
 		      if (SINGLE_THREAD_P)
@@ -3653,12 +4455,12 @@ _int_malloc (mstate av, size_t bytes)
 	  /* While we're here, if we see other chunks of the same size,
 	     stash them in the tcache.  */
 	  size_t tc_idx = csize2tidx (nb);
-	  if (tcache && tc_idx < mp_.tcache_bins)
+	  if (tcache_for_arena (av) && tc_idx < mp_.tcache_bins)
 	    {
 	      mchunkptr tc_victim;
 
 	      /* While bin not empty and tcache not full, copy chunks over.  */
-	      while (tcache->counts[tc_idx] < mp_.tcache_count
+	      while (tcache->counts[tc_idx] < tcache->limits[tc_idx]
 		     && (tc_victim = last (bin)) != bin)
 		{
 		  if (tc_victim != 0)
@@ -3715,7 +4517,7 @@ _int_malloc (mstate av, size_t bytes)
 #if USE_TCACHE
   INTERNAL_SIZE_T tcache_nb = 0;
   size_t tc_idx = csize2tidx (nb);
-  if (tcache && tc_idx < mp_.tcache_bins)
+  if (tcache_for_arena (av) && tc_idx < mp_.tcache_bins)
     tcache_nb = nb;
   int return_cached = 0;
 
@@ -3761,6 +4563,7 @@ _int_malloc (mstate av, size_t bytes)
               /* split and reattach remainder */
               remainder_size = size - nb;
               remainder = chunk_at_offset (victim, nb);
+              decay_unlink (av, victim);
               unsorted_chunks (av)->bk = unsorted_chunks (av)->fd = remainder;
               av->last_remainder = remainder;
               remainder->bk = remainder->fd = unsorted_chunks (av);
@@ -3784,6 +4587,7 @@ _int_malloc (mstate av, size_t bytes)
           /* remove from unsorted list */
           if (__glibc_unlikely (bck->fd != victim))
             malloc_printerr ("malloc(): corrupted unsorted chunks 3");
+          decay_unlink (av, victim);
           unsorted_chunks (av)->bk = bck;
           bck->fd = unsorted_chunks (av);
 
@@ -3798,7 +4602,7 @@ _int_malloc (mstate av, size_t bytes)
 	      /* Fill cache first, return to user only if cache fills.
 		 We may return one of these chunks later.  */
 	      if (tcache_nb
-		  && tcache->counts[tc_idx] < mp_.tcache_count)
+		  && tcache->counts[tc_idx] < tcache->limits[tc_idx])
 		{
 		  tcache_put (victim, tc_idx);
 		  return_cached = 1;
@@ -4116,6 +4920,9 @@ _int_malloc (mstate av, size_t bytes)
           set_head (remainder, remainder_size | PREV_INUSE);
 
           check_malloced_chunk (av, victim, nb);
+#if USE_TCACHE
+          tcache_refill_from_top (av, nb);
+#endif
           void *p = chunk2mem (victim);
           alloc_perturb (p, bytes);
           return p;
@@ -4154,13 +4961,6 @@ static void
 _int_free (mstate av, mchunkptr p, int have_lock)
 {
   INTERNAL_SIZE_T size;        /* its size */
-  mfastbinptr *fb;             /* associated fastbin */
-  mchunkptr nextchunk;         /* next contiguous chunk */
-  INTERNAL_SIZE_T nextsize;    /* its size */
-  int nextinuse;               /* true if nextchunk is used */
-  INTERNAL_SIZE_T prevsize;    /* size of previous contiguous chunk */
-  mchunkptr bck;               /* misc temp for linking */
-  mchunkptr fwd;               /* misc temp for linking */
 
   size = chunksize (p);
 
@@ -4181,7 +4981,7 @@ _int_free (mstate av, mchunkptr p, int have_lock)
 #if USE_TCACHE
   {
     size_t tc_idx = csize2tidx (size);
-    if (tcache != NULL && tc_idx < mp_.tcache_bins)
+    if (tcache_for_arena (av) && tc_idx < mp_.tcache_bins)
       {
 	/* Check to see if it's already in the tcache.  */
 	tcache_entry *e = (tcache_entry *) chunk2mem (p);
@@ -4203,15 +5003,72 @@ _int_free (mstate av, mchunkptr p, int have_lock)
 	       few cycles, but don't abort.  */
 	  }
 
-	if (tcache->counts[tc_idx] < mp_.tcache_count)
+	if (tcache->counts[tc_idx] < tcache->limits[tc_idx]
+	    || tcache_adapt (tc_idx))
 	  {
 	    tcache_put (p, tc_idx);
 	    return;
 	  }
+
+	/* The bin is full.  Return a batch of its chunks together with
+	   P to the arena, so that the next frees of this size do not
+	   need the arena lock.  */
+	if (mp_.tcache_batch > 0 && tcache->limits[tc_idx] > 0)
+	  {
+	    tcache_flush (av, p, size, tc_idx, have_lock);
+	    return;
+	  }
       }
   }
 #endif
 
+  _int_free_chunk (av, p, size, have_lock);
+}
+
+/* Free chunk P of SIZE bytes to arena AV, bypassing the tcache.  The
+   chunk has already been checked by _int_free.  If HAVE_LOCK is false,
+   the arena lock is acquired as needed.  */
+static void
+_int_free_chunk (mstate av, mchunkptr p, INTERNAL_SIZE_T size, int have_lock)
+{
+  mfastbinptr *fb;             /* associated fastbin */
+  mchunkptr nextchunk;         /* next contiguous chunk */
+  INTERNAL_SIZE_T nextsize;    /* its size */
+  int nextinuse;               /* true if nextchunk is used */
+  INTERNAL_SIZE_T prevsize;    /* size of previous contiguous chunk */
+  mchunkptr bck;               /* misc temp for linking */
+  mchunkptr fwd;               /* misc temp for linking */
+
+  /*
+    If the chunk belongs to the arena of another thread and would need
+    its lock, push it onto the remote free list of that arena instead.
+    The owner frees it when it next allocates from the arena.  If the
+    owner is idle and the list has grown to REMOTE_FREE_MAX chunks, take
+    the lock below and free the whole list instead.
+  */
+
+  if (mp_.remote_free && !have_lock && !SINGLE_THREAD_P
+      && av != thread_arena
+      && (unsigned long) (size) > (unsigned long) (get_max_fast ())
+      && atomic_load_relaxed (&av->remote_free_count) < REMOTE_FREE_MAX)
+    {
+      mchunkptr old = atomic_load_relaxed (&av->remote_frees);
+      mchunkptr old2;
+      do
+	{
+	  /* Check that the top of the list is not the chunk we are
+	     freeing, as for the fastbins.  */
+	  if (__glibc_unlikely (old == p))
+	    malloc_printerr ("double free or corruption (remote)");
+	  p->fd = old2 = old;
+	}
+      while ((old = catomic_compare_and_exchange_val_rel (&av->remote_frees,
+							   p, old2))
+	     != old2);
+      atomic_fetch_add_relaxed (&av->remote_free_count, 1);
+      return;
+    }
+
   /*
     If eligible, place chunk on a fastbin so it can be found
     and used quickly in malloc.
@@ -4239,7 +5096,7 @@ _int_free (mstate av, mchunkptr p, int have_lock)
 	   getting the lock.  */
 	if (!have_lock)
 	  {
-	    __libc_lock_lock (av->mutex);
+	    arena_mutex_lock (av);
 	    fail = (chunksize_nomask (chunk_at_offset (p, size)) <= 2 * SIZE_SZ
 		    || chunksize (chunk_at_offset (p, size)) >= av->system_mem);
 	    __libc_lock_unlock (av->mutex);
@@ -4299,7 +5156,13 @@ _int_free (mstate av, mchunkptr p, int have_lock)
       have_lock = true;
 
     if (!have_lock)
-      __libc_lock_lock (av->mutex);
+      {
+	arena_mutex_lock (av);
+	/* The list may be full because the owner of the arena does not
+	   allocate any more.  */
+	if (atomic_load_relaxed (&av->remote_frees) != NULL)
+	  remote_free_drain (av);
+      }
 
     nextchunk = chunk_at_offset(p, size);
 
@@ -4415,6 +5278,9 @@ _int_free (mstate av, mchunkptr p, int have_lock)
       }
     }
 
+    if (__glibc_unlikely (mp_.decay_time != 0))
+      malloc_decay_tick (av);
+
     if (!have_lock)
       __libc_lock_unlock (av->mutex);
   }
@@ -4427,6 +5293,116 @@ _int_free (mstate av, mchunkptr p, int have_lock)
   }
 }
 
+/* Advance the decay pass of arena AV, starting a new one if
+   mp_.decay_time has elapsed since the previous one started.  The
+   caller must hold the arena lock.  */
+static void
+malloc_decay (mstate av)
+{
+  av->decay_ticks = 0;
+
+  if (av->decay_bin == 0)
+    {
+      struct timespec ts;
+      __clock_gettime (CLOCK_MONOTONIC, &ts);
+      uint64_t now = ts.tv_sec * (uint64_t) 1000000000 + ts.tv_nsec;
+      if (now < av->decay_next)
+	return;
+      av->decay_next = now + mp_.decay_time * (uint64_t) 1000000;
+      av->decay_bin = 1;
+      ++av->decay_pass;
+    }
+
+  /* Release only whole transparent huge pages if they are in use, so
+     that the remaining ones are not broken up.  */
+  const size_t ps = (mp_.thp_pagesize != 0
+		     ? mp_.thp_pagesize : GLRO (dl_pagesize));
+  const size_t header = DECAY_HEADER;
+  int psindex = bin_index (ps);
+  int budget = DECAY_BUDGET;
+  int saved_errno = errno;
+#ifdef MADV_FREE
+  static int advice = MADV_FREE;
+#else
+  const int advice = MADV_DONTNEED;
+#endif
+
+  for (int i = av->decay_bin; i < NBINS; i = i == 1 ? psindex : i + 1)
+    {
+      mbinptr bin = bin_at (av, i);
+      mchunkptr p = av->decay_cursor != NULL ? av->decay_cursor : last (bin);
+      av->decay_bin = i;
+
+      for (; p != bin; p = p->bk)
+	{
+	  if (--budget < 0)
+	    {
+	      av->decay_cursor = p;
+	      goto out;
+	    }
+
+	  if (chunksize (p) <= ps + header)
+	    continue;
+
+	  uintptr_t mark = decay_mark (p);
+	  if (mark == decay_key (p, DECAY_PURGED)
+	      || mark == decay_key (p, DECAY_ZEROED))
+	    continue;
+	  bool seen = mark == decay_key (p, DECAY_SEEN);
+	  if (seen && decay_seen_pass (p) == av->decay_pass)
+	    continue;
+
+	  if (!seen)
+	    {
+	      decay_mark (p) = decay_key (p, DECAY_SEEN);
+	      decay_seen_pass (p) = av->decay_pass;
+	      continue;
+	    }
+
+	  __set_errno (0);
+	  size_t released = release_chunk_pages (p, header, ps, advice);
+#ifdef MADV_FREE
+	  /* MADV_FREE needs Linux 4.5.  */
+	  if (released == 0 && advice == MADV_FREE && errno == EINVAL)
+	    {
+	      advice = MADV_DONTNEED;
+	      released = release_chunk_pages (p, header, ps, advice);
+	    }
+#endif
+	  /* If madvise failed, try again in the next pass.  */
+	  if (released == 0 && errno != 0)
+	    continue;
+	  av->purged_mem += released;
+	  if (released != 0 && advice == MADV_DONTNEED && i != 1)
+	    mark_chunk_zeroed (p, ps, released);
+	  else
+	    decay_mark (p) = decay_key (p, DECAY_PURGED);
+	}
+      av->decay_cursor = NULL;
+    }
+  av->decay_bin = 0;
+
+ out:
+  __set_errno (saved_errno);
+}
+
+/* Free the chunks on the remote free list of arena AV.  The caller
+   must hold the arena lock.  */
+static void
+remote_free_drain (mstate av)
+{
+  mchunkptr p = atomic_exchange_acq (&av->remote_frees, NULL);
+  int count = 0;
+  while (p != NULL)
+    {
+      mchunkptr nextp = p->fd;
+      _int_free_chunk (av, p, chunksize (p), 1);
+      p = nextp;
+      ++count;
+    }
+  atomic_fetch_add_relaxed (&av->remote_free_count, -count);
+}
+
 /*
   ------------------------- malloc_consolidate -------------------------
 
@@ -4597,6 +5573,26 @@ _int_realloc(mstate av, mchunkptr oldp, INTERNAL_SIZE_T oldsize,
       /* allocate, copy, free */
       else
         {
+#if HAVE_MREMAP
+	  /* Move a large growing chunk into a mapping of its own.  This
+	     costs no more than the copy below, and mremap_chunk handles
+	     further growth.  */
+	  if (mp_.realloc_mmap_threshold != 0
+	      && nb >= mp_.realloc_mmap_threshold
+	      && !mp_.no_dyn_threshold
+	      && mp_.n_mmaps < mp_.n_mmaps_max
+	      && !arena_is_private (av))
+	    {
+	      char *mm = sysmalloc_mmap (nb, GLRO (dl_pagesize), 0, av);
+	      if (mm != MAP_FAILED)
+		{
+		  memcpy (mm, chunk2mem (oldp), oldsize - SIZE_SZ);
+		  _int_free (av, oldp, 1);
+		  return mm;
+		}
+	    }
+#endif
+
           newmem = _int_malloc (av, nb - MALLOC_ALIGN_MASK);
           if (newmem == 0)
             return 0; /* propagate failure */
@@ -4754,11 +5750,14 @@ static int
 mtrim (mstate av, size_t pad)
 {
   /* Ensure all blocks are consolidated.  */
+  remote_free_drain (av);
   malloc_consolidate (av);
 
-  const size_t ps = GLRO (dl_pagesize);
+  /* Release only whole transparent huge pages if they are in use, so
+     that the remaining ones are not broken up.  */
+  const size_t ps = (mp_.thp_pagesize != 0
+		     ? mp_.thp_pagesize : GLRO (dl_pagesize));
   int psindex = bin_index (ps);
-  const size_t psm1 = ps - 1;
 
   int result = 0;
   for (int i = 1; i < NBINS; ++i)
@@ -4767,35 +5766,17 @@ mtrim (mstate av, size_t pad)
         mbinptr bin = bin_at (av, i);
 
         for (mchunkptr p = last (bin); p != bin; p = p->bk)
-          {
-            INTERNAL_SIZE_T size = chunksize (p);
-
-            if (size > psm1 + sizeof (struct malloc_chunk))
-              {
-                /* See whether the chunk contains at least one unused page.  */
-                char *paligned_mem = (char *) (((uintptr_t) p
-                                                + sizeof (struct malloc_chunk)
-                                                + psm1) & ~psm1);
-
-                assert ((char *) chunk2mem (p) + 4 * SIZE_SZ <= paligned_mem);
-                assert ((char *) p + size > paligned_mem);
-
-                /* This is the size we could potentially free.  */
-                size -= paligned_mem - (char *) p;
-
-                if (size > psm1)
-                  {
-#if MALLOC_DEBUG
-                    /* When debugging we simulate destroying the memory
-                       content.  */
-                    memset (paligned_mem, 0x89, size & ~psm1);
-#endif
-                    __madvise (paligned_mem, size & ~psm1, MADV_DONTNEED);
-
-                    result = 1;
-                  }
-              }
-          }
+	  {
+	    size_t released = release_chunk_pages (p, DECAY_HEADER, ps,
+						   MADV_DONTNEED);
+	    if (released != 0)
+	      {
+		result = 1;
+		/* calloc need not clear these pages.  */
+		if (i != 1)
+		  mark_chunk_zeroed (p, ps, released);
+	      }
+	  }
       }
 
 #ifndef MORECORE_CANNOT_TRIM
@@ -4864,6 +5845,9 @@ __malloc_usable_size (void *m)
 {
   size_t result;
 
+  if (slab_owns (m))
+    return slab_usable_size (m);
+
   result = musable (m);
   return result;
 }
@@ -4884,6 +5868,7 @@ int_mallinfo (mstate av, struct mallinfo *m)
   int nblocks;
   int nfastblocks;
 
+  remote_free_drain (av);
   check_malloc_state (av);
 
   /* Account for top */
@@ -4982,6 +5967,9 @@ __malloc_stats (void)
       fprintf (stderr, "Arena %d:\n", i);
       fprintf (stderr, "system bytes     = %10u\n", (unsigned int) mi.arena);
       fprintf (stderr, "in use bytes     = %10u\n", (unsigned int) mi.uordblks);
+      if (mp_.decay_time != 0)
+	fprintf (stderr, "purged bytes     = %10lu\n",
+		 (unsigned long) ar_ptr->purged_mem);
 #if MALLOC_DEBUG > 1
       if (i > 0)
         dump_heap (heap_for_ptr (top (ar_ptr)));
@@ -5082,6 +6070,82 @@ do_set_arena_max (size_t value)
   return 1;
 }
 
+static __always_inline int
+do_set_hugetlb (size_t value)
+{
+  if (value == 1)
+    mp_.thp_pagesize = malloc_thp_pagesize ();
+  else if (value >= 2)
+    {
+      size_t pagesize = 0;
+      int flags = 0;
+      malloc_hugepage_config (value == 2 ? 0 : value, &pagesize, &flags);
+      mp_.hp_pagesize = pagesize;
+      mp_.hp_flags = flags;
+    }
+  return 1;
+}
+
+static __always_inline int
+do_set_remote_free (size_t value)
+{
+  LIBC_PROBE (memory_tunable_remote_free, 2, value, mp_.remote_free);
+  mp_.remote_free = value != 0;
+  return 1;
+}
+
+static __always_inline int
+do_set_decay_time (size_t value)
+{
+  LIBC_PROBE (memory_tunable_decay_time, 2, value, mp_.decay_time);
+  mp_.decay_time = value;
+  return 1;
+}
+
+static __always_inline int
+do_set_arena_per_cpu (size_t value)
+{
+  LIBC_PROBE (memory_tunable_arena_per_cpu, 2, value, mp_.arena_per_cpu);
+  mp_.arena_per_cpu = value != 0;
+  return 1;
+}
+
+static __always_inline int
+do_set_arena_per_node (size_t value)
+{
+  LIBC_PROBE (memory_tunable_arena_per_node, 2, value, mp_.arena_per_node);
+  mp_.arena_per_node = value != 0;
+  return 1;
+}
+
+static __always_inline int
+do_set_slab_max (size_t value)
+{
+  if (value <= SLAB_MAX_SIZE)
+    {
+      LIBC_PROBE (memory_tunable_slab_max, 2, value, mp_.slab_max);
+      mp_.slab_max = value;
+    }
+  return 1;
+}
+
+static __always_inline int
+do_set_profile_rate (size_t value)
+{
+  LIBC_PROBE (memory_tunable_profile_rate, 2, value, mp_.profile_rate);
+  mp_.profile_rate = value;
+  return 1;
+}
+
+static __always_inline int
+do_set_realloc_mmap_threshold (size_t value)
+{
+  LIBC_PROBE (memory_tunable_realloc_mmap_threshold, 2, value,
+	      mp_.realloc_mmap_threshold);
+  mp_.realloc_mmap_threshold = value;
+  return 1;
+}
+
 #if USE_TCACHE
 static __always_inline int
 do_set_tcache_max (size_t value)
@@ -5106,6 +6170,18 @@ do_set_tcache_count (size_t value)
   return 1;
 }
 
+static __always_inline int
+do_set_tcache_count_max (size_t value)
+{
+  if (value <= MAX_TCACHE_COUNT)
+    {
+      LIBC_PROBE (memory_tunable_tcache_count_max, 2, value,
+		  mp_.tcache_count_max);
+      mp_.tcache_count_max = value;
+    }
+  return 1;
+}
+
 static __always_inline int
 do_set_tcache_unsorted_limit (size_t value)
 {
@@ -5113,6 +6189,17 @@ do_set_tcache_unsorted_limit (size_t value)
   mp_.tcache_unsorted_limit = value;
   return 1;
 }
+
+static __always_inline int
+do_set_tcache_batch (size_t value)
+{
+  if (value <= MAX_TCACHE_COUNT)
+    {
+      LIBC_PROBE (memory_tunable_tcache_batch, 2, value, mp_.tcache_batch);
+      mp_.tcache_batch = value;
+    }
+  return 1;
+}
 #endif
 
 int
@@ -5377,6 +6464,7 @@ __malloc_info (int options, FILE *fp)
   size_t total_max_system = 0;
   size_t total_aspace = 0;
   size_t total_aspace_mprotect = 0;
+  size_t total_purged = 0;
 
 
 
@@ -5406,6 +6494,7 @@ __malloc_info (int options, FILE *fp)
 
       __libc_lock_lock (ar_ptr->mutex);
 
+      remote_free_drain (ar_ptr);
       for (size_t i = 0; i < NFASTBINS; ++i)
 	{
 	  mchunkptr p = fastbin (ar_ptr, i);
@@ -5507,10 +6596,12 @@ __malloc_info (int options, FILE *fp)
       fprintf (fp,
 	       "</sizes>\n<total type=\"fast\" count=\"%zu\" size=\"%zu\"/>\n"
 	       "<total type=\"rest\" count=\"%zu\" size=\"%zu\"/>\n"
+	       "<total type=\"purged\" size=\"%zu\"/>\n"
 	       "<system type=\"current\" size=\"%zu\"/>\n"
 	       "<system type=\"max\" size=\"%zu\"/>\n",
-	       nfastblocks, fastavail, nblocks, avail,
+	       nfastblocks, fastavail, nblocks, avail, ar_ptr->purged_mem,
 	       ar_ptr->system_mem, ar_ptr->max_system_mem);
+      total_purged += ar_ptr->purged_mem;
 
       if (ar_ptr != &main_arena)
 	{
@@ -5541,13 +6632,14 @@ __malloc_info (int options, FILE *fp)
 	   "<total type=\"fast\" count=\"%zu\" size=\"%zu\"/>\n"
 	   "<total type=\"rest\" count=\"%zu\" size=\"%zu\"/>\n"
 	   "<total type=\"mmap\" count=\"%d\" size=\"%zu\"/>\n"
+	   "<total type=\"purged\" size=\"%zu\"/>\n"
 	   "<system type=\"current\" size=\"%zu\"/>\n"
 	   "<system type=\"max\" size=\"%zu\"/>\n"
 	   "<aspace type=\"total\" size=\"%zu\"/>\n"
 	   "<aspace type=\"mprotect\" size=\"%zu\"/>\n"
 	   "</malloc>\n",
 	   total_nfastblocks, total_fastavail, total_nblocks, total_avail,
-	   mp_.n_mmaps, mp_.mmapped_mem,
+	   mp_.n_mmaps, mp_.mmapped_mem, total_purged,
 	   total_system, total_max_system,
 	   total_aspace, total_aspace_mprotect);
 
@@ -5556,8 +6648,236 @@ __malloc_info (int options, FILE *fp)
 weak_alias (__malloc_info, malloc_info)
 
 
+/*
+   ------------------------- Structured statistics -------------------------
+ */
+
+int
+__malloc_global_stats (struct malloc_global_stats *stats)
+{
+  if (__malloc_initialized < 0)
+    ptmalloc_init ();
+
+  memset (stats, 0, sizeof (*stats));
+  stats->arenas = narenas;
+  stats->mmapped_chunks = mp_.n_mmaps;
+  stats->mmapped_bytes = mp_.mmapped_mem;
+  stats->max_mmapped_bytes = mp_.max_mmapped_mem;
+#if __HAVE_64B_ATOMICS
+  stats->mmap_count = atomic_load_relaxed (&mp_.mmap_calls);
+  stats->munmap_count = atomic_load_relaxed (&mp_.munmap_calls);
+  stats->mremap_count = atomic_load_relaxed (&mp_.mremap_calls);
+#else
+  __libc_lock_lock (mmap_calls_lock);
+  stats->mmap_count = mp_.mmap_calls;
+  stats->munmap_count = mp_.munmap_calls;
+  stats->mremap_count = mp_.mremap_calls;
+  __libc_lock_unlock (mmap_calls_lock);
+#endif
+#if USE_TCACHE
+  /* The counts of other threads may lag behind by up to
+     TCACHE_STATS_FLUSH allocations each.  */
+  tcache_stats_flush ();
+  __libc_lock_lock (tcache_stats_lock);
+  stats->tcache_hits = tcache_stats_total.hits;
+  stats->tcache_misses = tcache_stats_total.misses;
+  __libc_lock_unlock (tcache_stats_lock);
+#endif
+  return 0;
+}
+weak_alias (__malloc_global_stats, malloc_global_stats)
+
+/* Account for a free chunk of SIZE bytes in bin B.  */
+static void
+bin_stats_add (struct malloc_bin_stats *b, INTERNAL_SIZE_T size)
+{
+  if (b->chunks == 0 || size < b->min_size)
+    b->min_size = size;
+  if (size > b->max_size)
+    b->max_size = size;
+  b->chunks++;
+  b->bytes += size;
+}
+
+/* The fast bins come first, followed by the unsorted bin and the
+   regular bins, as in the output of malloc_info.  */
+#define NSTATBINS (NFASTBINS + NBINS - 1)
+
+/* Store the statistics of the arena AV in *STATS, and those of up to
+   NBINS of its bins in BINS.  */
+static void
+arena_stats (mstate av, struct malloc_arena_stats *stats,
+	     struct malloc_bin_stats *bins, size_t nbins)
+{
+  memset (stats, 0, sizeof (*stats));
+
+  __libc_lock_lock (av->mutex);
+
+  remote_free_drain (av);
+  stats->system_bytes = av->system_mem;
+  stats->max_system_bytes = av->max_system_mem;
+  stats->top_bytes = chunksize (av->top);
+  stats->free_bytes = stats->top_bytes;
+  stats->free_chunks = 1;
+  stats->purged_bytes = av->purged_mem;
+  stats->threads = av->attached_threads;
+  stats->lock_acquisitions = av->lock_acquisitions;
+  stats->lock_contentions = av->lock_contentions;
+
+  for (size_t i = 0; i < NSTATBINS; ++i)
+    {
+      struct malloc_bin_stats b = { 0, };
+
+      if (i < NFASTBINS)
+	for (mchunkptr p = fastbin (av, i); p != NULL; p = p->fd)
+	  bin_stats_add (&b, chunksize (p));
+      else
+	{
+	  mbinptr bin = bin_at (av, i - NFASTBINS + 1);
+	  for (mchunkptr p = bin->fd; p != NULL && p != bin; p = p->fd)
+	    bin_stats_add (&b, chunksize (p));
+	}
+
+      stats->free_bytes += b.bytes;
+      stats->free_chunks += b.chunks;
+      if (i < nbins)
+	bins[i] = b;
+    }
+
+  __libc_lock_unlock (av->mutex);
+
+  stats->in_use_bytes = stats->system_bytes - stats->free_bytes;
+}
+
+int
+__malloc_arena_stats (unsigned int arena, struct malloc_arena_stats *stats,
+		      struct malloc_bin_stats *bins, size_t nbins)
+{
+  if (__malloc_initialized < 0)
+    ptmalloc_init ();
+
+  mstate av = &main_arena;
+  for (unsigned int i = 0; i < arena; i++)
+    {
+      av = av->next;
+      if (av == &main_arena)
+	{
+	  __set_errno (ENOENT);
+	  return -1;
+	}
+    }
+
+  arena_stats (av, stats, bins, nbins);
+  return NSTATBINS;
+}
+weak_alias (__malloc_arena_stats, malloc_arena_stats)
+
+int
+__malloc_node_stats (unsigned int node, struct malloc_node_stats *stats)
+{
+  if (__malloc_initialized < 0)
+    ptmalloc_init ();
+
+  int nodes = malloc_numa_nodes ();
+  if (nodes <= 0 || node >= (unsigned int) nodes)
+    {
+      __set_errno (ENOENT);
+      return -1;
+    }
+
+  memset (stats, 0, sizeof (*stats));
+
+  /* The node of an arena is set before it is added to the list, and
+     never changes.  */
+  mstate av = &main_arena;
+  do
+    {
+      if (av->node == (int) node)
+	{
+	  struct malloc_arena_stats a;
+	  arena_stats (av, &a, NULL, 0);
+	  stats->arenas++;
+	  stats->threads += a.threads;
+	  stats->system_bytes += a.system_bytes;
+	  stats->in_use_bytes += a.in_use_bytes;
+	  stats->free_bytes += a.free_bytes;
+	}
+      av = av->next;
+    }
+  while (av != &main_arena);
+
+  return 0;
+}
+weak_alias (__malloc_node_stats, malloc_node_stats)
+
+int
+__malloc_thread_stats (struct malloc_thread_stats *stats)
+{
+  memset (stats, 0, sizeof (*stats));
+#if USE_TCACHE
+  stats->tcache_hits = tcache_stats.hits;
+  stats->tcache_misses = tcache_stats.misses;
+  if (tcache != NULL)
+    for (size_t i = 0; i < TCACHE_MAX_BINS; ++i)
+      for (tcache_entry *e = tcache->entries[i]; e != NULL; e = e->next)
+	{
+	  stats->tcache_chunks++;
+	  stats->tcache_bytes += chunksize (mem2chunk (e));
+	}
+#endif
+  return 0;
+}
+weak_alias (__malloc_thread_stats, malloc_thread_stats)
+
+
+/*
+   ---------------------------- Private arenas ----------------------------
+ */
+
+struct malloc_arena *
+__malloc_arena_create (void)
+{
+  if (__malloc_initialized < 0)
+    ptmalloc_init ();
+
+  mstate av = _int_new_private_arena ();
+  if (av == NULL)
+    __set_errno (ENOMEM);
+  return (struct malloc_arena *) av;
+}
+weak_alias (__malloc_arena_create, malloc_arena_create)
+
+/* Allocate BYTES bytes from ARENA.  The result bypasses the hooks, the
+   slab allocator, the heap profiler and the tcache, so that it always
+   comes from the heaps of ARENA.  */
+void *
+__malloc_arena_alloc (struct malloc_arena *arena, size_t bytes)
+{
+  mstate av = (mstate) arena;
+  void *victim;
+
+  arena_mutex_lock (av);
+  victim = _int_malloc (av, bytes);
+  __libc_lock_unlock (av->mutex);
+
+  assert (!victim || av == arena_for_chunk (mem2chunk (victim)));
+  return victim;
+}
+weak_alias (__malloc_arena_alloc, malloc_arena_alloc)
+
+void
+__malloc_arena_destroy (struct malloc_arena *arena)
+{
+  if (arena != NULL)
+    _int_delete_private_arena ((mstate) arena);
+}
+weak_alias (__malloc_arena_destroy, malloc_arena_destroy)
+
+
 strong_alias (__libc_calloc, __calloc) weak_alias (__libc_calloc, calloc)
 strong_alias (__libc_free, __free) strong_alias (__libc_free, free)
+weak_alias (__libc_free_sized, free_sized)
+weak_alias (__libc_free_aligned_sized, free_aligned_sized)
 strong_alias (__libc_malloc, __malloc) strong_alias (__libc_malloc, malloc)
 strong_alias (__libc_memalign, __memalign)
 weak_alias (__libc_memalign, memalign)
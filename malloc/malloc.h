@@ -22,6 +22,7 @@
 #include <features.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <bits/types.h>
 
 #ifdef _LIBC
 # define __MALLOC_HOOK_VOLATILE
@@ -61,6 +62,15 @@ __THROW __attribute_warn_unused_result__ __attribute_alloc_size__ ((2, 3));
 /* Free a block allocated by `malloc', `realloc' or `calloc'.  */
 extern void free (void *__ptr) __THROW;
 
+/* Free a block of SIZE bytes allocated by `malloc', `realloc' or
+   `calloc'.  */
+extern void free_sized (void *__ptr, size_t __size) __THROW;
+
+/* Free a block of SIZE bytes allocated with an alignment of
+   ALIGNMENT.  */
+extern void free_aligned_sized (void *__ptr, size_t __alignment,
+				size_t __size) __THROW;
+
 /* Allocate SIZE bytes allocated to ALIGNMENT bytes.  */
 extern void *memalign (size_t __alignment, size_t __size)
 __THROW __attribute_malloc__ __attribute_alloc_size__ ((2)) __wur;
@@ -101,6 +111,102 @@ struct mallinfo
 /* Returns a copy of the updated current mallinfo. */
 extern struct mallinfo mallinfo (void) __THROW;
 
+/* Statistics of the allocator as a whole.  */
+struct malloc_global_stats
+{
+  __uint64_t arenas;		/* number of arenas */
+  __uint64_t mmapped_chunks;	/* chunks currently allocated with mmap */
+  __uint64_t mmapped_bytes;	/* space in mmapped chunks */
+  __uint64_t max_mmapped_bytes;	/* maximum of mmapped_bytes */
+  __uint64_t mmap_count;	/* mmap calls for chunks */
+  __uint64_t munmap_count;	/* munmap calls for chunks */
+  __uint64_t mremap_count;	/* mremap calls for chunks */
+  __uint64_t tcache_hits;	/* allocations served by a thread cache */
+  __uint64_t tcache_misses;	/* allocations which found it empty */
+};
+
+/* Statistics of a single arena.  */
+struct malloc_arena_stats
+{
+  __uint64_t system_bytes;	/* space obtained from the system */
+  __uint64_t max_system_bytes;	/* maximum of system_bytes */
+  __uint64_t in_use_bytes;	/* space in allocated chunks */
+  __uint64_t free_bytes;	/* space in free chunks, including top */
+  __uint64_t free_chunks;	/* number of free chunks, including top */
+  __uint64_t top_bytes;		/* top-most, releasable space */
+  __uint64_t purged_bytes;	/* free space released to the system */
+  __uint64_t threads;		/* threads attached to the arena */
+  __uint64_t lock_acquisitions;	/* times the arena was locked */
+  __uint64_t lock_contentions;	/* times locking it had to wait */
+};
+
+/* Statistics of the arenas bound to a NUMA node.  */
+struct malloc_node_stats
+{
+  __uint64_t arenas;		/* number of arenas */
+  __uint64_t threads;		/* threads attached to the arenas */
+  __uint64_t system_bytes;	/* space obtained from the system */
+  __uint64_t in_use_bytes;	/* space in allocated chunks */
+  __uint64_t free_bytes;	/* space in free chunks, including top */
+};
+
+/* Free chunks in a bin of an arena.  */
+struct malloc_bin_stats
+{
+  __uint64_t min_size;		/* smallest chunk, or 0 */
+  __uint64_t max_size;		/* largest chunk, or 0 */
+  __uint64_t chunks;		/* number of chunks */
+  __uint64_t bytes;		/* space in the chunks */
+};
+
+/* Statistics of the calling thread.  */
+struct malloc_thread_stats
+{
+  __uint64_t tcache_hits;	/* allocations served by the thread cache */
+  __uint64_t tcache_misses;	/* allocations which found it empty */
+  __uint64_t tcache_chunks;	/* chunks in the thread cache */
+  __uint64_t tcache_bytes;	/* space in those chunks */
+};
+
+/* Store the statistics of the allocator in *__STATS.  */
+extern int malloc_global_stats (struct malloc_global_stats *__stats)
+     __THROW __nonnull ((1));
+
+/* Store the statistics of arena number __ARENA in *__STATS, and those
+   of up to __NBINS of its bins in __BINS.  Return the number of bins
+   of the arena, or -1 if there is no such arena.  */
+extern int malloc_arena_stats (unsigned int __arena,
+			       struct malloc_arena_stats *__stats,
+			       struct malloc_bin_stats *__bins,
+			       size_t __nbins) __THROW __nonnull ((2));
+
+/* Store the statistics of the arenas bound to NUMA node __NODE in
+   *__STATS.  Return -1 if there is no such node.  */
+extern int malloc_node_stats (unsigned int __node,
+			      struct malloc_node_stats *__stats)
+     __THROW __nonnull ((2));
+
+/* Store the statistics of the calling thread in *__STATS.  */
+extern int malloc_thread_stats (struct malloc_thread_stats *__stats)
+     __THROW __nonnull ((1));
+
+/* An arena created by malloc_arena_create.  */
+struct malloc_arena;
+
+/* Create a new arena, from which blocks can only be allocated with
+   malloc_arena_alloc.  */
+extern struct malloc_arena *malloc_arena_create (void) __THROW __wur;
+
+/* Allocate SIZE bytes from ARENA.  The block can be reallocated and
+   freed with realloc and free.  */
+extern void *malloc_arena_alloc (struct malloc_arena *__arena, size_t __size)
+     __THROW __attribute_malloc__ __attribute_alloc_size__ ((2)) __wur
+     __nonnull ((1));
+
+/* Release ARENA together with all blocks which were allocated from
+   it.  */
+extern void malloc_arena_destroy (struct malloc_arena *__arena) __THROW;
+
 /* SVID2/XPG mallopt options */
 #ifndef M_MXFAST
 # define M_MXFAST  1    /* maximum request size for "fastbins" */
@@ -142,6 +248,10 @@ extern void malloc_stats (void) __THROW;
 /* Output information about state of allocator to stream FP.  */
 extern int malloc_info (int __options, FILE *__fp) __THROW;
 
+/* Write the live allocations sampled by the heap profiler to stream
+   FP.  */
+extern int malloc_profile_dump (int __options, FILE *__fp) __THROW;
+
 /* Hooks for debugging and user-defined versions. */
 extern void (*__MALLOC_HOOK_VOLATILE __free_hook) (void *__ptr,
                                                    const void *)
@@ -0,0 +1,321 @@
+/* Sampling heap profiler.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; see the file COPYING.LIB.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+/* If the glibc.malloc.profile_rate tunable is set, malloc and calloc
+   sample on average one byte in every mp_.profile_rate bytes which are
+   allocated.  The distance between two sampled bytes is drawn from an
+   exponential distribution, so that the samples form a Poisson process
+   over the allocated bytes, and an allocation of SIZE bytes is sampled
+   with probability 1 - exp (-SIZE / mp_.profile_rate).
+
+   A sampled allocation gets a mapping of its own.  The first page of
+   the mapping records the size of the request and the backtrace of the
+   caller, and an ordinary mmapped chunk follows it.  Therefore only the
+   release of mmapped chunks needs to check for samples, and the common
+   allocation path only counts down the bytes until the next sample.
+   The records of the live samples are kept on a list, which is written
+   out by malloc_profile_dump.  */
+
+/* Maximum number of frames recorded for a sample.  */
+#define PROFILE_MAX_DEPTH 64
+
+#define PROFILE_MAGIC ((uintptr_t) 0x70726f66UL)
+
+/* Placed at the start of the mapping of a sampled allocation.  */
+struct profile_sample
+{
+  /* PROFILE_MAGIC xor the address of the record.  */
+  uintptr_t magic;
+  struct profile_sample *prev;
+  struct profile_sample *next;
+  /* Requested number of bytes.  */
+  size_t size;
+  int depth;
+  void *frames[PROFILE_MAX_DEPTH];
+};
+
+_Static_assert (sizeof (struct profile_sample) <= 4096,
+		"profile sample fits into the smallest page size");
+
+/* Head of the circular list of live samples.  */
+static struct profile_sample profile_live =
+  {
+    .prev = &profile_live,
+    .next = &profile_live
+  };
+static size_t profile_count;
+__libc_lock_define_initialized (static, profile_lock);
+
+/* Number of bytes the current thread allocates before the next sample
+   is taken.  */
+static __thread size_t profile_countdown;
+/* State of the random number generator of the current thread, or 0 if
+   the thread has not allocated anything yet.  */
+static __thread uint64_t profile_random;
+/* Set while the current thread records a sample, so that allocations
+   made by __backtrace are not sampled.  */
+static __thread bool profile_busy;
+
+/* Offset from the start of the mapping of a sampled allocation to its
+   chunk.  The user pointer is MALLOC_ALIGNMENT bytes into the second
+   page, which satisfies the checks of munmap_chunk.  */
+static __always_inline INTERNAL_SIZE_T
+profile_offset (void)
+{
+  return GLRO (dl_pagesize) + MALLOC_ALIGNMENT - 2 * SIZE_SZ;
+}
+
+/* Return true if the mmapped chunk P is a sampled allocation.  */
+static __always_inline bool
+profile_chunk_p (mchunkptr p)
+{
+  if (__glibc_likely (prev_size (p) != profile_offset ()))
+    return false;
+  struct profile_sample *s
+    = (struct profile_sample *) ((char *) p - prev_size (p));
+  return s->magic == (PROFILE_MAGIC ^ (uintptr_t) s);
+}
+
+/* Return the number of bytes until the next sample, drawn from an
+   exponential distribution with mean mp_.profile_rate.  */
+static size_t
+profile_interval (void)
+{
+  /* xorshift64*.  */
+  uint64_t x = profile_random;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  profile_random = x;
+
+  /* U = u / 2^24 is uniformly distributed in (0, 1], and the interval
+     is -ln (U) * rate = (24 - log2 (u)) * ln (2) * rate.  log2 (u) is
+     the exponent of u plus a polynomial approximation of the logarithm
+     of its mantissa.  */
+  uint32_t u = ((x * 0x2545f4914f6cdd1dULL) >> 40) + 1;
+  int e = 31 - __builtin_clz (u);
+  double f = (double) u / (1U << e) - 1.0;
+  double log2u = e + f * (1.4425449 + f * (-0.7181452 + f * (0.4575485
+		 + f * (-0.2779042 + f * (0.1217970 - f * 0.0258411)))));
+  double interval = (24.0 - log2u) * 0.6931471805599453 * mp_.profile_rate;
+
+  if (interval >= (double) (SIZE_MAX / 2))
+    return SIZE_MAX / 2;
+  return (size_t) interval + 1;
+}
+
+/* Called when the current thread has allocated the number of bytes
+   until the next sample.  Return true if the allocation should be
+   sampled.  */
+static bool
+profile_tick (void)
+{
+  if (__glibc_unlikely (profile_random == 0))
+    {
+      /* First allocation of the thread.  The address of the
+	 thread-local variable differs between threads, and the clock
+	 between processes.  */
+      struct timespec ts;
+      __clock_gettime (CLOCK_MONOTONIC, &ts);
+      profile_random = ((uintptr_t) &profile_random
+			^ ((uint64_t) ts.tv_sec << 32) ^ ts.tv_nsec) | 1;
+      profile_countdown = profile_interval ();
+      return false;
+    }
+
+  if (profile_busy)
+    return false;
+
+  profile_countdown = profile_interval ();
+  return true;
+}
+
+/* Return true if a request for BYTES bytes is to be sampled.  Only
+   called if mp_.profile_rate is not 0.  */
+static __always_inline bool
+profile_sample_p (size_t bytes)
+{
+  if (__glibc_likely (bytes < profile_countdown))
+    {
+      profile_countdown -= bytes;
+      return false;
+    }
+  return profile_tick ();
+}
+
+/* Allocate BYTES bytes for a sampled request and record the sample.
+   The memory is cleared.  Return NULL if the mapping cannot be
+   created, in which case the request is served as usual.  */
+static void *
+profile_malloc (size_t bytes)
+{
+  size_t pagesize = GLRO (dl_pagesize);
+  INTERNAL_SIZE_T offset = profile_offset ();
+  INTERNAL_SIZE_T nb;
+
+  if (!checked_request2size (bytes, &nb))
+    return NULL;
+
+  /* Note the extra SIZE_SZ overhead as in sysmalloc_mmap.  */
+  size_t size = ALIGN_UP (nb + offset + SIZE_SZ, pagesize);
+  if (size <= nb)
+    return NULL;
+
+  char *block = (char *) MMAP (0, size, PROT_READ | PROT_WRITE, 0);
+  if (block == MAP_FAILED)
+    return NULL;
+
+  struct profile_sample *s = (struct profile_sample *) block;
+  profile_busy = true;
+  s->depth = __backtrace (s->frames, PROFILE_MAX_DEPTH);
+  profile_busy = false;
+  s->size = bytes;
+  s->magic = PROFILE_MAGIC ^ (uintptr_t) s;
+
+  mchunkptr p = (mchunkptr) (block + offset);
+  set_prev_size (p, offset);
+  set_head (p, (size - offset) | IS_MMAPPED);
+
+  int new = atomic_exchange_and_add (&mp_.n_mmaps, 1) + 1;
+  atomic_max (&mp_.max_n_mmaps, new);
+  count_mmap_call (mmap);
+  unsigned long sum;
+  sum = atomic_exchange_and_add (&mp_.mmapped_mem, size) + size;
+  atomic_max (&mp_.max_mmapped_mem, sum);
+
+  __libc_lock_lock (profile_lock);
+  s->prev = &profile_live;
+  s->next = profile_live.next;
+  profile_live.next->prev = s;
+  profile_live.next = s;
+  profile_count++;
+  __libc_lock_unlock (profile_lock);
+
+  return chunk2mem (p);
+}
+
+/* Remove the sample of the mmapped chunk P, which is about to be
+   unmapped.  */
+static void
+profile_forget (mchunkptr p)
+{
+  struct profile_sample *s
+    = (struct profile_sample *) ((char *) p - prev_size (p));
+
+  __libc_lock_lock (profile_lock);
+  s->prev->next = s->next;
+  s->next->prev = s->prev;
+  profile_count--;
+  __libc_lock_unlock (profile_lock);
+}
+
+/* Called by ptmalloc_init if the profiler is enabled.  The first call
+   of __backtrace loads libgcc_s, which takes the loader lock and
+   allocates memory.  Do this now, before any sample is taken, rather
+   than in the middle of an allocation, when the calling thread may
+   hold locks which the loader needs.  */
+static void
+profile_init (void)
+{
+  void *frame;
+  profile_busy = true;
+  __backtrace (&frame, 1);
+  profile_busy = false;
+}
+
+/* Fork handling, called from the __malloc_fork_* functions in
+   arena.c.  */
+
+static void
+profile_fork_lock (void)
+{
+  __libc_lock_lock (profile_lock);
+}
+
+static void
+profile_fork_unlock (void)
+{
+  __libc_lock_unlock (profile_lock);
+}
+
+static void
+profile_fork_reinit (void)
+{
+  __libc_lock_init (profile_lock);
+}
+
+/* Write the live samples to FP.  The samples are copied to a separate
+   mapping first, because writing to FP may allocate and free memory,
+   including sampled allocations.  */
+int
+__malloc_profile_dump (int options, FILE *fp)
+{
+  /* For now, at least.  */
+  if (options != 0)
+    return EINVAL;
+
+  struct profile_sample *copy = NULL;
+  size_t capacity = 0;
+  size_t mapped = 0;
+  size_t count;
+
+  if (mp_.profile_rate != 0)
+    while (true)
+      {
+	__libc_lock_lock (profile_lock);
+	count = profile_count;
+	if (count <= capacity)
+	  {
+	    size_t i = 0;
+	    for (struct profile_sample *s = profile_live.next;
+		 s != &profile_live; s = s->next)
+	      copy[i++] = *s;
+	    __libc_lock_unlock (profile_lock);
+	    break;
+	  }
+	__libc_lock_unlock (profile_lock);
+
+	if (mapped != 0)
+	  __munmap (copy, mapped);
+	/* Leave room for samples taken in the meantime.  */
+	capacity = count + count / 4 + 16;
+	mapped = ALIGN_UP (capacity * sizeof (*copy), GLRO (dl_pagesize));
+	copy = (struct profile_sample *) MMAP (0, mapped,
+					       PROT_READ | PROT_WRITE, 0);
+	if (copy == MAP_FAILED)
+	  return ENOMEM;
+      }
+  else
+    count = 0;
+
+  fprintf (fp, "<profile version=\"1\">\n<rate>%zu</rate>\n",
+	   mp_.profile_rate);
+  for (size_t i = 0; i < count; i++)
+    {
+      fprintf (fp, "<sample size=\"%zu\">\n", copy[i].size);
+      for (int j = 0; j < copy[i].depth; j++)
+	fprintf (fp, "<frame addr=\"%p\"/>\n", copy[i].frames[j]);
+      fputs ("</sample>\n", fp);
+    }
+  fputs ("</profile>\n", fp);
+
+  if (mapped != 0)
+    __munmap (copy, mapped);
+  return 0;
+}
+weak_alias (__malloc_profile_dump, malloc_profile_dump)
@@ -0,0 +1,336 @@
+/* Size-class slab allocator for small requests.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; see the file COPYING.LIB.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+/* If the glibc.malloc.slab_max tunable is set, requests of up to that
+   many bytes are served from a separate region of address space which
+   is reserved once at startup.  The region is divided into slabs of
+   SLAB_SIZE bytes, and each slab holds objects of a single size class.
+   Objects carry no chunk header: the size class is stored in a small
+   header at the start of the slab, and free recognizes slab objects by
+   their address alone.
+
+   Free objects are kept on a per-thread list for each size class, so
+   that most allocations and deallocations do not need a lock.  These
+   lists are exchanged in batches with a global list per size class,
+   which is protected by a lock.  Slabs are never returned to the
+   system.  */
+
+/* Largest request size served by slabs.  Size classes are multiples of
+   MALLOC_ALIGNMENT up to this size.  */
+#define SLAB_MAX_SIZE 256
+#define SLAB_NCLASSES (SLAB_MAX_SIZE / MALLOC_ALIGNMENT)
+
+#define SLAB_SIZE (64 * 1024)
+
+/* Size of the address range reserved for slabs.  Only the slabs which
+   are in use are made accessible.  */
+#define SLAB_REGION_SIZE \
+  (sizeof (long) > 4 ? 1024 * 1024 * 1024UL : 32 * 1024 * 1024UL)
+
+/* Maximum number of free objects of a size class in the per-thread
+   list, and the number of objects moved to or from the global list at
+   once.  */
+#define SLAB_CACHE_COUNT 32
+#define SLAB_CACHE_BATCH (SLAB_CACHE_COUNT / 2)
+
+/* Placed at the start of every slab.  The objects follow after
+   MALLOC_ALIGNMENT bytes.  */
+struct slab_header
+{
+  size_t idx;
+};
+
+_Static_assert (sizeof (struct slab_header) <= MALLOC_ALIGNMENT,
+		"slab header fits into MALLOC_ALIGNMENT bytes");
+
+/* A free object.  */
+struct slab_object
+{
+  struct slab_object *next;
+};
+
+struct slab_class
+{
+  __libc_lock_define (, lock);
+  /* Free objects of this size class.  */
+  struct slab_object *free;
+  /* Unused part of the most recently added slab.  */
+  char *bump;
+  char *bump_end;
+};
+
+struct slab_cache
+{
+  struct slab_object *free;
+  unsigned int count;
+};
+
+/* Start of the slab region.  */
+static uintptr_t slab_base;
+/* Size of the slab region, or 0 if slabs are not used.  */
+static size_t slab_region_size;
+/* Number of slabs handed out from the region.  */
+static size_t slab_next;
+
+/* Size classes, indexed by size / MALLOC_ALIGNMENT - 1.  */
+static struct slab_class slab_classes[SLAB_NCLASSES];
+
+static __thread struct slab_cache slab_cache[SLAB_NCLASSES];
+
+/* Return true if MEM points into the slab region.  */
+static __always_inline bool
+slab_owns (void *mem)
+{
+  return (uintptr_t) mem - slab_base < slab_region_size;
+}
+
+/* Return true if a request for BYTES bytes is served by slabs.  Empty
+   requests are left to the arenas.  */
+static __always_inline bool
+slab_eligible (size_t bytes)
+{
+  return bytes - 1 < mp_.slab_max;
+}
+
+/* Reserve the slab region.  Called from ptmalloc_init.  */
+static void
+slab_init (void)
+{
+  if (mp_.slab_max == 0)
+    return;
+
+  void *p = __mmap (NULL, SLAB_REGION_SIZE, PROT_NONE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED)
+    {
+      mp_.slab_max = 0;
+      return;
+    }
+
+  /* Align the region to SLAB_SIZE, so that the header of a slab can be
+     found by rounding down an object address.  This costs one slab.  */
+  uintptr_t base = ALIGN_UP ((uintptr_t) p, SLAB_SIZE);
+  if (base != (uintptr_t) p)
+    __munmap (p, base - (uintptr_t) p);
+  __munmap ((char *) base + SLAB_REGION_SIZE - SLAB_SIZE,
+	    SLAB_SIZE - (base - (uintptr_t) p));
+  madvise_thp ((void *) base, SLAB_REGION_SIZE - SLAB_SIZE);
+
+  for (size_t i = 0; i < SLAB_NCLASSES; i++)
+    __libc_lock_init (slab_classes[i].lock);
+  slab_base = base;
+  slab_region_size = SLAB_REGION_SIZE - SLAB_SIZE;
+}
+
+/* Make a new slab accessible and hand it to size class IDX.  Return
+   false if the region is exhausted.  The lock of the size class must
+   be held.  */
+static bool
+slab_grow (size_t idx)
+{
+  size_t n = atomic_load_relaxed (&slab_next);
+  do
+    if (n == slab_region_size / SLAB_SIZE)
+      return false;
+  while (!atomic_compare_exchange_weak_relaxed (&slab_next, &n, n + 1));
+
+  char *slab = (char *) slab_base + n * SLAB_SIZE;
+  if (__mprotect (slab, SLAB_SIZE, PROT_READ | PROT_WRITE) != 0)
+    return false;
+
+  ((struct slab_header *) slab)->idx = idx;
+  slab_classes[idx].bump = slab + MALLOC_ALIGNMENT;
+  slab_classes[idx].bump_end = slab + SLAB_SIZE;
+  return true;
+}
+
+/* Move up to SLAB_CACHE_BATCH objects of size class IDX into the
+   per-thread list CACHE, which is empty.  */
+static void
+slab_refill (struct slab_cache *cache, size_t idx)
+{
+  struct slab_class *c = &slab_classes[idx];
+  size_t size = (idx + 1) * MALLOC_ALIGNMENT;
+
+  __libc_lock_lock (c->lock);
+  while (cache->count < SLAB_CACHE_BATCH)
+    {
+      struct slab_object *obj = c->free;
+      if (obj != NULL)
+	c->free = obj->next;
+      else
+	{
+	  if ((size_t) (c->bump_end - c->bump) < size && !slab_grow (idx))
+	    break;
+	  obj = (struct slab_object *) c->bump;
+	  c->bump += size;
+	}
+      obj->next = cache->free;
+      cache->free = obj;
+      cache->count++;
+    }
+  __libc_lock_unlock (c->lock);
+}
+
+/* Move COUNT objects from the per-thread list CACHE to the global list
+   of size class IDX.  */
+static void
+slab_flush (struct slab_cache *cache, size_t idx, unsigned int count)
+{
+  struct slab_class *c = &slab_classes[idx];
+
+  if (count == 0)
+    return;
+
+  struct slab_object *first = cache->free;
+  struct slab_object *last = first;
+  for (unsigned int i = 1; i < count; i++)
+    last = last->next;
+  cache->free = last->next;
+  cache->count -= count;
+
+  __libc_lock_lock (c->lock);
+  last->next = c->free;
+  c->free = first;
+  __libc_lock_unlock (c->lock);
+}
+
+/* Allocate an object for a request of BYTES bytes, which must be
+   eligible according to slab_eligible.  Return NULL if no slab memory
+   is available, in which case the caller falls back to the arenas.  */
+static void *
+slab_alloc (size_t bytes)
+{
+  size_t idx = (bytes - 1) / MALLOC_ALIGNMENT;
+  struct slab_cache *cache = &slab_cache[idx];
+
+  if (__glibc_unlikely (cache->free == NULL))
+    {
+      slab_refill (cache, idx);
+      if (cache->free == NULL)
+	return NULL;
+    }
+
+  struct slab_object *obj = cache->free;
+  cache->free = obj->next;
+  cache->count--;
+  alloc_perturb ((char *) obj, bytes);
+  return obj;
+}
+
+/* Return the size class index of the slab object MEM, after checking
+   that MEM is the start of an object.  */
+static size_t
+slab_index (void *mem)
+{
+  uintptr_t slab = ALIGN_DOWN ((uintptr_t) mem, SLAB_SIZE);
+  if (__glibc_unlikely ((slab - slab_base) / SLAB_SIZE
+			>= atomic_load_relaxed (&slab_next)
+			|| (uintptr_t) mem - slab < MALLOC_ALIGNMENT))
+    malloc_printerr ("free(): invalid pointer");
+
+  size_t idx = ((struct slab_header *) slab)->idx;
+  size_t offset = (uintptr_t) mem - slab - MALLOC_ALIGNMENT;
+  if (__glibc_unlikely (idx >= SLAB_NCLASSES
+			|| offset % ((idx + 1) * MALLOC_ALIGNMENT) != 0))
+    malloc_printerr ("free(): invalid pointer");
+  return idx;
+}
+
+/* Return the number of usable bytes in the slab object MEM.  */
+static size_t
+slab_usable_size (void *mem)
+{
+  return (slab_index (mem) + 1) * MALLOC_ALIGNMENT;
+}
+
+/* Free the slab object MEM.  */
+static void
+slab_free (void *mem)
+{
+  size_t idx = slab_index (mem);
+  struct slab_cache *cache = &slab_cache[idx];
+  struct slab_object *obj = mem;
+
+  /* Check that the object is not the most recently freed one, as for
+     the fast bins.  */
+  if (__glibc_unlikely (cache->free == obj))
+    malloc_printerr ("double free or corruption (slab)");
+
+  free_perturb (mem, (idx + 1) * MALLOC_ALIGNMENT);
+  obj->next = cache->free;
+  cache->free = obj;
+  if (++cache->count > SLAB_CACHE_COUNT)
+    slab_flush (cache, idx, SLAB_CACHE_BATCH);
+}
+
+/* Resize the slab object OLDMEM to BYTES bytes.  */
+static void *
+slab_realloc (void *oldmem, size_t bytes)
+{
+  size_t oldsize = slab_usable_size (oldmem);
+  if (bytes <= oldsize)
+    return oldmem;
+
+  void *newmem = __libc_malloc (bytes);
+  if (newmem != NULL)
+    {
+      memcpy (newmem, oldmem, oldsize);
+      slab_free (oldmem);
+    }
+  return newmem;
+}
+
+/* Return the objects in the per-thread lists to the global lists.
+   Called on thread exit.  */
+static void
+slab_thread_shutdown (void)
+{
+  if (slab_region_size == 0)
+    return;
+
+  for (size_t i = 0; i < SLAB_NCLASSES; i++)
+    slab_flush (&slab_cache[i], i, slab_cache[i].count);
+}
+
+/* Fork handling, called from the __malloc_fork_* functions in
+   arena.c.  */
+
+static void
+slab_fork_lock (void)
+{
+  if (slab_region_size != 0)
+    for (size_t i = 0; i < SLAB_NCLASSES; i++)
+      __libc_lock_lock (slab_classes[i].lock);
+}
+
+static void
+slab_fork_unlock (void)
+{
+  if (slab_region_size != 0)
+    for (size_t i = 0; i < SLAB_NCLASSES; i++)
+      __libc_lock_unlock (slab_classes[i].lock);
+}
+
+static void
+slab_fork_reinit (void)
+{
+  if (slab_region_size != 0)
+    for (size_t i = 0; i < SLAB_NCLASSES; i++)
+      __libc_lock_init (slab_classes[i].lock);
+}
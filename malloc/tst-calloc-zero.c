@@ -0,0 +1,113 @@
+/* Test that calloc clears recycled memory.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* calloc skips the pages of a recycled chunk which malloc_trim has
+   released, and releases the pages of large blocks instead of writing
+   them.  Exercise both, including chunks which were trimmed and then
+   written by a malloc user before calloc gets them.  */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+
+enum { nblocks = 8 };
+
+static void
+check_zero (const unsigned char *p, size_t size)
+{
+  for (size_t i = 0; i < size; ++i)
+    if (p[i] != 0)
+      FAIL_EXIT1 ("byte %zu of %zu is not zero", i, size);
+}
+
+/* Allocate NBLOCKS blocks of SIZE bytes, separated by small guards so
+   that they stay in the bins after free, and fill them.  */
+static void
+allocate_blocks (void **blocks, void **guards, size_t size)
+{
+  for (int i = 0; i < nblocks; ++i)
+    {
+      blocks[i] = malloc (size);
+      guards[i] = malloc (32);
+      TEST_VERIFY_EXIT (blocks[i] != NULL && guards[i] != NULL);
+      memset (blocks[i], 0xa5, size);
+    }
+}
+
+static void
+run (size_t size, size_t request, int trim, int reuse)
+{
+  void *blocks[nblocks];
+  void *guards[nblocks];
+
+  allocate_blocks (blocks, guards, size);
+  for (int i = 0; i < nblocks; ++i)
+    free (blocks[i]);
+  if (trim)
+    malloc_trim (0);
+
+  /* Write the trimmed chunks through malloc before calloc gets them
+     again.  */
+  if (reuse)
+    {
+      for (int i = 0; i < nblocks; ++i)
+	{
+	  blocks[i] = malloc (size);
+	  TEST_VERIFY_EXIT (blocks[i] != NULL);
+	  memset (blocks[i], 0x5a, size);
+	}
+      for (int i = 0; i < nblocks; ++i)
+	free (blocks[i]);
+    }
+
+  for (int i = 0; i < nblocks; ++i)
+    {
+      blocks[i] = calloc (1, request);
+      TEST_VERIFY_EXIT (blocks[i] != NULL);
+      check_zero (blocks[i], request);
+      memset (blocks[i], 0xc3, request);
+    }
+  for (int i = 0; i < nblocks; ++i)
+    {
+      free (blocks[i]);
+      free (guards[i]);
+    }
+}
+
+static int
+do_test (void)
+{
+  /* Keep the blocks below in the heap.  */
+  TEST_COMPARE (mallopt (M_MMAP_MAX, 0), 1);
+
+  static const size_t sizes[] = { 20000, 100000, 3 * 1024 * 1024 };
+  for (size_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); ++i)
+    for (int trim = 0; trim < 2; ++trim)
+      for (int reuse = 0; reuse < 2; ++reuse)
+	{
+	  /* Exact size, and a smaller request which splits the chunk.  */
+	  run (sizes[i], sizes[i], trim, reuse);
+	  run (sizes[i], sizes[i] / 2 + 1000, trim, reuse);
+	}
+
+  return 0;
+}
+
+#include <support/test-driver.c>
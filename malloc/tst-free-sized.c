@@ -0,0 +1,95 @@
+/* Test free_sized, free_aligned_sized and aligned tcache reuse.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+
+static const size_t sizes[] =
+  { 0, 1, 15, 16, 24, 100, 1000, 1032, 1040, 5000, 200000, 4 << 20 };
+#define nsizes (sizeof (sizes) / sizeof (sizes[0]))
+
+static int
+do_test (void)
+{
+  free_sized (NULL, 0);
+  free_sized (NULL, 100);
+  free_aligned_sized (NULL, 64, 100);
+
+  for (int round = 0; round < 100; ++round)
+    {
+      void *ptrs[nsizes];
+      for (size_t i = 0; i < nsizes; ++i)
+	{
+	  ptrs[i] = round % 2 ? calloc (1, sizes[i]) : malloc (sizes[i]);
+	  TEST_VERIFY_EXIT (ptrs[i] != NULL);
+	  memset (ptrs[i], 0xa5, sizes[i]);
+	}
+      for (size_t i = 0; i < nsizes; ++i)
+	free_sized (ptrs[i], sizes[i]);
+    }
+
+  /* A block freed with its size is reused for the next request of that
+     size.  */
+  void *p = malloc (100);
+  TEST_VERIFY_EXIT (p != NULL);
+  uintptr_t addr = (uintptr_t) p;
+  free_sized (p, 100);
+  p = malloc (100);
+  TEST_VERIFY ((uintptr_t) p == addr);
+  free_sized (p, 100);
+
+  for (size_t alignment = 32; alignment <= 8192; alignment *= 2)
+    for (size_t i = 0; i < nsizes; ++i)
+      {
+	size_t size = (sizes[i] + alignment - 1) & -alignment;
+	p = aligned_alloc (alignment, size);
+	TEST_VERIFY_EXIT (p != NULL);
+	TEST_VERIFY (((uintptr_t) p & (alignment - 1)) == 0);
+	memset (p, 0x5a, size);
+	free_aligned_sized (p, alignment, size);
+      }
+
+  /* A suitably aligned block in the tcache is used for an aligned
+     request of the same size.  */
+  void *other[64];
+  int n;
+  for (n = 0; n < 64; ++n)
+    {
+      other[n] = malloc (200);
+      TEST_VERIFY_EXIT (other[n] != NULL);
+      if (((uintptr_t) other[n] & 63) == 0)
+	break;
+    }
+  if (n < 64)
+    {
+      addr = (uintptr_t) other[n];
+      free (other[n]);
+      p = aligned_alloc (64, 200);
+      TEST_VERIFY ((uintptr_t) p == addr);
+      free (p);
+    }
+  for (int i = 0; i < n; ++i)
+    free (other[i]);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
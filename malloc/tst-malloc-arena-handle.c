@@ -0,0 +1,133 @@
+/* Test malloc_arena_create, malloc_arena_alloc and malloc_arena_destroy.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+enum { count = 2000 };
+
+static unsigned char *ptrs[count];
+
+static size_t
+block_size (int i)
+{
+  return 1 + (i * 131) % 3000;
+}
+
+static void
+check_block (int i)
+{
+  size_t size = block_size (i);
+  for (size_t j = 0; j < size; ++j)
+    if (ptrs[i][j] != (unsigned char) i)
+      FAIL_EXIT1 ("block %d corrupted at offset %zu", i, j);
+}
+
+/* Allocate the blocks, free and reallocate some of them, and leave the
+   rest to malloc_arena_destroy.  */
+static void *
+use_arena (void *closure)
+{
+  struct malloc_arena *arena = closure;
+
+  for (int i = 0; i < count; ++i)
+    {
+      size_t size = block_size (i);
+      ptrs[i] = malloc_arena_alloc (arena, size);
+      TEST_VERIFY_EXIT (ptrs[i] != NULL);
+      TEST_VERIFY (malloc_usable_size (ptrs[i]) >= size);
+      memset (ptrs[i], i, size);
+    }
+  for (int i = 0; i < count; i += 3)
+    {
+      check_block (i);
+      free (ptrs[i]);
+      ptrs[i] = NULL;
+    }
+  for (int i = 1; i < count; i += 3)
+    {
+      ptrs[i] = realloc (ptrs[i], 2 * block_size (i));
+      TEST_VERIFY_EXIT (ptrs[i] != NULL);
+      check_block (i);
+    }
+  for (int i = 0; i < count; ++i)
+    if (ptrs[i] != NULL)
+      check_block (i);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  struct malloc_global_stats before, after;
+
+  for (int round = 0; round < 3; ++round)
+    {
+      /* Private arenas are not used by malloc and not counted.  */
+      TEST_COMPARE (malloc_global_stats (&before), 0);
+      struct malloc_arena *arena = malloc_arena_create ();
+      TEST_VERIFY_EXIT (arena != NULL);
+      TEST_COMPARE (malloc_global_stats (&after), 0);
+      TEST_COMPARE (after.arenas, before.arenas);
+      if (round == 1)
+	xpthread_join (xpthread_create (NULL, use_arena, arena));
+      else
+	use_arena (arena);
+
+      /* A freed block stays in the arena instead of going to the
+	 tcache, so malloc does not return it.  */
+      void *p = malloc_arena_alloc (arena, 64);
+      TEST_VERIFY_EXIT (p != NULL);
+      free (p);
+      void *q = malloc (64);
+      TEST_VERIFY_EXIT (q != NULL);
+      TEST_VERIFY (p != q);
+      free (q);
+      q = malloc_arena_alloc (arena, 64);
+      TEST_VERIFY (p == q);
+
+      /* Requests above the mmap threshold are served from the heaps
+	 of the arena, which grow beyond a single heap.  */
+      for (int i = 0; i < 100; ++i)
+	{
+	  p = malloc_arena_alloc (arena, 1024 * 1024);
+	  TEST_VERIFY_EXIT (p != NULL);
+	  memset (p, 0xa5, 1024 * 1024);
+	}
+
+      /* A request which does not fit into a heap fails.  */
+      errno = 0;
+      TEST_VERIFY (malloc_arena_alloc (arena, 1024 * 1024 * 1024) == NULL);
+      TEST_COMPARE (errno, ENOMEM);
+
+      TEST_COMPARE (malloc_global_stats (&after), 0);
+      TEST_COMPARE (after.mmap_count, before.mmap_count);
+      malloc_arena_destroy (arena);
+    }
+
+  malloc_arena_destroy (NULL);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,97 @@
+/* Test the glibc.malloc.arena_per_cpu tunable.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Start more threads than there are CPUs and let them allocate
+   concurrently, so that arena locks are contended and threads move
+   between the arenas of the CPUs.  The number of arenas must stay
+   bounded by the number of CPUs rather than by the number of
+   threads.  */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sysinfo.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+enum { max_threads = 64, iterations = 20000, live = 64 };
+
+static void *
+thread_func (void *closure)
+{
+  unsigned int seed = (unsigned int) (long) closure;
+  void *ptrs[live] = { NULL };
+
+  for (int i = 0; i < iterations; ++i)
+    {
+      int slot = rand_r (&seed) % live;
+      free (ptrs[slot]);
+      size_t size = 1 + rand_r (&seed) % 4096;
+      ptrs[slot] = malloc (size);
+      TEST_VERIFY_EXIT (ptrs[slot] != NULL);
+      memset (ptrs[slot], slot, size);
+    }
+  for (int i = 0; i < live; ++i)
+    free (ptrs[i]);
+  return NULL;
+}
+
+/* Return the number of arenas reported by malloc_info.  */
+static int
+count_arenas (void)
+{
+  char *buffer = NULL;
+  size_t length = 0;
+  FILE *fp = open_memstream (&buffer, &length);
+  TEST_VERIFY_EXIT (fp != NULL);
+  TEST_COMPARE (malloc_info (0, fp), 0);
+  TEST_COMPARE (fclose (fp), 0);
+
+  int count = 0;
+  for (char *p = buffer; (p = strstr (p, "<heap nr=")) != NULL; ++p)
+    ++count;
+  free (buffer);
+  return count;
+}
+
+static int
+do_test (void)
+{
+  int nprocs = get_nprocs ();
+  int nthreads = 4 * nprocs;
+  if (nthreads > max_threads)
+    nthreads = max_threads;
+
+  pthread_t threads[max_threads];
+  for (long i = 0; i < nthreads; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, (void *) i);
+  for (int i = 0; i < nthreads; ++i)
+    xpthread_join (threads[i]);
+
+  /* Each CPU gets one arena.  Concurrent creation for the same CPU can
+     leave an additional arena behind, which is rare.  */
+  int arenas = count_arenas ();
+  printf ("info: %d CPUs, %d threads, %d arenas\n", nprocs, nthreads, arenas);
+  TEST_VERIFY (arenas >= 1);
+  TEST_VERIFY (arenas <= 2 * nprocs);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
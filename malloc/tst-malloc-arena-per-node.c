@@ -0,0 +1,121 @@
+/* Test the glibc.malloc.arena_per_node tunable and malloc_node_stats.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Let threads allocate while they are blocked, so that the memory is
+   still in use when the statistics of the nodes are read.  The arenas
+   of the threads are bound to nodes, so the nodes together must
+   account for the memory, and for no more arenas than there are
+   CPUs, rounded up to a multiple of the number of nodes.  */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sysinfo.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+enum { max_threads = 32, blocks = 64, block_size = 4000 };
+
+static pthread_barrier_t barrier;
+
+static void *
+thread_func (void *closure)
+{
+  void *ptrs[blocks];
+  for (int i = 0; i < blocks; ++i)
+    {
+      ptrs[i] = malloc (block_size);
+      TEST_VERIFY_EXIT (ptrs[i] != NULL);
+      memset (ptrs[i], i, block_size);
+    }
+
+  /* Wait for the statistics to be read.  */
+  xpthread_barrier_wait (&barrier);
+  xpthread_barrier_wait (&barrier);
+
+  for (int i = 0; i < blocks; ++i)
+    free (ptrs[i]);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  int nprocs = get_nprocs ();
+  int nthreads = 2 * nprocs;
+  if (nthreads > max_threads)
+    nthreads = max_threads;
+
+  xpthread_barrier_init (&barrier, NULL, nthreads + 1);
+  pthread_t threads[max_threads];
+  for (int i = 0; i < nthreads; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, NULL);
+  xpthread_barrier_wait (&barrier);
+
+  unsigned int nodes = 0;
+  struct malloc_node_stats total = { 0, };
+  while (true)
+    {
+      struct malloc_node_stats stats;
+      memset (&stats, 0xff, sizeof (stats));
+      errno = 0;
+      if (malloc_node_stats (nodes, &stats) != 0)
+	{
+	  TEST_COMPARE (errno, ENOENT);
+	  break;
+	}
+      printf ("info: node %u: %llu arenas, %llu threads, %llu bytes\n",
+	      nodes, (unsigned long long int) stats.arenas,
+	      (unsigned long long int) stats.threads,
+	      (unsigned long long int) stats.in_use_bytes);
+      TEST_VERIFY (stats.in_use_bytes <= stats.system_bytes);
+      TEST_VERIFY (stats.in_use_bytes + stats.free_bytes
+		   == stats.system_bytes);
+      if (stats.arenas == 0)
+	TEST_VERIFY (stats.system_bytes == 0);
+      total.arenas += stats.arenas;
+      total.threads += stats.threads;
+      total.in_use_bytes += stats.in_use_bytes;
+      ++nodes;
+    }
+
+  if (nodes == 0)
+    printf ("info: NUMA nodes not reported by the system\n");
+  else
+    {
+      /* A thread for which the node cannot be determined uses an
+	 unbound arena, and the main thread may have moved to the arena
+	 of its node.  */
+      TEST_VERIFY (total.arenas >= 1);
+      TEST_VERIFY (total.arenas <= 2 * (nprocs + nodes));
+      TEST_VERIFY (total.threads <= nthreads + 1);
+      if (total.threads >= nthreads)
+	TEST_VERIFY (total.in_use_bytes >= nthreads * blocks * block_size);
+    }
+
+  xpthread_barrier_wait (&barrier);
+  for (int i = 0; i < nthreads; ++i)
+    xpthread_join (threads[i]);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,151 @@
+/* Test malloc_global_stats, malloc_arena_stats and malloc_thread_stats.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+enum { nthreads = 8, iterations = 10000, live = 32 };
+
+static void *
+thread_func (void *closure)
+{
+  unsigned int seed = (unsigned int) (long) closure;
+  void *ptrs[live] = { NULL };
+
+  for (int i = 0; i < iterations; ++i)
+    {
+      int slot = rand_r (&seed) % live;
+      free (ptrs[slot]);
+      ptrs[slot] = malloc (1 + rand_r (&seed) % 2000);
+      TEST_VERIFY_EXIT (ptrs[slot] != NULL);
+    }
+  for (int i = 0; i < live; ++i)
+    free (ptrs[i]);
+  return NULL;
+}
+
+/* Check the statistics of all arenas and return the total number of
+   lock acquisitions.  */
+static unsigned long long int
+check_arenas (void)
+{
+  unsigned long long int acquisitions = 0;
+  unsigned int arena;
+
+  for (arena = 0; ; ++arena)
+    {
+      struct malloc_arena_stats stats;
+      int nbins = malloc_arena_stats (arena, &stats, NULL, 0);
+      if (nbins < 0)
+	{
+	  TEST_COMPARE (errno, ENOENT);
+	  break;
+	}
+      TEST_VERIFY_EXIT (nbins > 0);
+
+      /* The free chunks in the bins and the top chunk add up to the
+	 free space of the arena.  Nothing else runs concurrently.  */
+      struct malloc_bin_stats bins[nbins];
+      TEST_COMPARE (malloc_arena_stats (arena, &stats, bins, nbins), nbins);
+      unsigned long long int bytes = stats.top_bytes;
+      unsigned long long int chunks = 1;
+      for (int i = 0; i < nbins; ++i)
+	{
+	  TEST_VERIFY (bins[i].min_size <= bins[i].max_size);
+	  TEST_VERIFY (bins[i].bytes >= bins[i].chunks * bins[i].min_size);
+	  TEST_VERIFY (bins[i].bytes <= bins[i].chunks * bins[i].max_size);
+	  bytes += bins[i].bytes;
+	  chunks += bins[i].chunks;
+	}
+      TEST_COMPARE (bytes, stats.free_bytes);
+      TEST_COMPARE (chunks, stats.free_chunks);
+      TEST_COMPARE (stats.in_use_bytes + stats.free_bytes,
+		    stats.system_bytes);
+      TEST_VERIFY (stats.system_bytes <= stats.max_system_bytes);
+      TEST_VERIFY (stats.lock_contentions <= stats.lock_acquisitions);
+      acquisitions += stats.lock_acquisitions;
+    }
+
+  struct malloc_global_stats global;
+  TEST_COMPARE (malloc_global_stats (&global), 0);
+  TEST_COMPARE (global.arenas, arena);
+  return acquisitions;
+}
+
+static int
+do_test (void)
+{
+  struct malloc_global_stats before, after;
+  TEST_COMPARE (malloc_global_stats (&before), 0);
+
+  /* Requests above the mmap threshold are served by mmap.  */
+  void *p = malloc (64 * 1024 * 1024);
+  TEST_VERIFY_EXIT (p != NULL);
+  TEST_COMPARE (malloc_global_stats (&after), 0);
+  TEST_COMPARE (after.mmap_count, before.mmap_count + 1);
+  TEST_COMPARE (after.mmapped_chunks, before.mmapped_chunks + 1);
+  TEST_VERIFY (after.mmapped_bytes
+	       >= before.mmapped_bytes + 64 * 1024 * 1024);
+  free (p);
+  TEST_COMPARE (malloc_global_stats (&after), 0);
+  TEST_COMPARE (after.munmap_count, before.munmap_count + 1);
+  TEST_COMPARE (after.mmapped_chunks, before.mmapped_chunks);
+
+  /* Reallocating a chunk of the same size is served by the tcache.  */
+  struct malloc_thread_stats thread_before, thread_after;
+  TEST_COMPARE (malloc_thread_stats (&thread_before), 0);
+  for (int i = 0; i < 100; ++i)
+    {
+      p = malloc (100);
+      TEST_VERIFY_EXIT (p != NULL);
+      free (p);
+    }
+  TEST_COMPARE (malloc_thread_stats (&thread_after), 0);
+  printf ("info: %llu tcache hits, %llu misses\n",
+	  (unsigned long long int) thread_after.tcache_hits,
+	  (unsigned long long int) thread_after.tcache_misses);
+  TEST_VERIFY (thread_after.tcache_hits >= thread_before.tcache_hits + 99);
+  TEST_VERIFY (thread_after.tcache_chunks >= 1);
+  TEST_VERIFY (thread_after.tcache_bytes >= 100);
+  TEST_COMPARE (malloc_global_stats (&after), 0);
+  TEST_VERIFY (after.tcache_hits >= thread_after.tcache_hits);
+
+  pthread_t threads[nthreads];
+  for (long i = 0; i < nthreads; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, (void *) i);
+  for (int i = 0; i < nthreads; ++i)
+    xpthread_join (threads[i]);
+
+  unsigned long long int acquisitions = check_arenas ();
+  printf ("info: %llu arena lock acquisitions\n", acquisitions);
+  TEST_VERIFY (acquisitions > 0);
+
+  /* The counts of exited threads are included in the totals.  */
+  TEST_COMPARE (malloc_global_stats (&after), 0);
+  TEST_VERIFY (after.tcache_hits + after.tcache_misses
+	       > thread_after.tcache_hits + thread_after.tcache_misses);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
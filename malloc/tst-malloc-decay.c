@@ -0,0 +1,106 @@
+/* Test the glibc.malloc.decay_time tunable.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Free large blocks which are separated by live blocks, so that they
+   stay in the bins instead of being trimmed from the top of the heap,
+   and keep the allocator busy for longer than the decay time.  The
+   pages of the free blocks must then have been released, which is
+   reported by malloc_info, and the blocks must still be usable.  */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <support/check.h>
+
+enum { nblocks = 16, block_size = 64 * 1024, ticker_size = 2000 };
+
+/* Return the total number of purged bytes reported by malloc_info.  */
+static size_t
+purged_bytes (void)
+{
+  char *buffer = NULL;
+  size_t length = 0;
+  FILE *fp = open_memstream (&buffer, &length);
+  TEST_VERIFY_EXIT (fp != NULL);
+  TEST_COMPARE (malloc_info (0, fp), 0);
+  TEST_COMPARE (fclose (fp), 0);
+
+  /* The last entry is the total over all arenas.  */
+  const char *tag = "<total type=\"purged\" size=\"";
+  char *last = NULL;
+  for (char *p = buffer; (p = strstr (p, tag)) != NULL; ++p)
+    last = p;
+  TEST_VERIFY_EXIT (last != NULL);
+  size_t result = strtoul (last + strlen (tag), NULL, 10);
+  free (buffer);
+  return result;
+}
+
+static int
+do_test (void)
+{
+  void *ticker = malloc (ticker_size);
+  TEST_VERIFY_EXIT (ticker != NULL);
+
+  void *blocks[nblocks];
+  void *guards[nblocks];
+  for (int i = 0; i < nblocks; ++i)
+    {
+      blocks[i] = malloc (block_size);
+      guards[i] = malloc (ticker_size);
+      TEST_VERIFY_EXIT (blocks[i] != NULL && guards[i] != NULL);
+      memset (blocks[i], 0xaa, block_size);
+    }
+  for (int i = 0; i < nblocks; ++i)
+    free (blocks[i]);
+
+  /* Each malloc and free of TICKER takes the arena lock.  */
+  for (int round = 0; round < 20; ++round)
+    {
+      for (int i = 0; i < 600; ++i)
+	{
+	  free (ticker);
+	  ticker = malloc (ticker_size);
+	  TEST_VERIFY_EXIT (ticker != NULL);
+	}
+      usleep (2000);
+    }
+
+  size_t purged = purged_bytes ();
+  printf ("info: %zu bytes purged\n", purged);
+  TEST_VERIFY (purged >= block_size);
+
+  for (int i = 0; i < nblocks; ++i)
+    {
+      blocks[i] = malloc (block_size);
+      TEST_VERIFY_EXIT (blocks[i] != NULL);
+      memset (blocks[i], 0x55, block_size);
+    }
+  for (int i = 0; i < nblocks; ++i)
+    {
+      free (blocks[i]);
+      free (guards[i]);
+    }
+  free (ticker);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
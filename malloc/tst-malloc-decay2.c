@@ -0,0 +1,127 @@
+/* Test the passes of glibc.malloc.decay_time over long bins.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Free more chunks of one size than a single call of malloc_decay
+   handles, and a few larger blocks which are in a later bin.  Before
+   the decay time has passed, no pages may be released, however many
+   operations the arena performs.  After it, the pass must release the
+   pages of the larger blocks as well, which the small chunks alone
+   cannot account for.  */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/timespec.h>
+#include <support/xtime.h>
+
+enum
+  {
+    nsmall = 400, small_size = 8192,
+    nlarge = 4, large_size = 96 * 1024,
+    guard_size = 2000, ticker_size = 2000
+  };
+
+/* Return the total number of purged bytes reported by malloc_info.  */
+static size_t
+purged_bytes (void)
+{
+  char *buffer = NULL;
+  size_t length = 0;
+  FILE *fp = open_memstream (&buffer, &length);
+  TEST_VERIFY_EXIT (fp != NULL);
+  TEST_COMPARE (malloc_info (0, fp), 0);
+  TEST_COMPARE (fclose (fp), 0);
+
+  /* The last entry is the total over all arenas.  */
+  const char *tag = "<total type=\"purged\" size=\"";
+  char *last = NULL;
+  for (char *p = buffer; (p = strstr (p, tag)) != NULL; ++p)
+    last = p;
+  TEST_VERIFY_EXIT (last != NULL);
+  size_t result = strtoul (last + strlen (tag), NULL, 10);
+  free (buffer);
+  return result;
+}
+
+/* Perform arena operations, each of which takes the arena lock.  */
+static void *
+tick (void *ticker)
+{
+  for (int i = 0; i < 20000; ++i)
+    {
+      free (ticker);
+      ticker = malloc (ticker_size);
+      TEST_VERIFY_EXIT (ticker != NULL);
+    }
+  return ticker;
+}
+
+static int
+do_test (void)
+{
+  void *ticker = malloc (ticker_size);
+  TEST_VERIFY_EXIT (ticker != NULL);
+
+  static void *small[nsmall];
+  static void *large[nlarge];
+  static void *guards[nsmall + nlarge];
+  for (int i = 0; i < nsmall + nlarge; ++i)
+    {
+      void **p = i < nsmall ? &small[i] : &large[i - nsmall];
+      size_t size = i < nsmall ? small_size : large_size;
+      *p = malloc (size);
+      guards[i] = malloc (guard_size);
+      TEST_VERIFY_EXIT (*p != NULL && guards[i] != NULL);
+      memset (*p, 0xaa, size);
+    }
+
+  struct timespec start;
+  xclock_gettime (CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < nsmall; ++i)
+    free (small[i]);
+  for (int i = 0; i < nlarge; ++i)
+    free (large[i]);
+
+  /* The first pass only marks the chunks.  The decay time of 200
+     milliseconds is far longer than these operations take.  */
+  ticker = tick (ticker);
+  struct timespec now;
+  xclock_gettime (CLOCK_MONOTONIC, &now);
+  struct timespec elapsed = timespec_sub (now, start);
+  if (elapsed.tv_sec > 0 || elapsed.tv_nsec >= 150 * 1000 * 1000)
+    FAIL_UNSUPPORTED ("the system is too slow for the test");
+  TEST_COMPARE (purged_bytes (), 0);
+
+  usleep (250 * 1000);
+  ticker = tick (ticker);
+  size_t purged = purged_bytes ();
+  printf ("info: %zu bytes purged\n", purged);
+  TEST_VERIFY (purged > nsmall * (size_t) getpagesize ());
+
+  for (int i = 0; i < nsmall + nlarge; ++i)
+    free (guards[i]);
+  free (ticker);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
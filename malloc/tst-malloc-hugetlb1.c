@@ -0,0 +1,76 @@
+/* Test malloc with the glibc.malloc.hugetlb tunable.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* The tunable only changes how memory is obtained from the kernel, so
+   this test exercises the main arena (sbrk), a thread arena (new_heap)
+   and direct mmap allocations, and checks that the memory is usable
+   and can be trimmed again.  Huge pages may not be available in the
+   test environment, in which case malloc must silently fall back to
+   regular pages.  */
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+static const size_t sizes[] =
+  {
+    16, 100, 1000, 4096, 64 * 1024, 200 * 1024, 1024 * 1024,
+    4 * 1024 * 1024, 8 * 1024 * 1024 + 17,
+  };
+#define NSIZES (sizeof (sizes) / sizeof (sizes[0]))
+
+static void *
+exercise (void *closure)
+{
+  void *ptrs[NSIZES][8];
+
+  for (int round = 0; round < 4; round++)
+    {
+      for (size_t i = 0; i < NSIZES; i++)
+	for (size_t j = 0; j < 8; j++)
+	  {
+	    ptrs[i][j] = malloc (sizes[i]);
+	    TEST_VERIFY_EXIT (ptrs[i][j] != NULL);
+	    memset (ptrs[i][j], 0xa5, sizes[i]);
+	  }
+
+      for (size_t i = 0; i < NSIZES; i++)
+	for (size_t j = 0; j < 8; j++)
+	  {
+	    unsigned char *p = ptrs[i][j];
+	    TEST_VERIFY (p[0] == 0xa5 && p[sizes[i] - 1] == 0xa5);
+	    free (p);
+	  }
+    }
+
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  exercise (NULL);
+  xpthread_join (xpthread_create (NULL, exercise, NULL));
+  malloc_trim (0);
+  exercise (NULL);
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1 @@
+#include "tst-malloc-hugetlb1.c"
@@ -0,0 +1,93 @@
+/* Test the heap profiler enabled by glibc.malloc.profile_rate.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* This test is run with a sampling rate of 4096 bytes, so that about
+   one in six allocations of object_size bytes is sampled.  */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+
+enum { count = 10000, object_size = 777 };
+
+static char *ptrs[count];
+
+/* Return the number of samples of object_size bytes in the output of
+   malloc_profile_dump, and check that they have backtraces.  */
+static int
+count_samples (void)
+{
+  char *buffer = NULL;
+  size_t length = 0;
+  FILE *fp = open_memstream (&buffer, &length);
+  TEST_VERIFY_EXIT (fp != NULL);
+  TEST_COMPARE (malloc_profile_dump (0, fp), 0);
+  TEST_COMPARE (fclose (fp), 0);
+
+  TEST_VERIFY (strstr (buffer, "<rate>4096</rate>") != NULL);
+  char tag[64];
+  snprintf (tag, sizeof (tag), "<sample size=\"%d\">\n<frame addr=",
+	    object_size);
+  int result = 0;
+  for (char *p = buffer; (p = strstr (p, tag)) != NULL; ++p)
+    ++result;
+  free (buffer);
+  return result;
+}
+
+static int
+do_test (void)
+{
+  TEST_COMPARE (malloc_profile_dump (1, stdout), EINVAL);
+
+  for (int i = 0; i < count; ++i)
+    {
+      ptrs[i] = i % 2 ? malloc (object_size) : calloc (1, object_size);
+      TEST_VERIFY_EXIT (ptrs[i] != NULL);
+      TEST_VERIFY (malloc_usable_size (ptrs[i]) >= object_size);
+      if (i % 2 == 0)
+	for (int j = 0; j < object_size; ++j)
+	  TEST_VERIFY (ptrs[i][j] == 0);
+      memset (ptrs[i], i, object_size);
+    }
+
+  int samples = count_samples ();
+  printf ("info: %d samples of %d allocations\n", samples, count);
+  TEST_VERIFY (samples > count / 10);
+  TEST_VERIFY (samples < count / 4);
+
+  /* Growing a sampled allocation copies it and drops the sample.  */
+  for (int i = 0; i < count; i += 3)
+    {
+      ptrs[i] = realloc (ptrs[i], 2 * object_size);
+      TEST_VERIFY_EXIT (ptrs[i] != NULL);
+      for (int j = 0; j < object_size; ++j)
+	TEST_VERIFY (ptrs[i][j] == (char) i);
+    }
+
+  for (int i = 0; i < count; ++i)
+    free (ptrs[i]);
+  TEST_COMPARE (count_samples (), 0);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
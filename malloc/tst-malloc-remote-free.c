@@ -0,0 +1,99 @@
+/* Test the glibc.malloc.remote_free tunable.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Threads arranged in a ring allocate blocks and pass them on to the
+   next thread, which frees them.  The blocks are too large for the
+   tcache and the fast bins, so every free goes to the remote free list
+   of the allocating thread's arena.  Each thread frees more blocks per
+   round than the list holds, so free also has to take the arena lock
+   and empty the list while its owner waits.  Afterwards, all of the
+   memory must have been returned to the arenas.  */
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+enum { nthreads = 4, rounds = 500, per_round = 100 };
+
+static unsigned char *slots[nthreads][per_round];
+static pthread_barrier_t barrier;
+
+static size_t
+block_size (int round, int i)
+{
+  return 2048 + ((round + i * 97) % 32) * 256;
+}
+
+static void *
+thread_func (void *closure)
+{
+  int self = (int) (long) closure;
+  int prev = (self + nthreads - 1) % nthreads;
+
+  for (int round = 0; round < rounds; ++round)
+    {
+      for (int i = 0; i < per_round; ++i)
+	{
+	  size_t size = block_size (round, i);
+	  slots[self][i] = malloc (size);
+	  TEST_VERIFY_EXIT (slots[self][i] != NULL);
+	  memset (slots[self][i], self + i, size);
+	}
+      xpthread_barrier_wait (&barrier);
+      for (int i = 0; i < per_round; ++i)
+	{
+	  unsigned char *p = slots[prev][i];
+	  size_t size = block_size (round, i);
+	  for (size_t j = 0; j < size; ++j)
+	    if (p[j] != (unsigned char) (prev + i))
+	      FAIL_EXIT1 ("thread %d: block %d of thread %d corrupted",
+			  self, i, prev);
+	  free (p);
+	}
+      xpthread_barrier_wait (&barrier);
+    }
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  struct mallinfo before = mallinfo ();
+
+  xpthread_barrier_init (&barrier, NULL, nthreads);
+  pthread_t threads[nthreads];
+  for (long i = 0; i < nthreads; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, (void *) i);
+  for (int i = 0; i < nthreads; ++i)
+    xpthread_join (threads[i]);
+  xpthread_barrier_destroy (&barrier);
+
+  /* mallinfo takes back the queued chunks, so only memory allocated by
+     the threads themselves (such as their tcaches) may remain in use.  */
+  struct mallinfo after = mallinfo ();
+  if (after.uordblks - before.uordblks > nthreads * 64 * 1024)
+    FAIL_EXIT1 ("%d bytes still in use", after.uordblks - before.uordblks);
+
+  TEST_VERIFY (malloc_trim (0) >= 0);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
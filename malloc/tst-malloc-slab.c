@@ -0,0 +1,131 @@
+/* Test the slab allocator enabled by glibc.malloc.slab_max.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+enum { count = 10000 };
+
+static unsigned char *ptrs[count];
+
+static size_t
+object_size (int i)
+{
+  return 1 + (i * 37) % 256;
+}
+
+static void
+check_object (int i)
+{
+  size_t size = object_size (i);
+  for (size_t j = 0; j < size; ++j)
+    if (ptrs[i][j] != (unsigned char) i)
+      FAIL_EXIT1 ("object %d corrupted at offset %zu", i, j);
+}
+
+static void
+allocate_all (void)
+{
+  for (int i = 0; i < count; ++i)
+    {
+      size_t size = object_size (i);
+      ptrs[i] = malloc (size);
+      TEST_VERIFY_EXIT (ptrs[i] != NULL);
+      TEST_VERIFY (((uintptr_t) ptrs[i] & (_Alignof (max_align_t) - 1))
+		   == 0);
+      TEST_VERIFY (malloc_usable_size (ptrs[i]) >= size);
+      memset (ptrs[i], i, size);
+    }
+}
+
+static void *
+free_all (void *closure)
+{
+  for (int i = 0; i < count; ++i)
+    {
+      check_object (i);
+      free (ptrs[i]);
+    }
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  /* Allocate and free in the same thread, twice, so that the second
+     round reuses freed objects.  */
+  for (int round = 0; round < 2; ++round)
+    {
+      allocate_all ();
+      free_all (NULL);
+    }
+
+  /* Free in a different thread.  */
+  allocate_all ();
+  xpthread_join (xpthread_create (NULL, free_all, NULL));
+  allocate_all ();
+  free_all (NULL);
+
+  /* calloc must clear recycled objects.  */
+  for (int i = 0; i < 100; ++i)
+    {
+      unsigned char *p = malloc (48);
+      TEST_VERIFY_EXIT (p != NULL);
+      memset (p, 0xff, 48);
+      free (p);
+      p = calloc (1, 48);
+      TEST_VERIFY_EXIT (p != NULL);
+      for (int j = 0; j < 48; ++j)
+	TEST_VERIFY (p[j] == 0);
+      free (p);
+    }
+
+  /* realloc within the size class keeps the object, and growing it
+     beyond the largest size class preserves the contents.  */
+  unsigned char *p = malloc (20);
+  TEST_VERIFY_EXIT (p != NULL);
+  memset (p, 0x5a, 20);
+  size_t usable = malloc_usable_size (p);
+  uintptr_t addr = (uintptr_t) p;
+  p = realloc (p, usable);
+  TEST_VERIFY_EXIT ((uintptr_t) p == addr);
+  p = realloc (p, 1);
+  TEST_VERIFY_EXIT ((uintptr_t) p == addr);
+  p = realloc (p, 100000);
+  TEST_VERIFY_EXIT (p != NULL);
+  for (int j = 0; j < 20; ++j)
+    TEST_VERIFY (p[j] == 0x5a);
+  free (p);
+
+  /* Empty and large requests are served by the arenas.  */
+  p = malloc (0);
+  TEST_VERIFY_EXIT (p != NULL);
+  free (p);
+  p = malloc (257);
+  TEST_VERIFY_EXIT (p != NULL);
+  TEST_VERIFY (malloc_usable_size (p) >= 257);
+  free (p);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,116 @@
+/* Test the glibc.malloc.tcache_batch tunable.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* A producer thread allocates blocks and hands them to a consumer
+   thread, which frees them.  The consumer's tcache bins overflow
+   constantly, so that blocks of the producer's arena are flushed back
+   in batches while the producer refills its own bins from the top
+   chunk.  Blocks are filled with a pattern to detect overlapping
+   allocations.  */
+
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+enum { rounds = 200, per_round = 256 };
+
+static unsigned char *blocks[per_round];
+static size_t block_sizes[per_round];
+static pthread_barrier_t barrier;
+
+static size_t
+block_size (int round, int i)
+{
+  return 16 + ((round * 7 + i * 13) % 64) * 8;
+}
+
+static void *
+producer (void *closure)
+{
+  for (int round = 0; round < rounds; ++round)
+    {
+      for (int i = 0; i < per_round; ++i)
+	{
+	  size_t size = block_size (round, i);
+	  blocks[i] = malloc (size);
+	  TEST_VERIFY_EXIT (blocks[i] != NULL);
+	  TEST_VERIFY (malloc_usable_size (blocks[i]) >= size);
+	  block_sizes[i] = size;
+	  memset (blocks[i], (unsigned char) (i + round), size);
+	}
+      xpthread_barrier_wait (&barrier);
+      /* The consumer frees the blocks.  */
+      xpthread_barrier_wait (&barrier);
+    }
+  return NULL;
+}
+
+static void *
+consumer (void *closure)
+{
+  for (int round = 0; round < rounds; ++round)
+    {
+      xpthread_barrier_wait (&barrier);
+      for (int i = 0; i < per_round; ++i)
+	{
+	  for (size_t j = 0; j < block_sizes[i]; ++j)
+	    if (blocks[i][j] != (unsigned char) (i + round))
+	      FAIL_EXIT1 ("round %d: block %d corrupted at offset %zu",
+			  round, i, j);
+	  free (blocks[i]);
+	}
+      xpthread_barrier_wait (&barrier);
+    }
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  xpthread_barrier_init (&barrier, NULL, 2);
+
+  pthread_t thr_producer = xpthread_create (NULL, producer, NULL);
+  pthread_t thr_consumer = xpthread_create (NULL, consumer, NULL);
+  xpthread_join (thr_producer);
+  xpthread_join (thr_consumer);
+
+  xpthread_barrier_destroy (&barrier);
+
+  /* The same pattern in a single thread, which flushes chunks of its
+     own arena.  */
+  void *p[per_round];
+  for (int round = 0; round < 20; ++round)
+    {
+      for (int i = 0; i < per_round; ++i)
+	{
+	  p[i] = malloc (block_size (round, i));
+	  TEST_VERIFY_EXIT (p[i] != NULL);
+	  memset (p[i], 0xa5, block_size (round, i));
+	}
+      for (int i = 0; i < per_round; ++i)
+	free (p[i]);
+    }
+  TEST_VERIFY (malloc_trim (0) >= 0);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,84 @@
+/* Test the large tcache bins and adaptive tcache bin limits.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* This test is run with glibc.malloc.tcache_max raised to its maximum,
+   so that the freed blocks below stay in the tcache and are handed out
+   again by the next allocation from the same bin that they fit.  */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+
+static void
+check_reuse (size_t freed, size_t requested, int expected)
+{
+  void *p = malloc (freed);
+  TEST_VERIFY_EXIT (p != NULL);
+  memset (p, 0xcc, freed);
+  free (p);
+
+  void *q = malloc (requested);
+  TEST_VERIFY_EXIT (q != NULL);
+  TEST_VERIFY (malloc_usable_size (q) >= requested);
+  memset (q, 0x33, requested);
+  if ((p == q) != expected)
+    {
+      printf ("error: malloc (%zu) after free of %zu bytes: %s\n",
+	      requested, freed, expected ? "not reused" : "reused");
+      support_record_failure ();
+    }
+  free (q);
+  /* Drain the bin, so that the next check starts afresh.  */
+  q = malloc (requested);
+  free (q);
+}
+
+static int
+do_test (void)
+{
+  /* Exact size.  */
+  check_reuse (4000, 4000, 1);
+  check_reuse (200000, 200000, 1);
+  /* Smaller request from the same bin.  */
+  check_reuse (3000, 2900, 1);
+  /* A larger request from the same bin must not get the smaller
+     chunk.  */
+  check_reuse (2600, 3000, 0);
+
+  /* Exercise the adaptive bin limits with bursts of allocations.  */
+  void *ptrs[200];
+  for (int round = 0; round < 50; ++round)
+    {
+      size_t size = round % 2 ? 48 : 5000;
+      int n = 20 + (round * 7) % 180;
+      for (int i = 0; i < n; ++i)
+	{
+	  ptrs[i] = malloc (size);
+	  TEST_VERIFY_EXIT (ptrs[i] != NULL);
+	  memset (ptrs[i], i, size);
+	}
+      for (int i = 0; i < n; ++i)
+	free (ptrs[i]);
+    }
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -102,15 +102,50 @@
 
 /* Cache handling for not-yet free stacks.  */
 
-/* Maximum size in kB of cache.  */
-static size_t stack_cache_maxsize = 40 * 1024 * 1024; /* 40MiBi by default.  */
+/* Maximum size in bytes of the cache, set by the
+   glibc.pthread.stack_cache_size tunable.  */
+size_t __nptl_stack_cache_maxsize = 40 * 1024 * 1024; /* 40MiBi by default.  */
 static size_t stack_cache_actsize;
 
-/* Mutex protecting this variable.  */
+/* If not 0, stacks of at least this size are aligned to it and backed
+   by transparent huge pages.  Set by the glibc.pthread.stack_hugepage
+   tunable.  */
+size_t __nptl_stack_hugepage;
+
+/* Mutex protecting the lists of stacks in use.  */
 static int stack_cache_lock = LLL_LOCK_INITIALIZER;
 
-/* List of queued stack frames.  */
-static LIST_HEAD (stack_cache);
+/* The queued stack frames are spread over several lists, so that
+   threads which create and join threads at the same time do not all
+   contend for one lock.  A thread queues and looks up stacks in the
+   shard selected by its own descriptor first.  The size of the cache
+   is accounted for all shards together.  When both locks are needed,
+   the lock of a shard is taken before stack_cache_lock, and no thread
+   holds the locks of two shards at the same time, except for
+   __make_stacks_executable, which takes all of them in order.  */
+#define STACK_CACHE_SHARDS 8
+
+struct stack_cache_shard
+{
+  /* Mutex protecting LIST.  */
+  int lock;
+  /* List of queued stack frames.  */
+  list_t list;
+  /* Like in_flight_stack, for LIST.  */
+  uintptr_t in_flight;
+} __attribute__ ((aligned (64)));
+
+#define STACK_CACHE_SHARD_INIT(i)					      \
+  [i] = { .lock = LLL_LOCK_INITIALIZER,					      \
+	  .list = { &stack_cache[i].list, &stack_cache[i].list } }
+
+static struct stack_cache_shard stack_cache[STACK_CACHE_SHARDS] =
+  {
+    STACK_CACHE_SHARD_INIT (0), STACK_CACHE_SHARD_INIT (1),
+    STACK_CACHE_SHARD_INIT (2), STACK_CACHE_SHARD_INIT (3),
+    STACK_CACHE_SHARD_INIT (4), STACK_CACHE_SHARD_INIT (5),
+    STACK_CACHE_SHARD_INIT (6), STACK_CACHE_SHARD_INIT (7)
+  };
 
 /* List of the stacks in use.  */
 static LIST_HEAD (stack_used);
@@ -131,9 +166,9 @@ hidden_data_def (__stack_user)
 
 
 static void
-stack_list_del (list_t *elem)
+stack_list_del (list_t *elem, uintptr_t *in_flight)
 {
-  in_flight_stack = (uintptr_t) elem;
+  *in_flight = (uintptr_t) elem;
 
   atomic_write_barrier ();
 
@@ -141,14 +176,14 @@ stack_list_del (list_t *elem)
 
   atomic_write_barrier ();
 
-  in_flight_stack = 0;
+  *in_flight = 0;
 }
 
 
 static void
-stack_list_add (list_t *elem, list_t *list)
+stack_list_add (list_t *elem, list_t *list, uintptr_t *in_flight)
 {
-  in_flight_stack = (uintptr_t) elem | 1;
+  *in_flight = (uintptr_t) elem | 1;
 
   atomic_write_barrier ();
 
@@ -156,7 +191,50 @@ stack_list_add (list_t *elem, list_t *list)
 
   atomic_write_barrier ();
 
-  in_flight_stack = 0;
+  *in_flight = 0;
+}
+
+
+/* Complete the list operation IN_FLIGHT on LIST, which was interrupted
+   by fork.  */
+static void
+stack_list_repair (uintptr_t in_flight, list_t *list)
+{
+  if (in_flight == 0)
+    return;
+
+  list_t *elem = (list_t *) (in_flight & ~(uintptr_t) 1);
+
+  if (in_flight & 1)
+    {
+      /* We always add at the beginning of the list.  So in this case we
+	 only need to check the beginning of the list to see if the
+	 pointers at its head are inconsistent.  */
+      if (list->next->prev != list)
+	{
+	  assert (list->next->prev == elem);
+	  elem->next = list->next;
+	  elem->prev = list;
+	  list->next = elem;
+	}
+    }
+  else
+    {
+      /* We can simply always replay the delete operation.  */
+      elem->next->prev = elem->prev;
+      elem->prev->next = elem->next;
+    }
+}
+
+
+/* Return the index of the shard of the stack cache which the calling
+   thread uses first.  Descriptors are at least a page apart.  */
+static inline unsigned int
+stack_cache_home (void)
+{
+  uintptr_t h = (uintptr_t) THREAD_SELF >> 12;
+  h ^= (h >> 3) ^ (h >> 7) ^ (h >> 13);
+  return h % STACK_CACHE_SHARDS;
 }
 
 
@@ -164,16 +242,16 @@ stack_list_add (list_t *elem, list_t *list)
    because this allows removing entries from the end.  */
 
 
-/* Get a stack frame from the cache.  We have to match by size since
-   some blocks might be too small or far too large.  */
+/* Search SHARD for a stack frame of at least SIZE bytes.  We have to
+   match by size since some blocks might be too small or far too large.
+   If one is found, move it to the list of stacks in use.  */
 static struct pthread *
-get_cached_stack (size_t *sizep, void **memp)
+get_cached_stack_shard (struct stack_cache_shard *shard, size_t size)
 {
-  size_t size = *sizep;
   struct pthread *result = NULL;
   list_t *entry;
 
-  lll_lock (stack_cache_lock, LLL_PRIVATE);
+  lll_lock (shard->lock, LLL_PRIVATE);
 
   /* Search the cache for a matching entry.  We search for the
      smallest stack which has at least the required size.  Note that
@@ -181,7 +259,7 @@ get_cached_stack (size_t *sizep, void **memp)
      same.  As the very least there are only a few different sizes.
      Therefore this loop will exit early most of the time with an
      exact match.  */
-  list_for_each (entry, &stack_cache)
+  list_for_each (entry, &shard->list)
     {
       struct pthread *curr;
 
@@ -206,7 +284,7 @@ get_cached_stack (size_t *sizep, void **memp)
       || __builtin_expect (result->stackblock_size > 4 * size, 0))
     {
       /* Release the lock.  */
-      lll_unlock (stack_cache_lock, LLL_PRIVATE);
+      lll_unlock (shard->lock, LLL_PRIVATE);
 
       return NULL;
     }
@@ -215,16 +293,40 @@ get_cached_stack (size_t *sizep, void **memp)
   result->setxid_futex = -1;
 
   /* Dequeue the entry.  */
-  stack_list_del (&result->list);
+  stack_list_del (&result->list, &shard->in_flight);
 
   /* And add to the list of stacks in use.  */
-  stack_list_add (&result->list, &stack_used);
+  lll_lock (stack_cache_lock, LLL_PRIVATE);
+  stack_list_add (&result->list, &stack_used, &in_flight_stack);
+  lll_unlock (stack_cache_lock, LLL_PRIVATE);
 
   /* And decrease the cache size.  */
-  stack_cache_actsize -= result->stackblock_size;
+  atomic_fetch_add_relaxed (&stack_cache_actsize, -result->stackblock_size);
 
   /* Release the lock early.  */
-  lll_unlock (stack_cache_lock, LLL_PRIVATE);
+  lll_unlock (shard->lock, LLL_PRIVATE);
+
+  return result;
+}
+
+
+/* Get a stack frame from the cache, trying the shard of the calling
+   thread first.  */
+static struct pthread *
+get_cached_stack (size_t *sizep, void **memp)
+{
+  size_t size = *sizep;
+  struct pthread *result = NULL;
+
+  if (atomic_load_relaxed (&stack_cache_actsize) == 0)
+    return NULL;
+
+  unsigned int home = stack_cache_home ();
+  for (unsigned int i = 0; i < STACK_CACHE_SHARDS && result == NULL; ++i)
+    result = get_cached_stack_shard
+      (&stack_cache[(home + i) % STACK_CACHE_SHARDS], size);
+  if (result == NULL)
+    return NULL;
 
   /* Report size and location of the stack to the caller.  */
   *sizep = result->stackblock_size;
@@ -250,41 +352,57 @@ get_cached_stack (size_t *sizep, void **memp)
 }
 
 
-/* Free stacks until cache size is lower than LIMIT.  */
+/* Free stacks until cache size is lower than LIMIT, starting with the
+   shard with index FIRST.  Must be called without any of the locks
+   held.  */
 static void
-free_stacks (size_t limit)
+free_stacks (size_t limit, unsigned int first)
 {
-  /* We reduce the size of the cache.  Remove the last entries until
-     the size is below the limit.  */
-  list_t *entry;
-  list_t *prev;
-
-  /* Search from the end of the list.  */
-  list_for_each_prev_safe (entry, prev, &stack_cache)
+  for (unsigned int i = 0; i < STACK_CACHE_SHARDS; ++i)
     {
-      struct pthread *curr;
+      struct stack_cache_shard *shard
+	= &stack_cache[(first + i) % STACK_CACHE_SHARDS];
 
-      curr = list_entry (entry, struct pthread, list);
-      if (FREE_P (curr))
+      /* We reduce the size of the cache.  Remove the last entries until
+	 the size is below the limit.  */
+      list_t *entry;
+      list_t *prev;
+
+      lll_lock (shard->lock, LLL_PRIVATE);
+
+      /* Search from the end of the list.  */
+      list_for_each_prev_safe (entry, prev, &shard->list)
 	{
-	  /* Unlink the block.  */
-	  stack_list_del (entry);
+	  struct pthread *curr;
+
+	  curr = list_entry (entry, struct pthread, list);
+	  if (FREE_P (curr))
+	    {
+	      /* Unlink the block.  */
+	      stack_list_del (entry, &shard->in_flight);
 
-	  /* Account for the freed memory.  */
-	  stack_cache_actsize -= curr->stackblock_size;
+	      /* Account for the freed memory.  */
+	      atomic_fetch_add_relaxed (&stack_cache_actsize,
+					-curr->stackblock_size);
 
-	  /* Free the memory associated with the ELF TLS.  */
-	  _dl_deallocate_tls (TLS_TPADJ (curr), false);
+	      /* Free the memory associated with the ELF TLS.  */
+	      _dl_deallocate_tls (TLS_TPADJ (curr), false);
 
-	  /* Remove this block.  This should never fail.  If it does
-	     something is really wrong.  */
-	  if (__munmap (curr->stackblock, curr->stackblock_size) != 0)
-	    abort ();
+	      /* Remove this block.  This should never fail.  If it does
+		 something is really wrong.  */
+	      if (__munmap (curr->stackblock, curr->stackblock_size) != 0)
+		abort ();
 
-	  /* Maybe we have freed enough.  */
-	  if (stack_cache_actsize <= limit)
-	    break;
+	      /* Maybe we have freed enough.  */
+	      if (atomic_load_relaxed (&stack_cache_actsize) <= limit)
+		break;
+	    }
 	}
+
+      lll_unlock (shard->lock, LLL_PRIVATE);
+
+      if (atomic_load_relaxed (&stack_cache_actsize) <= limit)
+	break;
     }
 }
 
@@ -292,23 +410,70 @@ free_stacks (size_t limit)
 void
 __nptl_stacks_freeres (void)
 {
-  free_stacks (0);
+  free_stacks (0, 0);
 }
 
-/* Add a stack frame which is not used anymore to the stack.  Must be
-   called with the cache lock held.  */
-static inline void
-__attribute ((always_inline))
+/* Map SIZE bytes for a stack with protection PROT.  If ALIGN is not 0,
+   the mapping is aligned to ALIGN, which SIZE is a multiple of, and
+   the kernel is asked to back it with transparent huge pages.  */
+static void *
+map_stack (size_t size, size_t align, int prot)
+{
+  if (align == 0)
+    return __mmap (NULL, size, prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+		   -1, 0);
+
+  /* Map more than needed and cut off the parts which are not
+     aligned.  */
+  if (size + align < size)
+    {
+      __set_errno (ENOMEM);
+      return MAP_FAILED;
+    }
+  char *mem = __mmap (NULL, size + align, prot,
+		      MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+  if (mem == MAP_FAILED)
+    return mem;
+  char *start = PTR_ALIGN_UP (mem, align);
+  if (start != mem)
+    __munmap (mem, start - mem);
+  if (start + size != mem + size + align)
+    __munmap (start + size, mem + align - start);
+#ifdef MADV_HUGEPAGE
+  /* Some kernels exclude MAP_STACK mappings from huge pages unless
+     asked explicitly.  */
+  __madvise (start, size, MADV_HUGEPAGE);
+#endif
+  return start;
+}
+
+/* Add a stack frame which is not used anymore to the cache and remove
+   it from the list of stacks in use.  */
+static void
 queue_stack (struct pthread *stack)
 {
+  unsigned int home = stack_cache_home ();
+  struct stack_cache_shard *shard = &stack_cache[home];
+
+  lll_lock (shard->lock, LLL_PRIVATE);
+
+  lll_lock (stack_cache_lock, LLL_PRIVATE);
+  stack_list_del (&stack->list, &in_flight_stack);
+  lll_unlock (stack_cache_lock, LLL_PRIVATE);
+
   /* We unconditionally add the stack to the list.  The memory may
      still be in use but it will not be reused until the kernel marks
      the stack as not used anymore.  */
-  stack_list_add (&stack->list, &stack_cache);
+  stack_list_add (&stack->list, &shard->list, &shard->in_flight);
+
+  size_t actsize = (atomic_fetch_add_relaxed (&stack_cache_actsize,
+					      stack->stackblock_size)
+		    + stack->stackblock_size);
+
+  lll_unlock (shard->lock, LLL_PRIVATE);
 
-  stack_cache_actsize += stack->stackblock_size;
-  if (__glibc_unlikely (stack_cache_actsize > stack_cache_maxsize))
-    free_stacks (stack_cache_maxsize);
+  if (__glibc_unlikely (actsize > __nptl_stack_cache_maxsize))
+    free_stacks (__nptl_stack_cache_maxsize, home);
 }
 
 
@@ -542,6 +707,15 @@ allocate_stack (const struct pthread_attr *attr, struct pthread **pdp,
 	/* The stack is too small (or the guard too large).  */
 	return EINVAL;
 
+      /* Stacks of at least one huge page are made a multiple of it,
+	 so that the cache keeps returning stacks of the same size.  */
+      size_t hugepage = __nptl_stack_hugepage;
+      if (hugepage != 0 && size >= hugepage
+	  && ALIGN_UP (size, hugepage) >= size)
+	size = ALIGN_UP (size, hugepage);
+      else
+	hugepage = 0;
+
       /* Try to get a stack from the cache.  */
       reqsize = size;
       pd = get_cached_stack (&size, &mem);
@@ -550,17 +724,17 @@ allocate_stack (const struct pthread_attr *attr, struct pthread **pdp,
 	  /* To avoid aliasing effects on a larger scale than pages we
 	     adjust the allocated stack size if necessary.  This way
 	     allocations directly following each other will not have
-	     aliasing problems.  */
+	     aliasing problems.  Huge pages are aligned on purpose.  */
 #if MULTI_PAGE_ALIASING != 0
-	  if ((size % MULTI_PAGE_ALIASING) == 0)
+	  if ((size % MULTI_PAGE_ALIASING) == 0 && hugepage == 0)
 	    size += pagesize_m1 + 1;
 #endif
 
 	  /* If a guard page is required, avoid committing memory by first
 	     allocate with PROT_NONE and then reserve with required permission
 	     excluding the guard page.  */
-	  mem = __mmap (NULL, size, (guardsize == 0) ? prot : PROT_NONE,
-			MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+	  mem = map_stack (size, hugepage,
+			   (guardsize == 0) ? prot : PROT_NONE);
 
 	  if (__glibc_unlikely (mem == MAP_FAILED))
 	    return errno;
@@ -635,7 +809,7 @@ allocate_stack (const struct pthread_attr *attr, struct pthread **pdp,
 	  lll_lock (stack_cache_lock, LLL_PRIVATE);
 
 	  /* And add to the list of stacks in use.  */
-	  stack_list_add (&pd->list, &stack_used);
+	  stack_list_add (&pd->list, &stack_used, &in_flight_stack);
 
 	  lll_unlock (stack_cache_lock, LLL_PRIVATE);
 
@@ -681,7 +855,7 @@ allocate_stack (const struct pthread_attr *attr, struct pthread **pdp,
 	      lll_lock (stack_cache_lock, LLL_PRIVATE);
 
 	      /* Remove the thread from the list.  */
-	      stack_list_del (&pd->list);
+	      stack_list_del (&pd->list, &in_flight_stack);
 
 	      lll_unlock (stack_cache_lock, LLL_PRIVATE);
 
@@ -787,23 +961,23 @@ allocate_stack (const struct pthread_attr *attr, struct pthread **pdp,
 void
 __deallocate_stack (struct pthread *pd)
 {
-  lll_lock (stack_cache_lock, LLL_PRIVATE);
-
-  /* Remove the thread from the list of threads with user defined
-     stacks.  */
-  stack_list_del (&pd->list);
-
   /* Not much to do.  Just free the mmap()ed memory.  Note that we do
      not reset the 'used' flag in the 'tid' field.  This is done by
      the kernel.  If no thread has been created yet this field is
      still zero.  */
   if (__glibc_likely (! pd->user_stack))
-    (void) queue_stack (pd);
+    queue_stack (pd);
   else
-    /* Free the memory associated with the ELF TLS.  */
-    _dl_deallocate_tls (TLS_TPADJ (pd), false);
+    {
+      /* Remove the thread from the list of threads with user defined
+	 stacks.  */
+      lll_lock (stack_cache_lock, LLL_PRIVATE);
+      stack_list_del (&pd->list, &in_flight_stack);
+      lll_unlock (stack_cache_lock, LLL_PRIVATE);
 
-  lll_unlock (stack_cache_lock, LLL_PRIVATE);
+      /* Free the memory associated with the ELF TLS.  */
+      _dl_deallocate_tls (TLS_TPADJ (pd), false);
+    }
 }
 
 
@@ -819,6 +993,8 @@ __make_stacks_executable (void **stack_endp)
   const size_t pagemask = ~(__getpagesize () - 1);
 #endif
 
+  for (unsigned int i = 0; i < STACK_CACHE_SHARDS; ++i)
+    lll_lock (stack_cache[i].lock, LLL_PRIVATE);
   lll_lock (stack_cache_lock, LLL_PRIVATE);
 
   list_t *runp;
@@ -836,8 +1012,8 @@ __make_stacks_executable (void **stack_endp)
   /* Also change the permission for the currently unused stacks.  This
      might be wasted time but better spend it here than adding a check
      in the fast path.  */
-  if (err == 0)
-    list_for_each (runp, &stack_cache)
+  for (unsigned int i = 0; i < STACK_CACHE_SHARDS && err == 0; ++i)
+    list_for_each (runp, &stack_cache[i].list)
       {
 	err = change_stack_perm (list_entry (runp, struct pthread, list)
 #ifdef NEED_SEPARATE_REGISTER_STACK
@@ -849,6 +1025,8 @@ __make_stacks_executable (void **stack_endp)
       }
 
   lll_unlock (stack_cache_lock, LLL_PRIVATE);
+  for (unsigned int i = 0; i < STACK_CACHE_SHARDS; ++i)
+    lll_unlock (stack_cache[i].lock, LLL_PRIVATE);
 
   return err;
 }
@@ -864,41 +1042,12 @@ __reclaim_stacks (void)
   struct pthread *self = (struct pthread *) THREAD_SELF;
 
   /* No locking necessary.  The caller is the only stack in use.  But
-     we have to be aware that we might have interrupted a list
-     operation.  */
-
-  if (in_flight_stack != 0)
-    {
-      bool add_p = in_flight_stack & 1;
-      list_t *elem = (list_t *) (in_flight_stack & ~(uintptr_t) 1);
-
-      if (add_p)
-	{
-	  /* We always add at the beginning of the list.  So in this case we
-	     only need to check the beginning of these lists to see if the
-	     pointers at the head of the list are inconsistent.  */
-	  list_t *l = NULL;
-
-	  if (stack_used.next->prev != &stack_used)
-	    l = &stack_used;
-	  else if (stack_cache.next->prev != &stack_cache)
-	    l = &stack_cache;
-
-	  if (l != NULL)
-	    {
-	      assert (l->next->prev == elem);
-	      elem->next = l->next;
-	      elem->prev = l;
-	      l->next = elem;
-	    }
-	}
-      else
-	{
-	  /* We can simply always replay the delete operation.  */
-	  elem->next->prev = elem->prev;
-	  elem->prev->next = elem->next;
-	}
-    }
+     we have to be aware that we might have interrupted list
+     operations, one on the lists of stacks in use and one on each
+     shard of the cache.  */
+  stack_list_repair (in_flight_stack, &stack_used);
+  for (unsigned int i = 0; i < STACK_CACHE_SHARDS; ++i)
+    stack_list_repair (stack_cache[i].in_flight, &stack_cache[i].list);
 
   /* Mark all stacks except the still running one as free.  */
   list_t *runp;
@@ -936,12 +1085,12 @@ __reclaim_stacks (void)
     }
 
   /* Add the stack of all running threads to the cache.  */
-  list_splice (&stack_used, &stack_cache);
+  list_splice (&stack_used, &stack_cache[stack_cache_home ()].list);
 
   /* Remove the entry for the current thread to from the cache list
      and add it to the list of running threads.  Which of the two
      lists is decided by the user_stack flag.  */
-  stack_list_del (&self->list);
+  list_del (&self->list);
 
   /* Re-initialize the lists for all the threads.  */
   INIT_LIST_HEAD (&stack_used);
@@ -956,9 +1105,13 @@ __reclaim_stacks (void)
   __nptl_nthreads = 1;
 
   in_flight_stack = 0;
+  for (unsigned int i = 0; i < STACK_CACHE_SHARDS; ++i)
+    stack_cache[i].in_flight = 0;
 
   /* Initialize locks.  */
   stack_cache_lock = LLL_LOCK_INITIALIZER;
+  for (unsigned int i = 0; i < STACK_CACHE_SHARDS; ++i)
+    stack_cache[i].lock = LLL_LOCK_INITIALIZER;
   __default_pthread_attr_lock = LLL_LOCK_INITIALIZER;
 }
 
@@ -23,6 +23,7 @@
 #include <sched.h>
 #include <setjmp.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <hp-timing.h>
 #include <list_t.h>
@@ -394,6 +395,22 @@ struct pthread
   /* Indicates whether is a C11 thread created by thrd_creat.  */
   bool c11;
 
+  /* The pthread_pool_create_np worker this thread runs, if any.  */
+  struct pthread_pool_worker *pool_worker;
+
+  /* Restartable sequences area registered with the kernel, see
+     rseq-internal.h.  This is a copy of the original struct rseq, so
+     that the layout of struct pthread does not depend on the kernel
+     headers.  The alignment applies to the type so that the area is
+     padded to the 32 bytes the kernel requires.  */
+  struct
+  {
+    uint32_t cpu_id_start;
+    uint32_t cpu_id;
+    uint64_t rseq_cs;
+    uint32_t flags;
+  } __attribute__ ((aligned (32))) rseq_area;
+
   /* This member must be last.  */
   char end_padding[];
 
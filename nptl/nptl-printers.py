@@ -500,6 +500,8 @@ class RWLockPrinter(object):
             self.values.append(('Prefers', 'Readers'))
         elif self.flags == PTHREAD_RWLOCK_PREFER_WRITER_NP:
             self.values.append(('Prefers', 'Writers'))
+        elif self.flags == PTHREAD_RWLOCK_PREFER_READER_BIASED_NP:
+            self.values.append(('Prefers', 'Readers, biased'))
         else:
             self.values.append(('Prefers', 'Writers no recursive readers'))
 
@@ -566,6 +568,8 @@ class RWLockAttributesPrinter(object):
             self.values.append(('Prefers', 'Readers'))
         elif rwlock_type == PTHREAD_RWLOCK_PREFER_WRITER_NP:
             self.values.append(('Prefers', 'Writers'))
+        elif rwlock_type == PTHREAD_RWLOCK_PREFER_READER_BIASED_NP:
+            self.values.append(('Prefers', 'Readers, biased'))
         else:
             self.values.append(('Prefers', 'Writers no recursive readers'))
 
@@ -170,6 +170,34 @@ enum
 					 << (sizeof (unsigned int) * 8 - 1))
 #define PTHREAD_RWLOCK_FUTEX_USED	2
 
+/* Return true if RWLOCK prefers writers.  */
+static inline bool
+__pthread_rwlock_prefer_writer (const pthread_rwlock_t *rwlock)
+{
+  return (rwlock->__data.__flags == PTHREAD_RWLOCK_PREFER_WRITER_NP
+	  || (rwlock->__data.__flags
+	      == PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP));
+}
+
+/* For the following, see pthread_rwlock_bias.c.  The reader bias of
+   PTHREAD_RWLOCK_PREFER_READER_BIASED_NP rwlocks is kept in fields
+   which are otherwise unused.  */
+#define __rwbias		__pad3
+#define __rwbias_inhibit	__pad4
+#define PTHREAD_RWLOCK_BIASED		1
+#define PTHREAD_RWLOCK_BIAS_WRITER	2
+#define PTHREAD_RWLOCK_BIAS_BITS	12
+extern pthread_rwlock_t *__pthread_rwlock_bias_table[]
+     attribute_hidden;
+extern int __pthread_rwlock_bias_revoke (pthread_rwlock_t *__rwlock,
+					 bool __wait, clockid_t __clockid,
+					 const struct timespec *__abstime)
+     attribute_hidden;
+extern void __pthread_rwlock_bias_release (pthread_rwlock_t *__rwlock)
+     attribute_hidden;
+extern void __pthread_rwlock_bias_enable (pthread_rwlock_t *__rwlock)
+     attribute_hidden;
+
 
 /* Bits used in robust mutex implementation.  */
 #define FUTEX_WAITERS		0x80000000
@@ -331,6 +359,12 @@ extern void __reclaim_stacks (void) attribute_hidden;
 /* Make all threads's stacks executable.  */
 extern int __make_stacks_executable (void **stack_endp) attribute_hidden;
 
+/* Maximum size in bytes of the cache of unused stacks.  */
+extern size_t __nptl_stack_cache_maxsize attribute_hidden;
+
+/* Alignment of large stacks, which are backed by huge pages, or 0.  */
+extern size_t __nptl_stack_hugepage attribute_hidden;
+
 /* longjmp handling.  */
 extern void __pthread_cleanup_upto (__jmp_buf target, char *targetframe);
 #if IS_IN (libpthread)
@@ -397,6 +431,14 @@ extern void __pthread_mutex_cond_lock_adjust (pthread_mutex_t *__mutex)
 extern int __pthread_mutex_unlock (pthread_mutex_t *__mutex);
 extern int __pthread_mutex_unlock_usercnt (pthread_mutex_t *__mutex,
 					   int __decr) attribute_hidden;
+extern void __pthread_mutex_lock_queued (pthread_mutex_t *__mutex)
+     attribute_hidden;
+extern int __pthread_mutex_timedlock_queued (pthread_mutex_t *__mutex,
+     const struct timespec *__abstime) attribute_hidden;
+extern int __pthread_mutex_trylock_queued (pthread_mutex_t *__mutex)
+     attribute_hidden;
+extern void __pthread_mutex_unlock_queued (pthread_mutex_t *__mutex)
+     attribute_hidden;
 extern int __pthread_mutexattr_init (pthread_mutexattr_t *attr);
 extern int __pthread_mutexattr_destroy (pthread_mutexattr_t *attr);
 extern int __pthread_mutexattr_settype (pthread_mutexattr_t *attr, int kind);
@@ -34,7 +34,20 @@
    section: (1) signal all waiters in G1, (2) close G1 so that it can become
    the new G2 and make G2 the new G1, and (3) signal all waiters in the new
    G1.  We don't need to do all these steps if there are no waiters in G1
-   and/or G2.  See __pthread_cond_signal for further details.  */
+   and/or G2.  See __pthread_cond_signal for further details.
+
+   All waiters that we signal will try to acquire the mutex right after they
+   have woken up, and all but one of them will have to block on it again.
+   Therefore, in step (3), we only wake one waiter and make each waiter of
+   the new G1 that consumes a signal wake the next blocked waiter as long as
+   signals remain, so that the waiters arrive at the mutex one after the
+   other instead of all at once.  We cannot requeue the waiters to the
+   mutex's futex because we do not know the mutex, and because waiters
+   blocked on it would still hold their group references.  The waiters in
+   G1 in step (1) have to be woken all at once because we wait for them to
+   leave the group in step (2).  __condvar_quiesce_and_switch_g1 wakes all
+   waiters of a group that still wait for their turn when it closes the
+   group.  */
 int
 __pthread_cond_broadcast (pthread_cond_t *cond)
 {
@@ -72,8 +85,13 @@ __pthread_cond_broadcast (pthread_cond_t *cond)
      which case we can stop.  */
   if (__condvar_quiesce_and_switch_g1 (cond, wseq, &g1, private))
     {
-      /* Step (3): Send signals to all waiters in the old G2 / new G1.  */
-      atomic_fetch_add_relaxed (cond->__data.__g_signals + g1,
+      /* Step (3): Send signals to all waiters in the old G2 / new G1.
+	 The group has just been opened, so these are the only signals it
+	 will receive.  Release MO so that waiters that consume one of the
+	 signals see that they have to pass on the wake-up.  */
+      if (cond->__data.__g_size[g1] > 1)
+	__condvar_set_chain (cond, g1);
+      atomic_fetch_add_release (cond->__data.__g_signals + g1,
 				cond->__data.__g_size[g1] << 1);
       cond->__data.__g_size[g1] = 0;
       /* TODO Only set it if there are indeed futex waiters.  */
@@ -83,7 +101,7 @@ __pthread_cond_broadcast (pthread_cond_t *cond)
   __condvar_release_lock (cond, private);
 
   if (do_futex_wake)
-    futex_wake (cond->__data.__g_signals + g1, INT_MAX, private);
+    futex_wake (cond->__data.__g_signals + g1, 1, private);
 
   return 0;
 }
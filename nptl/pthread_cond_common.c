@@ -20,8 +20,9 @@
 #include <stdint.h>
 #include <pthread.h>
 
-/* We need 3 least-significant bits on __wrefs for something else.  */
-#define __PTHREAD_COND_MAX_GROUP_SIZE ((unsigned) 1 << 29)
+/* We need 3 least-significant bits on __wrefs and 4 least-significant bits
+   on __g1_orig_size for something else.  */
+#define __PTHREAD_COND_MAX_GROUP_SIZE ((unsigned) 1 << 28)
 
 #if __HAVE_64B_ATOMICS == 1
 
@@ -298,7 +299,7 @@ __condvar_release_lock (pthread_cond_t *cond, int private)
 static unsigned int __attribute__ ((unused))
 __condvar_get_orig_size (pthread_cond_t *cond)
 {
-  return atomic_load_relaxed (&cond->__data.__g1_orig_size) >> 2;
+  return atomic_load_relaxed (&cond->__data.__g1_orig_size) >> 4;
 }
 
 /* Only use this when having acquired the lock.  */
@@ -311,11 +312,38 @@ __condvar_set_orig_size (pthread_cond_t *cond, unsigned int size)
      changes to the lock bits nor the size, and we will subsequently release
      the lock with release MO.  */
   unsigned int s;
-  s = (atomic_load_relaxed (&cond->__data.__g1_orig_size) & 3)
-      | (size << 2);
+  s = (atomic_load_relaxed (&cond->__data.__g1_orig_size) & 15)
+      | (size << 4);
   if ((atomic_exchange_relaxed (&cond->__data.__g1_orig_size, s) & 3)
       != (s & 3))
-    atomic_store_relaxed (&cond->__data.__g1_orig_size, (size << 2) | 2);
+    atomic_store_relaxed (&cond->__data.__g1_orig_size,
+			  (s & ~(unsigned int) 3) | 2);
+}
+
+/* The two bits above the lock bits in __g1_orig_size tell waiters in the
+   group with the respective slot index to pass on futex wake-ups to each
+   other (see __pthread_cond_broadcast).  They are only set and cleared by
+   signalers that have acquired the lock.  */
+static void __attribute__ ((unused))
+__condvar_set_chain (pthread_cond_t *cond, unsigned int g)
+{
+  atomic_fetch_or_relaxed (&cond->__data.__g1_orig_size, 4 << g);
+}
+
+/* Only use this when having acquired the lock.  */
+static void __attribute__ ((unused))
+__condvar_clear_chain (pthread_cond_t *cond, unsigned int g)
+{
+  atomic_fetch_and_relaxed (&cond->__data.__g1_orig_size,
+			    ~(unsigned int) (4 << g));
+}
+
+/* Returns true if waiters in group slot G must pass on futex wake-ups.  Can
+   be used without having acquired the lock.  */
+static bool __attribute__ ((unused))
+__condvar_get_chain (pthread_cond_t *cond, unsigned int g)
+{
+  return (atomic_load_relaxed (&cond->__data.__g1_orig_size) & (4 << g)) != 0;
 }
 
 /* Returns FUTEX_SHARED or FUTEX_PRIVATE based on the provided __wrefs
@@ -394,6 +422,11 @@ __condvar_quiesce_and_switch_g1 (pthread_cond_t *cond, uint64_t wseq,
      or the later update to __g1_start.  New waiters will never arrive here
      but instead continue to go into the still current G2.  */
   unsigned r = atomic_fetch_or_release (cond->__data.__g_refs + g1, 0);
+  /* If a broadcast left it to the waiters in G1 to wake each other, some of
+     them may still be blocked on the futex, so wake them all now that the
+     closed flag is set.  */
+  if ((r >> 1) > 0 && __condvar_get_chain (cond, g1))
+    futex_wake (cond->__data.__g_signals + g1, INT_MAX, private);
   while ((r >> 1) > 0)
     {
       for (unsigned int spin = maxspin; ((r >> 1) > 0) && (spin > 0); spin--)
@@ -434,6 +467,9 @@ __condvar_quiesce_and_switch_g1 (pthread_cond_t *cond, uint64_t wseq,
   __condvar_add_g1_start_relaxed (cond,
       (old_orig_size << 1) + (g1 == 1 ? 1 : - 1));
 
+  /* No waiter of the closed group can wait on the futex anymore.  */
+  __condvar_clear_chain (cond, g1);
+
   /* Now reopen the group, thus enabling waiters to again block using the
      futex controlled by __g_signals.  Release MO so that observers that see
      no signals (and thus can block) also see the write __g1_start and thus
@@ -286,7 +286,10 @@ __condvar_cleanup_waiting (void *arg)
        and observed concurrently by waiters.
    __g1_orig_size: Initial size of G1
      * The two least-significant bits represent the condvar-internal lock.
-     * Only accessed while having acquired the condvar-internal lock.
+     * Bits 2 and 3 are true if waiters in the group with slot index 0 or 1,
+       respectively, should pass on futex wake-ups to each other after a
+       broadcast.  Observed by waiters without acquiring the lock.
+     * Only modified while having acquired the condvar-internal lock.
    __wrefs: Waiter reference counter.
      * Bit 2 is true if waiters should run futex_wake when they remove the
        last reference.  pthread_cond_destroy uses this as futex word.
@@ -570,6 +573,14 @@ __pthread_cond_wait_common (pthread_cond_t *cond, pthread_mutex_t *mutex,
   while (!atomic_compare_exchange_weak_acquire (cond->__data.__g_signals + g,
 						&signals, signals - 2));
 
+  /* If a broadcast woke only one of the waiters in our group and there are
+     signals left, wake the next waiter (see __pthread_cond_broadcast).  We
+     have to do this even if we were not blocked on the futex ourselves
+     because we might have consumed the signal of the waiter that has been
+     woken.  */
+  if ((signals >> 1) > 1 && __condvar_get_chain (cond, g))
+    futex_wake (cond->__data.__g_signals + g, 1, private);
+
   /* We consumed a signal but we could have consumed from a more recent group
      that aliased with ours due to being in the same group slot.  If this
      might be the case our group must be closed as visible through
@@ -33,6 +33,7 @@
 #include <default-sched.h>
 #include <futex-internal.h>
 #include <tls-setup.h>
+#include <rseq-internal.h>
 #include "libioP.h"
 
 #include <shlib-compat.h>
@@ -402,6 +403,13 @@ START_THREAD_DEFN
     }
 #endif
 
+  /* Register the rseq area if the initial thread's registration
+     succeeded.  */
+  if (__rseq_size != 0)
+    rseq_register_current_thread (pd);
+  else
+    pd->rseq_area.cpu_id = RSEQ_CPU_ID_REGISTRATION_FAILED;
+
 #ifdef SIGCANCEL
   /* If the parent was running cancellation handlers while creating
      the thread the new thread inherited the signal mask.  Reset the
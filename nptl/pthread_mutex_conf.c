@@ -19,9 +19,12 @@
 #if HAVE_TUNABLES
 # define TUNABLE_NAMESPACE pthread
 #include <pthread_mutex_conf.h>
+#include <pthreadP.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <sys/param.h>
 #include <unistd.h>  /* Get STDOUT_FILENO for _dl_printf.  */
+#include <ldsodefs.h>
 #include <elf/dl-tunables.h>
 
 struct mutex_config __mutex_aconf =
@@ -37,10 +40,30 @@ TUNABLE_CALLBACK (set_mutex_spin_count) (tunable_val_t *valp)
   __mutex_aconf.spin_count = (int32_t) (valp)->numval;
 }
 
+static void
+TUNABLE_CALLBACK (set_stack_cache_size) (tunable_val_t *valp)
+{
+  __nptl_stack_cache_maxsize = (size_t) (valp)->numval;
+}
+
+static void
+TUNABLE_CALLBACK (set_stack_hugepage) (tunable_val_t *valp)
+{
+  size_t value = (size_t) (valp)->numval;
+
+  /* Ignore sizes which cannot be huge pages.  */
+  if (value == 0 || (powerof2 (value) && value > GLRO(dl_pagesize)))
+    __nptl_stack_hugepage = value;
+}
+
 void
 __pthread_tunables_init (void)
 {
   TUNABLE_GET (mutex_spin_count, int32_t,
                TUNABLE_CALLBACK (set_mutex_spin_count));
+  TUNABLE_GET (stack_cache_size, size_t,
+               TUNABLE_CALLBACK (set_stack_cache_size));
+  TUNABLE_GET (stack_hugepage, size_t,
+               TUNABLE_CALLBACK (set_stack_hugepage));
 }
 #endif
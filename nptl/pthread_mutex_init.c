@@ -97,6 +97,15 @@ __pthread_mutex_init (pthread_mutex_t *mutex,
       break;
     }
 
+  /* Queued mutexes keep pointers to the stacks of their waiters, and
+     the kernel does not know about their protocol.  */
+  if ((imutexattr->mutexkind & ~PTHREAD_MUTEXATTR_FLAG_BITS)
+      == PTHREAD_MUTEX_QUEUED_NP
+      && (imutexattr->mutexkind & (PTHREAD_MUTEXATTR_FLAG_ROBUST
+				   | PTHREAD_MUTEXATTR_FLAG_PSHARED
+				   | PTHREAD_MUTEXATTR_PROTOCOL_MASK)) != 0)
+    return ENOTSUP;
+
   /* Clear the whole variable.  */
   memset (mutex, '\0', __SIZEOF_PTHREAD_MUTEX_T);
 
@@ -593,6 +593,10 @@ __pthread_mutex_lock_full (pthread_mutex_t *mutex)
       }
       break;
 
+    case PTHREAD_MUTEX_QUEUED_NP:
+      __pthread_mutex_lock_queued (mutex);
+      break;
+
     default:
       /* Correct code cannot set any other type.  */
       return EINVAL;
@@ -0,0 +1,359 @@
+/* Queued mutexes.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <limits.h>
+#include <sys/param.h>
+#include <time.h>
+#include <atomic.h>
+#include <futex-internal.h>
+#include "pthreadP.h"
+
+/* A PTHREAD_MUTEX_QUEUED_NP mutex is a queue lock in the style of
+   Mellor-Crummey and Scott.  Threads which cannot take the mutex
+   immediately append a node on their stack to a queue whose tail is
+   kept in __data.__list.__next, and each of them spins, and then
+   blocks, on the state of its own node until its predecessor makes it
+   the head of the queue.  Only the head of the queue waits for the
+   lock word, so the cache line of the mutex is not contended by the
+   other waiters, and an unlock while the head is waiting hands the
+   mutex over to it instead of releasing it, so waiters get the mutex
+   in FIFO order.
+
+   Queued mutexes are never process-shared, robust, or priority
+   aware, which pthread_mutex_init enforces, so __data.__count is
+   free and holds the average number of spins the head needed to get
+   the mutex, as __data.__spins does for adaptive mutexes.  The spin
+   budget of the waiters is derived from it, so that they spin as
+   long as the mutex is usually held, and block otherwise.  */
+
+/* Values of the lock word __data.__lock.  */
+enum
+{
+  /* Not acquired.  */
+  QLOCK_FREE = 0,
+  /* Acquired, and the head of the queue (if any) does not wait for
+     the lock word yet.  */
+  QLOCK_LOCKED = 1,
+  /* Acquired, and the head of the queue spins on the lock word.  */
+  QLOCK_SPINNING = 2,
+  /* Acquired, and the head of the queue is blocked on the lock
+     word.  */
+  QLOCK_SLEEPING = 3,
+  /* Handed over to the head of the queue by the last owner.  */
+  QLOCK_HANDOFF = 4
+};
+
+/* A waiter in the queue.  */
+struct queued_node
+{
+  struct queued_node *next;
+  /* One of the NODE_* values below, used as a futex.  */
+  unsigned int state;
+};
+
+enum
+{
+  /* Waiting for the predecessor, and spinning.  */
+  NODE_WAITING = 0,
+  /* Waiting for the predecessor, and blocked on STATE.  */
+  NODE_SLEEPING = 1,
+  /* The predecessor has left the queue.  */
+  NODE_HEAD = 2
+};
+
+/* Timed waiters which find the queue occupied poll the mutex, and
+   sleep for at most this many nanoseconds at a time.  */
+#define QUEUED_POLL_NSEC 1000000
+
+static __always_inline unsigned int *
+queued_lock (pthread_mutex_t *mutex)
+{
+  return (unsigned int *) &mutex->__data.__lock;
+}
+
+static __always_inline struct queued_node **
+queued_tail (pthread_mutex_t *mutex)
+{
+  return (struct queued_node **) &mutex->__data.__list.__next;
+}
+
+/* Return the number of times a waiter spins before it blocks.  */
+static int
+queued_spin_budget (pthread_mutex_t *mutex)
+{
+  if (! __is_smp)
+    return 0;
+  return MIN (max_adaptive_count (), (int) mutex->__data.__count * 2 + 10);
+}
+
+/* Take MUTEX if it is free and nobody is queued for it.  */
+static bool
+queued_trylock (pthread_mutex_t *mutex)
+{
+  if (atomic_load_relaxed (queued_tail (mutex)) != NULL)
+    return false;
+
+  unsigned int val = QLOCK_FREE;
+  while (! atomic_compare_exchange_weak_acquire (queued_lock (mutex), &val,
+						 QLOCK_LOCKED))
+    if (val != QLOCK_FREE)
+      return false;
+  return true;
+}
+
+/* Wait until NODE is the head of the queue of MUTEX.  */
+static void
+queued_wait_turn (pthread_mutex_t *mutex, struct queued_node *node)
+{
+  int max_cnt = queued_spin_budget (mutex);
+  for (int cnt = 0; cnt < max_cnt; cnt++)
+    {
+      if (atomic_load_acquire (&node->state) == NODE_HEAD)
+	return;
+      atomic_spin_nop ();
+    }
+
+  unsigned int state = atomic_load_acquire (&node->state);
+  while (state != NODE_HEAD)
+    {
+      if (state == NODE_WAITING
+	  && ! atomic_compare_exchange_weak_relaxed (&node->state, &state,
+						     NODE_SLEEPING))
+	continue;
+      futex_wait (&node->state, NODE_SLEEPING, FUTEX_PRIVATE);
+      state = atomic_load_acquire (&node->state);
+    }
+}
+
+/* Remove NODE, the head of the queue, from the queue of MUTEX, and
+   make its successor the new head.  The successor is a waiter in
+   __pthread_mutex_lock_queued (timed waiters only join an empty queue)
+   and cannot return before it has been made the head, so its node
+   stays valid until the wake-up below.  */
+static void
+queued_dequeue (pthread_mutex_t *mutex, struct queued_node *node)
+{
+  struct queued_node **tailp = queued_tail (mutex);
+  struct queued_node *expected = node;
+  while (! atomic_compare_exchange_weak_release (tailp, &expected, NULL))
+    if (expected != node)
+      break;
+  if (expected == node)
+    return;
+
+  /* A successor has swapped itself into the tail, but may not have
+     linked itself to NODE yet.  */
+  struct queued_node *next;
+  while ((next = atomic_load_acquire (&node->next)) == NULL)
+    atomic_spin_nop ();
+  if (atomic_exchange_release (&next->state, NODE_HEAD) == NODE_SLEEPING)
+    futex_wake (&next->state, 1, FUTEX_PRIVATE);
+}
+
+/* Wait for the lock word of MUTEX as the head of its queue, until the
+   mutex is acquired or ABSTIME (if not NULL) has passed.  Return 0 or
+   ETIMEDOUT.  */
+static int
+queued_head_acquire (pthread_mutex_t *mutex, const struct timespec *abstime)
+{
+  unsigned int *lock = queued_lock (mutex);
+  int max_cnt = queued_spin_budget (mutex);
+  int cnt = 0;
+
+  unsigned int val = atomic_load_relaxed (lock);
+  while (true)
+    {
+      switch (val)
+	{
+	case QLOCK_FREE:
+	  if (atomic_compare_exchange_weak_acquire (lock, &val, QLOCK_LOCKED))
+	    goto acquired;
+	  break;
+
+	case QLOCK_LOCKED:
+	  /* Announce ourselves, so that the owner hands the mutex over
+	     instead of releasing it.  */
+	  if (atomic_compare_exchange_weak_relaxed (lock, &val,
+						    QLOCK_SPINNING))
+	    val = QLOCK_SPINNING;
+	  break;
+
+	case QLOCK_SPINNING:
+	  if (cnt < max_cnt)
+	    {
+	      cnt++;
+	      atomic_spin_nop ();
+	      val = atomic_load_relaxed (lock);
+	    }
+	  else if (atomic_compare_exchange_weak_relaxed (lock, &val,
+							 QLOCK_SLEEPING))
+	    val = QLOCK_SLEEPING;
+	  break;
+
+	case QLOCK_SLEEPING:
+	  if (abstime == NULL)
+	    futex_wait (lock, QLOCK_SLEEPING, FUTEX_PRIVATE);
+	  else if (futex_abstimed_wait (lock, QLOCK_SLEEPING, abstime,
+					FUTEX_PRIVATE) == ETIMEDOUT)
+	    goto timeout;
+	  val = atomic_load_relaxed (lock);
+	  break;
+
+	case QLOCK_HANDOFF:
+	  goto handoff;
+	}
+    }
+
+ timeout:
+  /* Withdraw the announcement, unless the mutex has been handed over
+     in the meantime.  Only the owner changes the lock word while it
+     is QLOCK_SPINNING or QLOCK_SLEEPING.  */
+  val = atomic_load_relaxed (lock);
+  do
+    if (val == QLOCK_HANDOFF)
+      goto handoff;
+  while (! atomic_compare_exchange_weak_relaxed (lock, &val, QLOCK_LOCKED));
+  return ETIMEDOUT;
+
+ handoff:
+  /* Synchronize with the release MO CAS in
+     __pthread_mutex_unlock_queued.  */
+  atomic_thread_fence_acquire ();
+  atomic_store_relaxed (lock, QLOCK_LOCKED);
+
+ acquired:
+  /* We own the mutex and can update the estimate without atomics.  */
+  {
+    int spins = mutex->__data.__count;
+    mutex->__data.__count = spins + (cnt - spins) / 8;
+  }
+  return 0;
+}
+
+void
+__pthread_mutex_lock_queued (pthread_mutex_t *mutex)
+{
+  if (queued_trylock (mutex))
+    return;
+
+  struct queued_node node;
+  node.next = NULL;
+  node.state = NODE_WAITING;
+
+  /* The release MO publishes the initialization of NODE to our
+     successor, and the acquire MO fence makes the node of our
+     predecessor visible to us.  */
+  struct queued_node *prev = atomic_exchange_release (queued_tail (mutex),
+						      &node);
+  atomic_thread_fence_acquire ();
+  if (prev != NULL)
+    {
+      atomic_store_release (&prev->next, &node);
+      queued_wait_turn (mutex, &node);
+    }
+
+  queued_head_acquire (mutex, NULL);
+  queued_dequeue (mutex, &node);
+}
+
+/* Sleep until the lock word of MUTEX changes from VAL, but not past
+   ABSTIME and not for longer than QUEUED_POLL_NSEC.  Return ETIMEDOUT
+   if ABSTIME has passed.  */
+static int
+queued_poll (pthread_mutex_t *mutex, unsigned int val,
+	     const struct timespec *abstime)
+{
+  struct timespec rt;
+  __clock_gettime (CLOCK_REALTIME, &rt);
+  rt.tv_sec = abstime->tv_sec - rt.tv_sec;
+  rt.tv_nsec = abstime->tv_nsec - rt.tv_nsec;
+  if (rt.tv_nsec < 0)
+    {
+      rt.tv_nsec += 1000000000;
+      --rt.tv_sec;
+    }
+  if (rt.tv_sec < 0)
+    return ETIMEDOUT;
+  if (rt.tv_sec > 0 || rt.tv_nsec > QUEUED_POLL_NSEC)
+    {
+      rt.tv_sec = 0;
+      rt.tv_nsec = QUEUED_POLL_NSEC;
+    }
+  futex_reltimed_wait (queued_lock (mutex), val, &rt, FUTEX_PRIVATE);
+  return 0;
+}
+
+/* A waiter behind others cannot leave the queue before the timeout
+   without the cooperation of its neighbors, so timed waiters only
+   join an empty queue, whose head can give up on its own, and poll
+   the mutex otherwise.  */
+int
+__pthread_mutex_timedlock_queued (pthread_mutex_t *mutex,
+				  const struct timespec *abstime)
+{
+  if (queued_trylock (mutex))
+    return 0;
+
+  if (abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000)
+    return EINVAL;
+
+  struct queued_node node;
+  node.next = NULL;
+  node.state = NODE_HEAD;
+
+  while (true)
+    {
+      struct queued_node *expected = NULL;
+      if (atomic_compare_exchange_weak_release (queued_tail (mutex),
+						&expected, &node))
+	{
+	  atomic_thread_fence_acquire ();
+	  int result = queued_head_acquire (mutex, abstime);
+	  queued_dequeue (mutex, &node);
+	  return result;
+	}
+      if (expected == NULL)
+	continue;
+
+      if (queued_poll (mutex, atomic_load_relaxed (queued_lock (mutex)),
+		       abstime) == ETIMEDOUT)
+	return ETIMEDOUT;
+    }
+}
+
+int
+__pthread_mutex_trylock_queued (pthread_mutex_t *mutex)
+{
+  return queued_trylock (mutex) ? 0 : EBUSY;
+}
+
+void
+__pthread_mutex_unlock_queued (pthread_mutex_t *mutex)
+{
+  unsigned int *lock = queued_lock (mutex);
+  unsigned int val = atomic_load_relaxed (lock);
+  while (! atomic_compare_exchange_weak_release
+	 (lock, &val, val == QLOCK_LOCKED ? QLOCK_FREE : QLOCK_HANDOFF))
+    ;
+
+  /* Timed waiters which poll the mutex may wait on the lock word as
+     well, so wake all of them along with the head.  */
+  if (val == QLOCK_SLEEPING)
+    futex_wake (lock, INT_MAX, FUTEX_PRIVATE);
+}
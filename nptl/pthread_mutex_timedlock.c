@@ -604,6 +604,10 @@ __pthread_mutex_timedlock (pthread_mutex_t *mutex,
       }
       break;
 
+    case PTHREAD_MUTEX_QUEUED_NP:
+      result = __pthread_mutex_timedlock_queued (mutex, abstime);
+      break;
+
     default:
       /* Correct code cannot set any other type.  */
       return EINVAL;
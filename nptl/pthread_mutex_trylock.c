@@ -453,6 +453,16 @@ __pthread_mutex_trylock (pthread_mutex_t *mutex)
       }
       break;
 
+    case PTHREAD_MUTEX_QUEUED_NP:
+      if (__pthread_mutex_trylock_queued (mutex) != 0)
+	break;
+
+      /* Record the ownership.  */
+      mutex->__data.__owner = id;
+      ++mutex->__data.__nusers;
+
+      return 0;
+
     default:
       /* Correct code cannot set any other type.  */
       return EINVAL;
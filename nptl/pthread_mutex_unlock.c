@@ -341,6 +341,16 @@ __pthread_mutex_unlock_full (pthread_mutex_t *mutex, int decr)
 
       return __pthread_tpp_change_priority (oldprio, -1);
 
+    case PTHREAD_MUTEX_QUEUED_NP:
+      /* Always reset the owner field.  */
+      mutex->__data.__owner = 0;
+      if (decr)
+	/* One less user.  */
+	--mutex->__data.__nusers;
+
+      __pthread_mutex_unlock_queued (mutex);
+      break;
+
     default:
       /* Correct code cannot set any other type.  */
       return EINVAL;
@@ -0,0 +1,535 @@
+/* Thread pools with work stealing.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <atomic.h>
+#include <futex-internal.h>
+#include <internal-signals.h>
+#include <lowlevellock.h>
+#include "pthreadP.h"
+
+/* Each worker of a pool owns a Chase-Lev work-stealing deque (Chase and
+   Lev, "Dynamic Circular Work-Stealing Deque", SPAA 2005; the memory
+   orders follow Lê et al., "Correct and Efficient Work-Stealing for
+   Weak Memory Models", PPoPP 2013).  Tasks submitted by a worker are
+   pushed to the bottom of its deque, and the worker takes tasks from
+   the bottom, so it runs the most recently submitted task first, while
+   its data is likely still in the cache.  Other workers steal from the
+   top.  Tasks submitted by other threads are appended to a queue
+   protected by QUEUE_LOCK, which the workers check after their own
+   deque and before stealing.
+
+   A worker which finds no task spins for a while and then parks on the
+   futex WAKE_SEQ after registering in SLEEPERS.  Submitters publish
+   the task, then load SLEEPERS, and only increment WAKE_SEQ and wake a
+   worker if it is nonzero.  Both sides are separated by sequentially
+   consistent fences, so either the worker sees the task when it checks
+   for work after registering, or the submitter sees the worker and
+   wakes it.
+
+   PENDING counts the tasks which have been submitted and not completed
+   yet, in units of 2.  Bit 0 is set while a thread waits in
+   pthread_pool_wait_np for the count to drop to zero.  */
+
+/* Number of times an idle worker looks for tasks before it parks.  */
+#define POOL_SPIN_COUNT 100
+
+/* Initial number of slots in a deque.  Must be a power of two.  */
+#define POOL_DEQUE_SIZE 64
+
+/* Alignment of the workers, so that they do not share cache lines.  */
+#define POOL_WORKER_ALIGN 64
+
+struct pthread_pool_task
+{
+  void (*func) (void *);
+  void *arg;
+  /* Next task in the queue of the pool.  */
+  struct pthread_pool_task *next;
+};
+
+/* The circular array of a deque.  An array which has been replaced by a
+   larger one is kept until the pool is destroyed, because thieves may
+   still read from it.  */
+struct pthread_pool_array
+{
+  size_t mask;
+  struct pthread_pool_array *prev;
+  struct pthread_pool_task *slots[];
+};
+
+struct pthread_pool_worker
+{
+  /* The deque.  The tasks are in the slots from TOP to BOTTOM - 1.
+     Only the owner changes BOTTOM and ARRAY.  */
+  size_t top;
+  size_t bottom;
+  struct pthread_pool_array *array;
+
+  struct __pthread_pool *pool;
+  pthread_t thread;
+  /* State of the generator which picks the first victim to steal
+     from.  */
+  unsigned int seed;
+} __attribute__ ((aligned (POOL_WORKER_ALIGN)));
+
+struct __pthread_pool
+{
+  struct pthread_pool_worker *workers;
+  unsigned int nworkers;
+  unsigned int pending;
+  unsigned int sleepers;
+  unsigned int wake_seq;
+  int shutdown;
+
+  /* Tasks submitted by threads which are not workers of the pool.  */
+  int queue_lock;
+  struct pthread_pool_task *queue_head;
+  struct pthread_pool_task **queue_tail;
+};
+
+
+/* Replace the array A of the deque of SELF by one twice as large, and
+   return it.  T and B are the top and bottom indices.  */
+static struct pthread_pool_array *
+deque_grow (struct pthread_pool_worker *self, struct pthread_pool_array *a,
+	    size_t t, size_t b)
+{
+  size_t size = 2 * (a->mask + 1);
+  struct pthread_pool_array *n = malloc (sizeof (*n)
+					 + size * sizeof (n->slots[0]));
+  if (n == NULL)
+    return NULL;
+  n->mask = size - 1;
+  n->prev = a;
+  for (size_t i = t; i != b; ++i)
+    n->slots[i & n->mask] = atomic_load_relaxed (&a->slots[i & a->mask]);
+  /* Release MO so that thieves which load the new array see the tasks
+     copied into it.  */
+  atomic_store_release (&self->array, n);
+  return n;
+}
+
+/* Push TASK to the bottom of the deque of SELF.  */
+static int
+deque_push (struct pthread_pool_worker *self, struct pthread_pool_task *task)
+{
+  size_t b = atomic_load_relaxed (&self->bottom);
+  /* Acquire MO so that thieves have read the slots which we may
+     overwrite.  */
+  size_t t = atomic_load_acquire (&self->top);
+  struct pthread_pool_array *a = atomic_load_relaxed (&self->array);
+  if (b - t > a->mask)
+    {
+      a = deque_grow (self, a, t, b);
+      if (a == NULL)
+	return ENOMEM;
+    }
+  atomic_store_relaxed (&a->slots[b & a->mask], task);
+  /* Pairs with the acquire MO load of BOTTOM in deque_steal.  */
+  atomic_thread_fence_release ();
+  atomic_store_relaxed (&self->bottom, b + 1);
+  return 0;
+}
+
+/* Take the task at the bottom of the deque of SELF, or return NULL if
+   the deque is empty.  */
+static struct pthread_pool_task *
+deque_take (struct pthread_pool_worker *self)
+{
+  size_t b = atomic_load_relaxed (&self->bottom) - 1;
+  struct pthread_pool_array *a = atomic_load_relaxed (&self->array);
+  atomic_store_relaxed (&self->bottom, b);
+  /* Either a thief sees the decremented BOTTOM, or we see its
+     incremented TOP.  */
+  atomic_thread_fence_seq_cst ();
+  size_t t = atomic_load_relaxed (&self->top);
+
+  struct pthread_pool_task *task = NULL;
+  if ((ssize_t) (b - t) >= 0)
+    {
+      task = atomic_load_relaxed (&a->slots[b & a->mask]);
+      if (b == t)
+	{
+	  /* This is the last task, so thieves may try to take it too.
+	     Whoever increments TOP gets it.  */
+	  size_t expected = t;
+	  while (!atomic_compare_exchange_weak_acquire (&self->top,
+							&expected, t + 1))
+	    if (expected != t)
+	      {
+		task = NULL;
+		break;
+	      }
+	  atomic_store_relaxed (&self->bottom, b + 1);
+	}
+    }
+  else
+    atomic_store_relaxed (&self->bottom, b + 1);
+  return task;
+}
+
+/* Steal the task at the top of the deque of VICTIM.  Return NULL and
+   set *RETRY if another thread took the task first.  */
+static struct pthread_pool_task *
+deque_steal (struct pthread_pool_worker *victim, bool *retry)
+{
+  size_t t = atomic_load_acquire (&victim->top);
+  /* Pairs with the fence in deque_take.  */
+  atomic_thread_fence_seq_cst ();
+  size_t b = atomic_load_acquire (&victim->bottom);
+  if ((ssize_t) (b - t) <= 0)
+    return NULL;
+
+  struct pthread_pool_array *a = atomic_load_acquire (&victim->array);
+  struct pthread_pool_task *task
+    = atomic_load_relaxed (&a->slots[t & a->mask]);
+  /* Release MO so that the owner does not overwrite the slot before we
+     have read it.  */
+  if (!atomic_compare_exchange_weak_release (&victim->top, &t, t + 1))
+    {
+      *retry = true;
+      return NULL;
+    }
+  return task;
+}
+
+/* Append TASK to the queue of POOL.  */
+static void
+queue_put (struct __pthread_pool *pool, struct pthread_pool_task *task)
+{
+  task->next = NULL;
+  lll_lock (pool->queue_lock, LLL_PRIVATE);
+  /* QUEUE_HEAD is also loaded without holding the lock.  */
+  atomic_store_relaxed (pool->queue_tail, task);
+  pool->queue_tail = &task->next;
+  lll_unlock (pool->queue_lock, LLL_PRIVATE);
+}
+
+/* Remove the first task from the queue of POOL, or return NULL if the
+   queue is empty.  */
+static struct pthread_pool_task *
+queue_take (struct __pthread_pool *pool)
+{
+  if (atomic_load_relaxed (&pool->queue_head) == NULL)
+    return NULL;
+
+  lll_lock (pool->queue_lock, LLL_PRIVATE);
+  struct pthread_pool_task *task = pool->queue_head;
+  if (task != NULL)
+    {
+      atomic_store_relaxed (&pool->queue_head, task->next);
+      if (task->next == NULL)
+	pool->queue_tail = &pool->queue_head;
+    }
+  lll_unlock (pool->queue_lock, LLL_PRIVATE);
+  return task;
+}
+
+/* Return a task for SELF to run, or NULL if none could be found.  */
+static struct pthread_pool_task *
+find_task (struct pthread_pool_worker *self)
+{
+  struct __pthread_pool *pool = self->pool;
+
+  struct pthread_pool_task *task = deque_take (self);
+  if (task != NULL)
+    return task;
+  task = queue_take (pool);
+  if (task != NULL)
+    return task;
+
+  /* Start with a random victim so that the thieves spread out.  */
+  self->seed = self->seed * 1103515245 + 12345;
+  unsigned int n = pool->nworkers;
+  unsigned int start = (self->seed >> 16) % n;
+  bool retry;
+  do
+    {
+      retry = false;
+      for (unsigned int i = 0; i < n; ++i)
+	{
+	  struct pthread_pool_worker *victim = &pool->workers[(start + i) % n];
+	  if (victim == self)
+	    continue;
+	  task = deque_steal (victim, &retry);
+	  if (task != NULL)
+	    return task;
+	}
+    }
+  while (retry);
+  return NULL;
+}
+
+/* Wake up a parked worker of POOL, if there is one.  Called after a
+   task has been published.  */
+static void
+wake_worker (struct __pthread_pool *pool)
+{
+  /* Pairs with the fence in worker_idle.  */
+  atomic_thread_fence_seq_cst ();
+  if (atomic_load_relaxed (&pool->sleepers) != 0)
+    {
+      atomic_fetch_add_relaxed (&pool->wake_seq, 1);
+      futex_wake (&pool->wake_seq, 1, FUTEX_PRIVATE);
+    }
+}
+
+/* Wait for a task for SELF.  Return NULL if the pool is shut down.  */
+static struct pthread_pool_task *
+worker_idle (struct pthread_pool_worker *self)
+{
+  struct __pthread_pool *pool = self->pool;
+  struct pthread_pool_task *task;
+
+  for (int i = 0; i < POOL_SPIN_COUNT; ++i)
+    {
+      atomic_spin_nop ();
+      task = find_task (self);
+      if (task != NULL)
+	return task;
+    }
+
+  while (true)
+    {
+      atomic_fetch_add_relaxed (&pool->sleepers, 1);
+      atomic_thread_fence_seq_cst ();
+      /* Load WAKE_SEQ before we look for tasks, so that the futex wait
+	 does not block if a task has been submitted since.  */
+      unsigned int seq = atomic_load_relaxed (&pool->wake_seq);
+      task = find_task (self);
+      bool shutdown = atomic_load_relaxed (&pool->shutdown) != 0;
+      if (task == NULL && !shutdown)
+	futex_wait_simple (&pool->wake_seq, seq, FUTEX_PRIVATE);
+      atomic_fetch_add_relaxed (&pool->sleepers, -1);
+      if (task != NULL || shutdown)
+	return task;
+    }
+}
+
+/* Count a task of POOL as completed, and wake the threads in
+   pthread_pool_wait_np if it was the last one.  Also used for a task
+   whose submission failed after it was counted.  */
+static void
+task_done (struct __pthread_pool *pool)
+{
+  /* Release MO so that pthread_pool_wait_np synchronizes with the
+     completion of the task.  */
+  unsigned int p = atomic_fetch_add_release (&pool->pending, -2);
+  if (p == 3)
+    {
+      /* This was the last task, and a thread waits for it.  Clear the
+	 flag unless a new task has been submitted in the meantime.  */
+      unsigned int expected = 1;
+      atomic_compare_exchange_weak_relaxed (&pool->pending, &expected, 0);
+      futex_wake (&pool->pending, INT_MAX, FUTEX_PRIVATE);
+    }
+}
+
+/* Run TASK and count it as completed.  */
+static void
+run_task (struct __pthread_pool *pool, struct pthread_pool_task *task)
+{
+  task->func (task->arg);
+  free (task);
+  task_done (pool);
+}
+
+static void *
+worker_start (void *closure)
+{
+  struct pthread_pool_worker *self = closure;
+  struct pthread *pd = THREAD_SELF;
+
+  THREAD_SETMEM (pd, pool_worker, self);
+  while (true)
+    {
+      struct pthread_pool_task *task = find_task (self);
+      if (task == NULL)
+	task = worker_idle (self);
+      if (task == NULL)
+	break;
+      run_task (self->pool, task);
+    }
+  THREAD_SETMEM (pd, pool_worker, NULL);
+  return NULL;
+}
+
+/* Return true if the calling thread is a worker of POOL.  */
+static bool
+is_worker (struct __pthread_pool *pool)
+{
+  struct pthread_pool_worker *self = THREAD_GETMEM (THREAD_SELF,
+						    pool_worker);
+  return self != NULL && self->pool == pool;
+}
+
+/* Terminate the first STARTED workers of POOL and free it.  */
+static void
+pool_free (struct __pthread_pool *pool, unsigned int started)
+{
+  atomic_store_relaxed (&pool->shutdown, 1);
+  atomic_fetch_add_relaxed (&pool->wake_seq, 1);
+  futex_wake (&pool->wake_seq, INT_MAX, FUTEX_PRIVATE);
+  for (unsigned int i = 0; i < started; ++i)
+    __pthread_join (pool->workers[i].thread, NULL);
+
+  for (unsigned int i = 0; i < pool->nworkers; ++i)
+    {
+      struct pthread_pool_array *a = pool->workers[i].array;
+      while (a != NULL)
+	{
+	  struct pthread_pool_array *prev = a->prev;
+	  free (a);
+	  a = prev;
+	}
+    }
+  free (pool->workers);
+  free (pool);
+}
+
+int
+pthread_pool_create_np (pthread_pool_t *poolp, unsigned int nthreads)
+{
+  if (nthreads == 0)
+    return EINVAL;
+  if (nthreads > SIZE_MAX / sizeof (struct pthread_pool_worker))
+    return ENOMEM;
+
+  struct __pthread_pool *pool = calloc (1, sizeof (*pool));
+  if (pool == NULL)
+    return ENOMEM;
+  void *workers;
+  size_t size = nthreads * sizeof (struct pthread_pool_worker);
+  if (posix_memalign (&workers, POOL_WORKER_ALIGN, size) != 0)
+    {
+      free (pool);
+      return ENOMEM;
+    }
+  memset (workers, 0, size);
+  pool->workers = workers;
+  pool->nworkers = nthreads;
+  pool->queue_lock = LLL_LOCK_INITIALIZER;
+  pool->queue_tail = &pool->queue_head;
+
+  for (unsigned int i = 0; i < nthreads; ++i)
+    {
+      struct pthread_pool_worker *w = &pool->workers[i];
+      w->pool = pool;
+      w->seed = i + 1;
+      w->array = malloc (sizeof (*w->array)
+			 + POOL_DEQUE_SIZE * sizeof (w->array->slots[0]));
+      if (w->array == NULL)
+	{
+	  pool_free (pool, 0);
+	  return ENOMEM;
+	}
+      w->array->mask = POOL_DEQUE_SIZE - 1;
+      w->array->prev = NULL;
+    }
+
+  /* Block the application signals in the workers, so that they are
+     delivered to the threads of the application.  */
+  sigset_t oss;
+  __libc_signal_block_app (&oss);
+  int ret = 0;
+  unsigned int started;
+  for (started = 0; started < nthreads; ++started)
+    {
+      ret = __pthread_create_2_1 (&pool->workers[started].thread, NULL,
+				  worker_start, &pool->workers[started]);
+      if (ret != 0)
+	break;
+    }
+  __libc_signal_restore_set (&oss);
+
+  if (ret != 0)
+    {
+      pool_free (pool, started);
+      return ret;
+    }
+  *poolp = pool;
+  return 0;
+}
+
+int
+pthread_pool_submit_np (pthread_pool_t pool, void (*func) (void *),
+			void *arg)
+{
+  struct pthread_pool_task *task = malloc (sizeof (*task));
+  if (task == NULL)
+    return ENOMEM;
+  task->func = func;
+  task->arg = arg;
+
+  /* The task is counted before it is published, so it cannot complete
+     before.  */
+  atomic_fetch_add_relaxed (&pool->pending, 2);
+  if (is_worker (pool))
+    {
+      if (deque_push (THREAD_GETMEM (THREAD_SELF, pool_worker), task) != 0)
+	{
+	  free (task);
+	  task_done (pool);
+	  return ENOMEM;
+	}
+    }
+  else
+    queue_put (pool, task);
+
+  wake_worker (pool);
+  return 0;
+}
+
+int
+pthread_pool_wait_np (pthread_pool_t pool)
+{
+  /* A worker would wait for its own task.  */
+  if (is_worker (pool))
+    return EDEADLK;
+
+  /* Acquire MO so that we synchronize with the completion of the
+     tasks.  */
+  unsigned int p = atomic_load_acquire (&pool->pending);
+  while ((p >> 1) != 0)
+    {
+      if ((p & 1) == 0
+	  && !atomic_compare_exchange_weak_relaxed (&pool->pending, &p,
+						    p | 1))
+	continue;
+      futex_wait_simple (&pool->pending, p | 1, FUTEX_PRIVATE);
+      p = atomic_load_acquire (&pool->pending);
+    }
+  return 0;
+}
+
+int
+pthread_pool_destroy_np (pthread_pool_t pool)
+{
+  int ret = pthread_pool_wait_np (pool);
+  if (ret != 0)
+    return ret;
+  pool_free (pool, pool->nworkers);
+  return 0;
+}
@@ -0,0 +1,194 @@
+/* Reader bias for reader--writer locks.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <atomic.h>
+#include "pthreadP.h"
+
+/* Readers of a PTHREAD_RWLOCK_PREFER_READER_BIASED_NP rwlock do not
+   register in __readers while the lock is biased towards readers.
+   Instead, a reader publishes the address of the rwlock in a slot of
+   __pthread_rwlock_bias_table, which is chosen by hashing the rwlock
+   and the thread, and then confirms that the lock is still biased.
+   Different readers mostly use different slots, so uncontended read
+   lock acquisitions do not write to shared cache lines.  A reader
+   whose slot is occupied takes the ordinary path through __readers.
+
+   A writer first revokes the bias and waits until all slots referring
+   to the rwlock are released, and only then acquires the lock as
+   usual, so that readers which acquire the lock recursively in the
+   meantime are registered in __readers and do not deadlock.  The
+   revocation scans the whole table, so the bias is not restored
+   before the ordinary read path has been used for
+   PTHREAD_RWLOCK_BIAS_INHIBIT times as long as the scan took.  This
+   bounds the slowdown of writers.
+
+   The reader which stores to a slot and then loads the bias, and the
+   writer which clears the bias and then loads the slots, are separated
+   by sequentially consistent fences, so that either the reader sees
+   the revocation or the writer sees the reader.
+
+   A slot which refers to a rwlock stands for one read lock on it, and
+   read unlock releases the slot of the calling thread if it refers to
+   the rwlock.  The slot may have been filled by another thread whose
+   hash collides, but all read locks are interchangeable, so this just
+   leaves the other thread's read lock to be released through
+   __readers.
+
+   __rwbias holds PTHREAD_RWLOCK_BIASED and the number of writers which
+   have revoked the bias, in units of PTHREAD_RWLOCK_BIAS_WRITER.  The
+   bias is only restored while there are no such writers.  The table
+   is specific to the process, so process-shared rwlocks are never
+   biased.  */
+
+#define PTHREAD_RWLOCK_BIAS_SLOTS (1 << PTHREAD_RWLOCK_BIAS_BITS)
+
+/* Factor between the time the ordinary read path is used after a
+   revocation and the time the revocation took.  */
+#define PTHREAD_RWLOCK_BIAS_INHIBIT 9
+
+/* Upper bound for the time the bias is inhibited, in microseconds.  */
+#define PTHREAD_RWLOCK_BIAS_MAX_INHIBIT 100000
+
+/* Number of times a writer spins on a slot before it yields.  */
+#define PTHREAD_RWLOCK_BIAS_SPINS 1000
+
+pthread_rwlock_t *__pthread_rwlock_bias_table[PTHREAD_RWLOCK_BIAS_SLOTS];
+
+/* Return a timestamp in microseconds, which wraps around.  */
+static unsigned int
+bias_clock (void)
+{
+  struct timespec ts;
+  __clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000U + ts.tv_nsec / 1000;
+}
+
+/* Return true if the absolute time ABSTIME on clock CLOCKID has
+   passed.  */
+static bool
+bias_expired (clockid_t clockid, const struct timespec *abstime)
+{
+  struct timespec ts;
+  __clock_gettime (clockid, &ts);
+  return (ts.tv_sec > abstime->tv_sec
+	  || (ts.tv_sec == abstime->tv_sec
+	      && ts.tv_nsec >= abstime->tv_nsec));
+}
+
+/* Register a writer with RWLOCK, which prevents readers from using the
+   bias, and wait until the readers which hold RWLOCK through the bias
+   have released it.  If WAIT is false and there are such readers,
+   unregister again and return EBUSY.  If ABSTIME is not NULL and it
+   passes on clock CLOCKID before the readers have released RWLOCK,
+   unregister again and return ETIMEDOUT.  Otherwise, return 0; the
+   writer must then call __pthread_rwlock_bias_release after it has
+   released RWLOCK or failed to acquire it.  */
+int
+__pthread_rwlock_bias_revoke (pthread_rwlock_t *rwlock, bool wait,
+			      clockid_t clockid,
+			      const struct timespec *abstime)
+{
+  unsigned int b = atomic_load_relaxed (&rwlock->__data.__rwbias);
+  while (!atomic_compare_exchange_weak_relaxed
+	 (&rwlock->__data.__rwbias, &b,
+	  (b & ~PTHREAD_RWLOCK_BIASED) + PTHREAD_RWLOCK_BIAS_WRITER))
+    ;
+
+  /* If the lock was neither biased nor being revoked by another
+     writer, the previous writer has released all slots.  */
+  if (b == 0)
+    return 0;
+
+  /* Pairs with the fence in __pthread_rwlock_bias_rdlock.  */
+  atomic_thread_fence_seq_cst ();
+
+  unsigned int start = bias_clock ();
+  for (size_t i = 0; i < PTHREAD_RWLOCK_BIAS_SLOTS; ++i)
+    {
+      /* Acquire MO so that we synchronize with the release of the read
+	 lock.  */
+      pthread_rwlock_t **slot = &__pthread_rwlock_bias_table[i];
+      int spins = 0;
+      while (atomic_load_acquire (slot) == rwlock)
+	{
+	  if (!wait)
+	    {
+	      __pthread_rwlock_bias_release (rwlock);
+	      return EBUSY;
+	    }
+	  if (abstime != NULL && bias_expired (clockid, abstime))
+	    {
+	      __pthread_rwlock_bias_release (rwlock);
+	      return ETIMEDOUT;
+	    }
+	  if (++spins < PTHREAD_RWLOCK_BIAS_SPINS)
+	    atomic_spin_nop ();
+	  else
+	    {
+	      spins = 0;
+	      sched_yield ();
+	    }
+	}
+    }
+
+  if ((b & PTHREAD_RWLOCK_BIASED) != 0)
+    {
+      unsigned int now = bias_clock ();
+      unsigned int inhibit = ((now - start + 1)
+			      * PTHREAD_RWLOCK_BIAS_INHIBIT);
+      if (inhibit > PTHREAD_RWLOCK_BIAS_MAX_INHIBIT)
+	inhibit = PTHREAD_RWLOCK_BIAS_MAX_INHIBIT;
+      atomic_store_relaxed (&rwlock->__data.__rwbias_inhibit,
+			    now + inhibit);
+    }
+  return 0;
+}
+
+/* Unregister a writer registered by __pthread_rwlock_bias_revoke.  */
+void
+__pthread_rwlock_bias_release (pthread_rwlock_t *rwlock)
+{
+  atomic_fetch_add_relaxed (&rwlock->__data.__rwbias,
+			    -PTHREAD_RWLOCK_BIAS_WRITER);
+}
+
+/* Bias RWLOCK towards readers again unless a writer has revoked the
+   bias recently or is still registered.  Called by readers which hold
+   a read lock on RWLOCK through __readers.  */
+void
+__pthread_rwlock_bias_enable (pthread_rwlock_t *rwlock)
+{
+  if (rwlock->__data.__shared != 0)
+    return;
+
+  /* The difference exceeds the maximum if the inhibit time has passed,
+     including if the clock has wrapped around since.  */
+  unsigned int inhibit
+    = atomic_load_relaxed (&rwlock->__data.__rwbias_inhibit);
+  if (inhibit - bias_clock () <= PTHREAD_RWLOCK_BIAS_MAX_INHIBIT)
+    return;
+
+  /* Release MO so that readers which acquire the lock through the bias
+     synchronize with the writers which we synchronized with.  */
+  unsigned int b = 0;
+  atomic_compare_exchange_weak_release (&rwlock->__data.__rwbias, &b,
+					PTHREAD_RWLOCK_BIASED);
+}
@@ -17,6 +17,7 @@
    <http://www.gnu.org/licenses/>.  */
 
 #include <errno.h>
+#include <stdint.h>
 #include <sysdep.h>
 #include <pthread.h>
 #include <pthreadP.h>
@@ -207,6 +208,12 @@
    POSIX allows but does not require rwlock acquisitions to be a cancellation
    point.  We do not support cancellation.
 
+   Rwlocks of kind PTHREAD_RWLOCK_PREFER_READER_BIASED_NP prefer readers
+   and additionally let readers bypass __readers while no writer has used
+   the lock recently; see pthread_rwlock_bias.c.  The functions ending in
+   _slow implement the algorithm described above, and the functions
+   ending in _full add the bias on top of it.
+
    TODO We do not try to elide any read or write lock acquisitions currently.
    While this would be possible, it is unclear whether HTM performance is
    currently predictable enough and our runtime tuning is good enough at
@@ -220,9 +227,67 @@ __pthread_rwlock_get_private (pthread_rwlock_t *rwlock)
   return rwlock->__data.__shared != 0 ? FUTEX_SHARED : FUTEX_PRIVATE;
 }
 
+/* Return the slot of __pthread_rwlock_bias_table which the calling
+   thread uses for RWLOCK.  See pthread_rwlock_bias.c.  The thread
+   descriptor is used rather than the TID because it stays the same in
+   the child after fork.  */
+static __always_inline pthread_rwlock_t **
+__pthread_rwlock_bias_slot (pthread_rwlock_t *rwlock)
+{
+  uint32_t h = ((uint32_t) ((uintptr_t) rwlock >> 3)
+		^ ((uint32_t) ((uintptr_t) THREAD_SELF >> 6) * 0x9e3779b1U));
+  h *= 0x9e3779b1U;
+  return &__pthread_rwlock_bias_table[h >> (32 - PTHREAD_RWLOCK_BIAS_BITS)];
+}
+
+/* Try to acquire a read lock on RWLOCK through its reader bias.  */
+static __always_inline bool
+__pthread_rwlock_bias_rdlock (pthread_rwlock_t *rwlock)
+{
+  if ((atomic_load_relaxed (&rwlock->__data.__rwbias)
+       & PTHREAD_RWLOCK_BIASED) == 0)
+    return false;
+
+  pthread_rwlock_t **slot = __pthread_rwlock_bias_slot (rwlock);
+  pthread_rwlock_t *expected = NULL;
+  if (!atomic_compare_exchange_weak_relaxed (slot, &expected, rwlock))
+    return false;
+  /* Pairs with the fence in __pthread_rwlock_bias_revoke.  Acquire MO
+     on the load so that we synchronize with the reader which enabled
+     the bias, and thus with the writers before it.  */
+  atomic_thread_fence_seq_cst ();
+  if ((atomic_load_acquire (&rwlock->__data.__rwbias)
+       & PTHREAD_RWLOCK_BIASED) != 0)
+    return true;
+
+  /* A writer has revoked the bias.  We have not acquired anything, so
+     relaxed MO is sufficient.  */
+  atomic_store_relaxed (slot, NULL);
+  return false;
+}
+
+/* Release a read lock on RWLOCK which is held through the slot of the
+   calling thread, if the slot refers to RWLOCK.  */
+static __always_inline bool
+__pthread_rwlock_bias_rdunlock (pthread_rwlock_t *rwlock)
+{
+  pthread_rwlock_t **slot = __pthread_rwlock_bias_slot (rwlock);
+  pthread_rwlock_t *expected = atomic_load_relaxed (slot);
+  /* Release MO so that writers waiting for the slot synchronize with
+     us.  */
+  while (expected == rwlock)
+    if (atomic_compare_exchange_weak_release (slot, &expected, NULL))
+      return true;
+  return false;
+}
+
 static __always_inline void
 __pthread_rwlock_rdunlock (pthread_rwlock_t *rwlock)
 {
+  if (rwlock->__data.__flags == PTHREAD_RWLOCK_PREFER_READER_BIASED_NP
+      && __pthread_rwlock_bias_rdunlock (rwlock))
+    return;
+
   int private = __pthread_rwlock_get_private (rwlock);
   /* We decrease the number of readers, and if we are the last reader and
      there is a primary writer, we start a write phase.  We use a CAS to
@@ -277,7 +342,7 @@ __pthread_rwlock_rdunlock (pthread_rwlock_t *rwlock)
 
 
 static __always_inline int
-__pthread_rwlock_rdlock_full (pthread_rwlock_t *rwlock,
+__pthread_rwlock_rdlock_slow (pthread_rwlock_t *rwlock,
     const struct timespec *abstime)
 {
   unsigned int r;
@@ -511,11 +576,31 @@ __pthread_rwlock_rdlock_full (pthread_rwlock_t *rwlock,
 }
 
 
+static __always_inline int
+__pthread_rwlock_rdlock_full (pthread_rwlock_t *rwlock,
+    const struct timespec *abstime)
+{
+  if (rwlock->__data.__flags != PTHREAD_RWLOCK_PREFER_READER_BIASED_NP)
+    return __pthread_rwlock_rdlock_slow (rwlock, abstime);
+
+  if (__pthread_rwlock_bias_rdlock (rwlock))
+    return 0;
+  int result = __pthread_rwlock_rdlock_slow (rwlock, abstime);
+  /* We hold a read lock, so no writer can be active.  */
+  if (result == 0 && atomic_load_relaxed (&rwlock->__data.__rwbias) == 0)
+    __pthread_rwlock_bias_enable (rwlock);
+  return result;
+}
+
+
 static __always_inline void
 __pthread_rwlock_wrunlock (pthread_rwlock_t *rwlock)
 {
   int private = __pthread_rwlock_get_private (rwlock);
 
+  if (rwlock->__data.__flags == PTHREAD_RWLOCK_PREFER_READER_BIASED_NP)
+    __pthread_rwlock_bias_release (rwlock);
+
   atomic_store_relaxed (&rwlock->__data.__cur_writer, 0);
   /* Disable waiting by writers.  We will wake up after we decided how to
      proceed.  */
@@ -523,7 +608,7 @@ __pthread_rwlock_wrunlock (pthread_rwlock_t *rwlock)
     = ((atomic_exchange_relaxed (&rwlock->__data.__writers_futex, 0)
 	& PTHREAD_RWLOCK_FUTEX_USED) != 0);
 
-  if (rwlock->__data.__flags != PTHREAD_RWLOCK_PREFER_READER_NP)
+  if (__pthread_rwlock_prefer_writer (rwlock))
     {
       /* First, try to hand over to another writer.  */
       unsigned int w = atomic_load_relaxed (&rwlock->__data.__writers);
@@ -573,7 +658,7 @@ __pthread_rwlock_wrunlock (pthread_rwlock_t *rwlock)
 
 
 static __always_inline int
-__pthread_rwlock_wrlock_full (pthread_rwlock_t *rwlock,
+__pthread_rwlock_wrlock_slow (pthread_rwlock_t *rwlock,
     const struct timespec *abstime)
 {
   /* Make sure we are not holding the rwlock as a writer.  This is a deadlock
@@ -602,8 +687,7 @@ __pthread_rwlock_wrlock_full (pthread_rwlock_t *rwlock,
   if (__glibc_unlikely ((r & PTHREAD_RWLOCK_WRLOCKED) != 0))
     {
       /* There is another primary writer.  */
-      bool prefer_writer
-	= (rwlock->__data.__flags != PTHREAD_RWLOCK_PREFER_READER_NP);
+      bool prefer_writer = __pthread_rwlock_prefer_writer (rwlock);
       if (prefer_writer)
 	{
 	  /* We register as a waiting writer, so that we can make use of
@@ -809,7 +893,7 @@ __pthread_rwlock_wrlock_full (pthread_rwlock_t *rwlock,
 					 abstime, private);
 	  if (err == ETIMEDOUT)
 	    {
-	      if (rwlock->__data.__flags != PTHREAD_RWLOCK_PREFER_READER_NP)
+	      if (__pthread_rwlock_prefer_writer (rwlock))
 		{
 		  /* We try writer--writer hand-over.  */
 		  unsigned int w
@@ -926,3 +1010,23 @@ __pthread_rwlock_wrlock_full (pthread_rwlock_t *rwlock,
 			THREAD_GETMEM (THREAD_SELF, tid));
   return 0;
 }
+
+
+static __always_inline int
+__pthread_rwlock_wrlock_full (pthread_rwlock_t *rwlock,
+    const struct timespec *abstime)
+{
+  if (rwlock->__data.__flags != PTHREAD_RWLOCK_PREFER_READER_BIASED_NP)
+    return __pthread_rwlock_wrlock_slow (rwlock, abstime);
+
+  /* ABSTIME is relative to CLOCK_REALTIME, as in the futex waits of
+     __pthread_rwlock_wrlock_slow.  */
+  int result = __pthread_rwlock_bias_revoke (rwlock, true, CLOCK_REALTIME,
+					     abstime);
+  if (result != 0)
+    return result;
+  result = __pthread_rwlock_wrlock_slow (rwlock, abstime);
+  if (result != 0)
+    __pthread_rwlock_bias_release (rwlock);
+  return result;
+}
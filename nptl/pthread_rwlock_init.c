@@ -45,6 +45,11 @@ __pthread_rwlock_init (pthread_rwlock_t *rwlock,
   /* The value of __SHARED in a private rwlock must be zero.  */
   rwlock->__data.__shared = (iattr->pshared != PTHREAD_PROCESS_PRIVATE);
 
+  /* See pthread_rwlock_bias.c.  */
+  if (iattr->lockkind == PTHREAD_RWLOCK_PREFER_READER_BIASED_NP
+      && iattr->pshared == PTHREAD_PROCESS_PRIVATE)
+    rwlock->__data.__rwbias = PTHREAD_RWLOCK_BIASED;
+
   return 0;
 }
 strong_alias (__pthread_rwlock_init, pthread_rwlock_init)
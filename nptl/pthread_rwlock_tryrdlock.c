@@ -37,6 +37,10 @@ __pthread_rwlock_tryrdlock (pthread_rwlock_t *rwlock)
      Because POSIX does not require a failed trylock to "synchronize memory",
      relaxed MO is sufficient here and on the failure path of the CAS
      below.  */
+  if (rwlock->__data.__flags == PTHREAD_RWLOCK_PREFER_READER_BIASED_NP
+      && __pthread_rwlock_bias_rdlock (rwlock))
+    return 0;
+
   unsigned int r = atomic_load_relaxed (&rwlock->__data.__readers);
   unsigned int rnew;
   do
@@ -34,9 +34,17 @@ __pthread_rwlock_trywrlock (pthread_rwlock_t *rwlock)
      live-locks / starvation and must not fail spuriously (see there for
      further comments) -- and thus must loop until we get a definitive
      observation or state change.  */
+  bool biased = (rwlock->__data.__flags
+		 == PTHREAD_RWLOCK_PREFER_READER_BIASED_NP);
+  /* Fail if readers hold the lock through the bias.  See
+     pthread_rwlock_bias.c.  */
+  if (biased
+      && __pthread_rwlock_bias_revoke (rwlock, false, CLOCK_REALTIME,
+				       NULL) != 0)
+    return EBUSY;
+
   unsigned int r = atomic_load_relaxed (&rwlock->__data.__readers);
-  bool prefer_writer =
-      (rwlock->__data.__flags != PTHREAD_RWLOCK_PREFER_READER_NP);
+  bool prefer_writer = __pthread_rwlock_prefer_writer (rwlock);
   while (((r & PTHREAD_RWLOCK_WRLOCKED) == 0)
       && (((r >> PTHREAD_RWLOCK_READER_SHIFT) == 0)
 	  || (prefer_writer && ((r & PTHREAD_RWLOCK_WRPHASE) != 0))))
@@ -62,6 +70,8 @@ __pthread_rwlock_trywrlock (pthread_rwlock_t *rwlock)
       /* TODO Back-off.  */
       /* See above.  */
     }
+  if (biased)
+    __pthread_rwlock_bias_release (rwlock);
   return EBUSY;
 }
 
@@ -0,0 +1,129 @@
+/* Test that pthread_cond_broadcast wakes all waiters.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* pthread_cond_broadcast only wakes one waiter and leaves it to the
+   waiters to wake each other.  Check that all waiters get woken, also
+   when their group is closed by a signal before all of them have been
+   woken, when some of the waiters time out, and when the condition
+   variable is destroyed right after the broadcast.  */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <support/check.h>
+#include <support/timespec.h>
+#include <support/xthread.h>
+#include <support/xtime.h>
+
+enum { waiters = 32, rounds = 500 };
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond;
+static pthread_cond_t arrived_cond = PTHREAD_COND_INITIALIZER;
+
+/* Protected by MUTEX.  */
+static unsigned int generation;
+static unsigned int arrived;
+
+static void *
+waiter_thread (void *closure)
+{
+  int id = (uintptr_t) closure;
+
+  xpthread_mutex_lock (&mutex);
+  for (int i = 0; i < rounds; ++i)
+    {
+      unsigned int g = generation;
+      if (++arrived == waiters)
+	TEST_COMPARE (pthread_cond_signal (&arrived_cond), 0);
+      while (generation == g)
+	if (id % 4 == 0)
+	  {
+	    /* Sometimes time out while the other waiters are woken.  */
+	    struct timespec ts;
+	    xclock_gettime (CLOCK_REALTIME, &ts);
+	    ts = timespec_add (ts, make_timespec (0, 100 * 1000));
+	    int ret = pthread_cond_timedwait (&cond, &mutex, &ts);
+	    TEST_VERIFY (ret == 0 || ret == ETIMEDOUT);
+	  }
+	else
+	  xpthread_cond_wait (&cond, &mutex);
+    }
+  xpthread_mutex_unlock (&mutex);
+  return NULL;
+}
+
+/* Keep switching groups by waiting and signaling.  */
+static void *
+noise_thread (void *closure)
+{
+  xpthread_mutex_lock (&mutex);
+  while (generation < rounds - 1)
+    {
+      struct timespec ts;
+      xclock_gettime (CLOCK_REALTIME, &ts);
+      ts = timespec_add (ts, make_timespec (0, 20 * 1000));
+      int ret = pthread_cond_timedwait (&cond, &mutex, &ts);
+      TEST_VERIFY (ret == 0 || ret == ETIMEDOUT);
+      xpthread_mutex_unlock (&mutex);
+      TEST_COMPARE (pthread_cond_signal (&cond), 0);
+      xpthread_mutex_lock (&mutex);
+    }
+  xpthread_mutex_unlock (&mutex);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  pthread_t threads[waiters];
+
+  TEST_COMPARE (pthread_cond_init (&cond, NULL), 0);
+  for (int i = 0; i < waiters; ++i)
+    threads[i] = xpthread_create (NULL, waiter_thread,
+				  (void *) (uintptr_t) i);
+  pthread_t noise = xpthread_create (NULL, noise_thread, NULL);
+
+  xpthread_mutex_lock (&mutex);
+  for (int i = 0; i < rounds; ++i)
+    {
+      while (arrived < waiters)
+	xpthread_cond_wait (&arrived_cond, &mutex);
+      arrived = 0;
+      if (i == rounds - 1)
+	{
+	  xpthread_mutex_unlock (&mutex);
+	  xpthread_join (noise);
+	  xpthread_mutex_lock (&mutex);
+	}
+      ++generation;
+      TEST_COMPARE (pthread_cond_broadcast (&cond), 0);
+    }
+  /* The waiters do not use COND anymore after the last broadcast, so it
+     can be destroyed even though not all of them may have woken up
+     yet.  */
+  TEST_COMPARE (pthread_cond_destroy (&cond), 0);
+  xpthread_mutex_unlock (&mutex);
+
+  for (int i = 0; i < waiters; ++i)
+    xpthread_join (threads[i]);
+  return 0;
+}
+
+#include <support/test-driver.c>
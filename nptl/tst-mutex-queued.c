@@ -0,0 +1,213 @@
+/* Test PTHREAD_MUTEX_QUEUED_NP mutexes.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Waiters which queue up behind a held mutex must get it in the order
+   in which they arrived.  Threads which use pthread_mutex_lock,
+   pthread_mutex_trylock, pthread_mutex_timedlock and condition
+   variables on the same mutex must exclude each other, and timed
+   waiters must give up without disturbing the queue.  */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/timespec.h>
+#include <support/xtime.h>
+#include <support/xthread.h>
+
+static pthread_mutex_t mutex;
+
+enum { waiters = 6 };
+
+static int order[waiters];
+static int arrived;
+
+static void *
+fifo_thread (void *closure)
+{
+  xpthread_mutex_lock (&mutex);
+  order[arrived++] = (uintptr_t) closure;
+  xpthread_mutex_unlock (&mutex);
+  return NULL;
+}
+
+static void
+test_fifo (void)
+{
+  pthread_t threads[waiters];
+
+  xpthread_mutex_lock (&mutex);
+  for (int i = 0; i < waiters; ++i)
+    {
+      threads[i] = xpthread_create (NULL, fifo_thread,
+				    (void *) (uintptr_t) i);
+      /* Give the thread time to join the queue and block.  */
+      usleep (50 * 1000);
+    }
+  xpthread_mutex_unlock (&mutex);
+
+  for (int i = 0; i < waiters; ++i)
+    xpthread_join (threads[i]);
+  TEST_COMPARE (arrived, waiters);
+  for (int i = 0; i < waiters; ++i)
+    TEST_COMPARE (order[i], i);
+}
+
+static void *
+timeout_thread (void *closure)
+{
+  struct timespec ts;
+  xclock_gettime (CLOCK_REALTIME, &ts);
+  ts = timespec_add (ts, make_timespec (0, 20 * 1000 * 1000));
+  TEST_COMPARE (pthread_mutex_timedlock (&mutex, &ts), ETIMEDOUT);
+  return NULL;
+}
+
+static void
+test_timeout (void)
+{
+  pthread_t threads[2];
+
+  /* The first thread times out at the head of the queue, the second
+     one while polling behind a waiter.  */
+  xpthread_mutex_lock (&mutex);
+  TEST_COMPARE (pthread_mutex_trylock (&mutex), EBUSY);
+  xpthread_join (xpthread_create (NULL, timeout_thread, NULL));
+  arrived = 0;
+  threads[0] = xpthread_create (NULL, fifo_thread, (void *) (uintptr_t) 0);
+  usleep (50 * 1000);
+  threads[1] = xpthread_create (NULL, timeout_thread, NULL);
+  xpthread_join (threads[1]);
+  xpthread_mutex_unlock (&mutex);
+  xpthread_join (threads[0]);
+  TEST_COMPARE (arrived, 1);
+}
+
+enum { workers = 8, iterations = 20000 };
+
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static unsigned long counter;
+static unsigned long acquired;
+static int turn;
+
+static void *
+worker_thread (void *closure)
+{
+  int id = (uintptr_t) closure;
+
+  for (int i = 0; i < iterations; ++i)
+    {
+      switch ((id + i) % 4)
+	{
+	case 0:
+	  xpthread_mutex_lock (&mutex);
+	  break;
+	case 1:
+	  if (pthread_mutex_trylock (&mutex) != 0)
+	    continue;
+	  break;
+	case 2:
+	  {
+	    struct timespec ts;
+	    xclock_gettime (CLOCK_REALTIME, &ts);
+	    ts = timespec_add (ts, make_timespec (0, 100 * 1000));
+	    int ret = pthread_mutex_timedlock (&mutex, &ts);
+	    if (ret == ETIMEDOUT)
+	      continue;
+	    TEST_COMPARE (ret, 0);
+	  }
+	  break;
+	case 3:
+	  /* Pass the condition variable around among the workers.  */
+	  xpthread_mutex_lock (&mutex);
+	  if (turn == id)
+	    turn = (turn + 1) % workers;
+	  pthread_cond_broadcast (&cond);
+	  if (i % 64 == 3)
+	    {
+	      struct timespec ts;
+	      xclock_gettime (CLOCK_REALTIME, &ts);
+	      ts = timespec_add (ts, make_timespec (0, 1000 * 1000));
+	      while (turn != id)
+		if (pthread_cond_timedwait (&cond, &mutex, &ts) == ETIMEDOUT)
+		  break;
+	    }
+	  break;
+	}
+
+      unsigned long c = counter;
+      if (i % 128 == 0)
+	sched_yield ();
+      counter = c + 1;
+      ++acquired;
+      xpthread_mutex_unlock (&mutex);
+    }
+  return NULL;
+}
+
+static void
+test_contention (void)
+{
+  pthread_t threads[workers];
+
+  for (int i = 0; i < workers; ++i)
+    threads[i] = xpthread_create (NULL, worker_thread,
+				  (void *) (uintptr_t) i);
+  for (int i = 0; i < workers; ++i)
+    xpthread_join (threads[i]);
+  TEST_COMPARE (counter, acquired);
+  TEST_VERIFY (acquired >= workers * iterations / 2);
+}
+
+static int
+do_test (void)
+{
+  pthread_mutexattr_t attr;
+  int kind;
+
+  xpthread_mutexattr_init (&attr);
+  xpthread_mutexattr_settype (&attr, PTHREAD_MUTEX_QUEUED_NP);
+  TEST_COMPARE (pthread_mutexattr_gettype (&attr, &kind), 0);
+  TEST_COMPARE (kind, PTHREAD_MUTEX_QUEUED_NP);
+  TEST_COMPARE (pthread_mutexattr_settype (&attr,
+					   PTHREAD_MUTEX_QUEUED_NP + 1),
+		EINVAL);
+
+  /* Only private mutexes without robustness or priority protocol can
+     be queued.  */
+  xpthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_SHARED);
+  TEST_COMPARE (pthread_mutex_init (&mutex, &attr), ENOTSUP);
+  xpthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_PRIVATE);
+  xpthread_mutexattr_setrobust (&attr, PTHREAD_MUTEX_ROBUST);
+  TEST_COMPARE (pthread_mutex_init (&mutex, &attr), ENOTSUP);
+  xpthread_mutexattr_setrobust (&attr, PTHREAD_MUTEX_STALLED);
+
+  xpthread_mutex_init (&mutex, &attr);
+  xpthread_mutexattr_destroy (&attr);
+
+  test_fifo ();
+  test_timeout ();
+  test_contention ();
+
+  xpthread_mutex_destroy (&mutex);
+  return 0;
+}
+
+#include <support/test-driver.c>
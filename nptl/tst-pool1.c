@@ -0,0 +1,123 @@
+/* Basic tests for pthread_pool_create_np and related functions.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Tasks submitted from outside the pool and by other tasks must all
+   run, pthread_pool_wait_np and pthread_pool_destroy_np must wait for
+   all of them, and waiting from a worker must be refused.  */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/support.h>
+
+static pthread_pool_t pool;
+
+static unsigned int counter;
+
+static void
+count_task (void *closure)
+{
+  __atomic_fetch_add (&counter, 1, __ATOMIC_RELAXED);
+}
+
+/* Compute the Fibonacci number N recursively, with one task per
+   call.  */
+
+struct fib
+{
+  int n;
+  unsigned long *result;
+};
+
+static void
+fib_task (void *closure)
+{
+  struct fib *f = closure;
+
+  if (f->n < 2)
+    __atomic_fetch_add (f->result, f->n, __ATOMIC_RELAXED);
+  else
+    for (int i = 1; i <= 2; ++i)
+      {
+	struct fib *sub = xmalloc (sizeof (*sub));
+	sub->n = f->n - i;
+	sub->result = f->result;
+	TEST_COMPARE (pthread_pool_submit_np (pool, fib_task, sub), 0);
+      }
+  free (f);
+}
+
+static void
+wait_task (void *closure)
+{
+  int *ret = closure;
+  *ret = pthread_pool_wait_np (pool);
+}
+
+static void
+slow_task (void *closure)
+{
+  usleep (10 * 1000);
+  count_task (closure);
+}
+
+static int
+do_test (void)
+{
+  TEST_COMPARE (pthread_pool_create_np (&pool, 0), EINVAL);
+
+  for (unsigned int nthreads = 1; nthreads <= 4; nthreads *= 2)
+    {
+      TEST_COMPARE (pthread_pool_create_np (&pool, nthreads), 0);
+
+      /* Waiting without tasks returns immediately.  */
+      TEST_COMPARE (pthread_pool_wait_np (pool), 0);
+
+      counter = 0;
+      for (int i = 0; i < 1000; ++i)
+	TEST_COMPARE (pthread_pool_submit_np (pool, count_task, NULL), 0);
+      TEST_COMPARE (pthread_pool_wait_np (pool), 0);
+      TEST_COMPARE (counter, 1000);
+
+      unsigned long result = 0;
+      struct fib *f = xmalloc (sizeof (*f));
+      f->n = 20;
+      f->result = &result;
+      TEST_COMPARE (pthread_pool_submit_np (pool, fib_task, f), 0);
+      TEST_COMPARE (pthread_pool_wait_np (pool), 0);
+      TEST_COMPARE (result, 6765);
+
+      int ret = 0;
+      TEST_COMPARE (pthread_pool_submit_np (pool, wait_task, &ret), 0);
+      TEST_COMPARE (pthread_pool_wait_np (pool), 0);
+      TEST_COMPARE (ret, EDEADLK);
+
+      /* pthread_pool_destroy_np waits for the remaining tasks.  */
+      counter = 0;
+      for (int i = 0; i < 10; ++i)
+	TEST_COMPARE (pthread_pool_submit_np (pool, slow_task, NULL), 0);
+      TEST_COMPARE (pthread_pool_destroy_np (pool), 0);
+      TEST_COMPARE (counter, 10);
+    }
+
+  return 0;
+}
+
+#include <support/test-driver.c>
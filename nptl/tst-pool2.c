@@ -0,0 +1,94 @@
+/* Stress test for pthread_pool_submit_np.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Several threads submit tasks concurrently, and each task submits a
+   burst of subtasks which fills the deque of its worker beyond its
+   initial size, while the other workers steal from it.  Every task
+   must run exactly once.  */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+enum
+{
+  submitters = 4,
+  tasks = 2000,
+  subtasks = 100,
+  rounds = 5,
+  total = submitters * tasks * (subtasks + 1)
+};
+
+static pthread_pool_t pool;
+
+static unsigned char runs[total];
+
+static void
+leaf_task (void *closure)
+{
+  __atomic_fetch_add (&runs[(uintptr_t) closure], 1, __ATOMIC_RELAXED);
+}
+
+static void
+burst_task (void *closure)
+{
+  uintptr_t id = (uintptr_t) closure;
+  leaf_task (closure);
+  for (uintptr_t i = 1; i <= subtasks; ++i)
+    TEST_COMPARE (pthread_pool_submit_np (pool, leaf_task,
+					  (void *) (id + i)), 0);
+}
+
+static void *
+submitter_thread (void *closure)
+{
+  uintptr_t first = (uintptr_t) closure * tasks * (subtasks + 1);
+  for (uintptr_t i = 0; i < tasks; ++i)
+    TEST_COMPARE (pthread_pool_submit_np (pool, burst_task,
+					  (void *) (first
+						    + i * (subtasks + 1))),
+		  0);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  for (int round = 0; round < rounds; ++round)
+    {
+      TEST_COMPARE (pthread_pool_create_np (&pool, 4), 0);
+      __builtin_memset (runs, 0, sizeof (runs));
+
+      pthread_t threads[submitters];
+      for (uintptr_t i = 0; i < submitters; ++i)
+	threads[i] = xpthread_create (NULL, submitter_thread, (void *) i);
+      for (int i = 0; i < submitters; ++i)
+	xpthread_join (threads[i]);
+      TEST_COMPARE (pthread_pool_wait_np (pool), 0);
+
+      for (uintptr_t i = 0; i < total; ++i)
+	if (runs[i] != 1)
+	  FAIL_EXIT1 ("task %lu ran %d times", (unsigned long) i, runs[i]);
+      TEST_COMPARE (pthread_pool_destroy_np (pool), 0);
+    }
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,282 @@
+/* Test PTHREAD_RWLOCK_PREFER_READER_BIASED_NP rwlocks.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Readers and writers using all acquisition functions must exclude
+   each other while the lock switches between the biased and the
+   ordinary read path.  A reader which acquires the lock recursively
+   while a writer waits must not deadlock, and a child process must be
+   able to release a read lock which the parent acquired through the
+   bias.  */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/timespec.h>
+#include <support/xthread.h>
+#include <support/xtime.h>
+#include <support/xunistd.h>
+#include <sys/wait.h>
+
+static pthread_rwlock_t lock;
+
+/* Protected by LOCK, and always equal outside write critical
+   sections.  */
+static volatile unsigned long first;
+static volatile unsigned long second;
+
+enum { readers = 8, writers = 2, iterations = 20000 };
+
+static struct timespec
+timeout (void)
+{
+  struct timespec ts;
+  xclock_gettime (CLOCK_REALTIME, &ts);
+  return timespec_add (ts, make_timespec (0, 10 * 1000 * 1000));
+}
+
+static void *
+reader_thread (void *closure)
+{
+  int id = (uintptr_t) closure;
+
+  for (int i = 0; i < iterations; ++i)
+    {
+      switch ((id + i) % 3)
+	{
+	case 0:
+	  xpthread_rwlock_rdlock (&lock);
+	  break;
+	case 1:
+	  if (pthread_rwlock_tryrdlock (&lock) != 0)
+	    continue;
+	  break;
+	case 2:
+	  {
+	    struct timespec ts = timeout ();
+	    int ret = pthread_rwlock_timedrdlock (&lock, &ts);
+	    if (ret == ETIMEDOUT)
+	      continue;
+	    TEST_COMPARE (ret, 0);
+	  }
+	  break;
+	}
+      TEST_VERIFY (first == second);
+      xpthread_rwlock_unlock (&lock);
+    }
+  return NULL;
+}
+
+static void *
+writer_thread (void *closure)
+{
+  int id = (uintptr_t) closure;
+
+  for (int i = 0; i < iterations / 20; ++i)
+    {
+      switch ((id + i) % 3)
+	{
+	case 0:
+	  xpthread_rwlock_wrlock (&lock);
+	  break;
+	case 1:
+	  if (pthread_rwlock_trywrlock (&lock) != 0)
+	    continue;
+	  break;
+	case 2:
+	  {
+	    struct timespec ts = timeout ();
+	    int ret = pthread_rwlock_timedwrlock (&lock, &ts);
+	    if (ret == ETIMEDOUT)
+	      continue;
+	    TEST_COMPARE (ret, 0);
+	  }
+	  break;
+	}
+      ++first;
+      if (i % 16 == 0)
+	sched_yield ();
+      ++second;
+      xpthread_rwlock_unlock (&lock);
+      usleep (100);
+    }
+  return NULL;
+}
+
+static void
+test_contention (void)
+{
+  pthread_t threads[readers + writers];
+
+  for (int i = 0; i < readers; ++i)
+    threads[i] = xpthread_create (NULL, reader_thread,
+				  (void *) (uintptr_t) i);
+  for (int i = 0; i < writers; ++i)
+    threads[readers + i] = xpthread_create (NULL, writer_thread,
+					    (void *) (uintptr_t) i);
+  for (int i = 0; i < readers + writers; ++i)
+    xpthread_join (threads[i]);
+  TEST_COMPARE (first, second);
+}
+
+static void *
+wrlock_thread (void *closure)
+{
+  xpthread_rwlock_wrlock (&lock);
+  ++first;
+  ++second;
+  xpthread_rwlock_unlock (&lock);
+  return NULL;
+}
+
+static void
+test_recursive (void)
+{
+  unsigned long before = first;
+
+  xpthread_rwlock_rdlock (&lock);
+  pthread_t thr = xpthread_create (NULL, wrlock_thread, NULL);
+  /* Give the writer time to start waiting.  */
+  usleep (50 * 1000);
+  xpthread_rwlock_rdlock (&lock);
+  TEST_COMPARE (first, before);
+  xpthread_rwlock_unlock (&lock);
+  xpthread_rwlock_unlock (&lock);
+  xpthread_join (thr);
+  TEST_COMPARE (first, before + 1);
+
+  /* A writer fails to acquire the lock while it is read-locked, and
+     does not keep readers out after that.  */
+  xpthread_rwlock_rdlock (&lock);
+  TEST_COMPARE (pthread_rwlock_trywrlock (&lock), EBUSY);
+  TEST_COMPARE (pthread_rwlock_tryrdlock (&lock), 0);
+  xpthread_rwlock_unlock (&lock);
+  xpthread_rwlock_unlock (&lock);
+  TEST_COMPARE (pthread_rwlock_trywrlock (&lock), 0);
+  TEST_COMPARE (pthread_rwlock_rdlock (&lock), EDEADLK);
+  xpthread_rwlock_unlock (&lock);
+}
+
+/* Wait for the bias to be restored after the writers above.  */
+static void
+wait_for_bias (void)
+{
+  for (int i = 0; i < 10; ++i)
+    {
+      xpthread_rwlock_rdlock (&lock);
+      xpthread_rwlock_unlock (&lock);
+      usleep (20 * 1000);
+    }
+}
+
+static void
+test_fork (void)
+{
+  wait_for_bias ();
+
+  xpthread_rwlock_rdlock (&lock);
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      xpthread_rwlock_unlock (&lock);
+      TEST_COMPARE (pthread_rwlock_trywrlock (&lock), 0);
+      xpthread_rwlock_unlock (&lock);
+      _exit (0);
+    }
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_VERIFY (WIFEXITED (status) && WEXITSTATUS (status) == 0);
+  xpthread_rwlock_unlock (&lock);
+}
+
+static pthread_barrier_t barrier;
+
+static void *
+rdlock_thread (void *closure)
+{
+  xpthread_rwlock_rdlock (&lock);
+  xpthread_barrier_wait (&barrier);
+  /* Hold the lock until the writer has timed out.  */
+  xpthread_barrier_wait (&barrier);
+  xpthread_rwlock_unlock (&lock);
+  return NULL;
+}
+
+static void
+test_timedwrlock (void)
+{
+  wait_for_bias ();
+
+  /* A reader which keeps holding the lock, through the bias if it is
+     in effect, must not delay the timeout of a writer.  */
+  xpthread_barrier_init (&barrier, NULL, 2);
+  pthread_t thr = xpthread_create (NULL, rdlock_thread, NULL);
+  xpthread_barrier_wait (&barrier);
+
+  struct timespec start;
+  xclock_gettime (CLOCK_REALTIME, &start);
+  struct timespec ts = timespec_add (start, make_timespec (0, 100000000));
+  TEST_COMPARE (pthread_rwlock_timedwrlock (&lock, &ts), ETIMEDOUT);
+  struct timespec end;
+  xclock_gettime (CLOCK_REALTIME, &end);
+  TEST_VERIFY (timespec_sub (end, start).tv_sec < 5);
+
+  /* The failed writer does not keep readers out.  */
+  TEST_COMPARE (pthread_rwlock_tryrdlock (&lock), 0);
+  xpthread_rwlock_unlock (&lock);
+
+  xpthread_barrier_wait (&barrier);
+  xpthread_join (thr);
+  xpthread_barrier_destroy (&barrier);
+
+  TEST_COMPARE (pthread_rwlock_trywrlock (&lock), 0);
+  xpthread_rwlock_unlock (&lock);
+}
+
+static int
+do_test (void)
+{
+  pthread_rwlockattr_t attr;
+  int kind;
+
+  xpthread_rwlockattr_init (&attr);
+  xpthread_rwlockattr_setkind_np (&attr,
+				  PTHREAD_RWLOCK_PREFER_READER_BIASED_NP);
+  TEST_COMPARE (pthread_rwlockattr_getkind_np (&attr, &kind), 0);
+  TEST_COMPARE (kind, PTHREAD_RWLOCK_PREFER_READER_BIASED_NP);
+
+  for (int shared = 0; shared < 2; ++shared)
+    {
+      TEST_COMPARE (pthread_rwlockattr_setpshared
+		    (&attr, shared ? PTHREAD_PROCESS_SHARED
+		     : PTHREAD_PROCESS_PRIVATE), 0);
+      xpthread_rwlock_init (&lock, &attr);
+      test_contention ();
+      test_recursive ();
+      test_fork ();
+      test_timedwrlock ();
+      xpthread_rwlock_destroy (&lock);
+    }
+
+  pthread_rwlockattr_destroy (&attr);
+  return 0;
+}
+
+#include <support/test-driver.c>
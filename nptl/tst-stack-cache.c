@@ -0,0 +1,136 @@
+/* Test the stack cache and the glibc.pthread.stack_hugepage tunable.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Several threads create joinable and detached threads with stacks of
+   different sizes at the same time, so that stacks move between the
+   shards of the cache, which is small enough to be trimmed often.  The
+   stacks of at least one huge page must be aligned and usable, and a
+   child process must be able to create threads from the recycled
+   stacks.  */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stackinfo.h>
+#include <support/check.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+#include <sys/wait.h>
+
+/* Matches GLIBC_TUNABLES in the Makefile.  */
+enum { hugepage = 2 * 1024 * 1024 };
+
+enum { creators = 4, rounds = 50 };
+
+static const size_t sizes[] =
+  { 64 * 1024, 256 * 1024, hugepage + 100 * 1024, 3 * hugepage };
+
+static void *
+thread_func (void *closure)
+{
+  size_t size = (uintptr_t) closure;
+
+  pthread_attr_t attr;
+  void *addr;
+  size_t actual;
+  TEST_COMPARE (pthread_getattr_np (pthread_self (), &attr), 0);
+  TEST_COMPARE (pthread_attr_getstack (&attr, &addr, &actual), 0);
+  xpthread_attr_destroy (&attr);
+  TEST_VERIFY (actual >= size / 2);
+
+#if _STACK_GROWS_DOWN
+  if (size >= hugepage)
+    {
+      uintptr_t top = (uintptr_t) addr + actual;
+      if (top % hugepage != 0)
+	{
+	  printf ("error: stack of %zu bytes ends at %p\n",
+		  size, (void *) top);
+	  support_record_failure ();
+	}
+    }
+#endif
+
+  /* Use a good part of the stack.  */
+  char buffer[size / 4];
+  memset (buffer, 0xa5, sizeof (buffer));
+  __asm__ volatile ("" : : "r" (buffer) : "memory");
+
+  return NULL;
+}
+
+static void
+create_threads (int seed)
+{
+  pthread_attr_t attr;
+  xpthread_attr_init (&attr);
+
+  for (int i = 0; i < rounds; ++i)
+    {
+      size_t size = sizes[(i + seed) % (sizeof (sizes) / sizeof (sizes[0]))];
+      xpthread_attr_setstacksize (&attr, size);
+      if (i % 3 == 0)
+	{
+	  xpthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+	  pthread_t thr = xpthread_create (&attr, thread_func,
+					   (void *) (uintptr_t) size);
+	  (void) thr;
+	  xpthread_attr_setdetachstate (&attr, PTHREAD_CREATE_JOINABLE);
+	}
+      else
+	xpthread_join (xpthread_create (&attr, thread_func,
+					(void *) (uintptr_t) size));
+    }
+
+  xpthread_attr_destroy (&attr);
+}
+
+static void *
+creator (void *closure)
+{
+  create_threads ((uintptr_t) closure);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  pthread_t threads[creators];
+  for (int i = 0; i < creators; ++i)
+    threads[i] = xpthread_create (NULL, creator, (void *) (uintptr_t) i);
+  for (int i = 0; i < creators; ++i)
+    xpthread_join (threads[i]);
+
+  /* The stacks of all threads are in the cache or unmapped now, apart
+     from detached threads which are still exiting.  */
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      create_threads (0);
+      _exit (support_record_failure_is_failed () ? 1 : 0);
+    }
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_VERIFY (WIFEXITED (status) && WEXITSTATUS (status) == 0);
+
+  create_threads (1);
+  return 0;
+}
+
+#include <support/test-driver.c>
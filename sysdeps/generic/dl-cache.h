@@ -89,15 +89,64 @@ struct cache_file_new
   char version[sizeof CACHE_VERSION - 1];
   uint32_t nlibs;		/* Number of entries.  */
   uint32_t len_strings;		/* Size of string table. */
-  uint32_t unused[5];		/* Leave space for future extensions
+  uint32_t hash_offset;		/* Offset of the cache_hash_index from
+				   the start of this structure, or 0.  */
+  uint32_t unused[4];		/* Leave space for future extensions
 				   and align to 8 byte boundary.  */
   struct file_entry_new libs[0]; /* Entries describing libraries.  */
   /* After this the string table of size len_strings is found.	*/
 };
 
+/* Hash index of the entries of struct cache_file_new, which is found
+   after its string table.  Older dynamic linkers ignore it and use a
+   binary search.  Entries for the same name are adjacent in the
+   cache; the index refers to the first of them.  It is followed by
+
+	buckets[nbuckets]
+	chain[nlibs]
+	hashes[nlibs]
+
+   where all elements are uint32_t.  A bucket holds 1 plus the index
+   of the first entry of the first name with a hash in that bucket, or
+   0 if there is none.  The chain element of the first entry of a name
+   holds the same for the next name in that bucket.  hashes holds the
+   _dl_cache_hash value of the name of each entry.  */
+struct cache_hash_index
+{
+  uint32_t nbuckets;		/* Number of hash buckets.  */
+  uint32_t unused;		/* Leave space for future extensions.  */
+  uint32_t buckets[0];
+};
+
+/* Alignment of the cache_hash_index.  */
+#define ALIGN_CACHE_HASH(addr)				\
+(((addr) + __alignof__ (struct cache_hash_index) - 1)	\
+ & (~(__alignof__ (struct cache_hash_index) - 1)))
+
 /* Used to align cache_file_new.  */
 #define ALIGN_CACHE(addr)				\
 (((addr) + __alignof__ (struct cache_file_new) -1)	\
  & (~(__alignof__ (struct cache_file_new) - 1)))
 
 extern int _dl_cache_libcmp (const char *p1, const char *p2) attribute_hidden;
+
+/* Hash function for the cache_hash_index.  Numbers are hashed by their
+   value, so that names which _dl_cache_libcmp considers equal have the
+   same hash.  */
+static inline uint32_t
+_dl_cache_hash (const char *name)
+{
+  uint32_t hash = 5381;
+  while (*name != '\0')
+    if (*name >= '0' && *name <= '9')
+      {
+	hash = hash * 33 + '0';
+	while (*name == '0')
+	  ++name;
+	while (*name >= '0' && *name <= '9')
+	  hash = hash * 33 + *name++;
+      }
+    else
+      hash = hash * 33 + (unsigned char) *name++;
+  return hash;
+}
@@ -191,6 +191,11 @@ struct r_search_path_elem
     const char *dirname;
     size_t dirnamelen;
 
+    /* Indexes of the file names in the directory for each hardware
+       capability subdirectory, built while the initial objects are
+       loaded.  NULL if none has been built yet.  */
+    struct r_dir_index **dir_index;
+
     enum r_dir_status status[0];
   };
 
@@ -358,6 +363,7 @@ struct rtld_global
   /* Counters for the number of relocations performed.  */
   EXTERN unsigned long int _dl_num_relocations;
   EXTERN unsigned long int _dl_num_cache_relocations;
+  EXTERN unsigned long int _dl_num_memo_relocations;
 
   /* List of search directories.  */
   EXTERN struct r_search_path_elem *_dl_all_dirs;
@@ -413,6 +419,10 @@ struct rtld_global
   EXTERN size_t _dl_tls_static_used;
   /* Alignment requirement of the static TLS block.  */
   EXTERN size_t _dl_tls_static_align;
+  /* Remaining part of the static TLS surplus which dlopen may use for
+     objects that do not need static TLS.  It is not given back when
+     such an object is unloaded.  */
+  EXTERN size_t _dl_tls_static_optional;
 
 /* Number of additional entries in the slotinfo array of each slotinfo
    list element.  A large number makes it almost certain take we never
@@ -909,6 +919,15 @@ extern lookup_t _dl_lookup_symbol_x (const char *undef,
 				     struct link_map *skip_map)
      attribute_hidden;
 
+/* Remember the results of _dl_lookup_symbol_x for lookups in
+   SYMBOL_SCOPE alone until _dl_lookup_memo_end is called, so that
+   repeated lookups of the same symbol from different objects do not
+   search the scope again.  The objects in the scope must not change in
+   the meantime, and only one thread may look up symbols.  */
+extern void _dl_lookup_memo_start (struct r_scope_elem *symbol_scope)
+     attribute_hidden;
+extern void _dl_lookup_memo_end (void) attribute_hidden;
+
 
 /* Add the new link_map NEW to the end of the namespace list.  */
 extern void _dl_add_to_namespace_list (struct link_map *new, Lmid_t nsid)
@@ -928,6 +947,14 @@ extern void _dl_relocate_object (struct link_map *map,
 				 int reloc_mode, int consider_profiling)
      attribute_hidden;
 
+/* Relocate the objects needed by MAIN_MAP other than the dynamic
+   linker and MAIN_MAP itself in parallel, if the glibc.rtld.reloc_threads
+   tunable asks for it.  RELOC_MODE is passed to _dl_relocate_object.
+   The objects are marked as relocated, so the caller can relocate all
+   of them afterwards.  */
+extern void _dl_relocate_parallel (struct link_map *main_map,
+				   int reloc_mode) attribute_hidden;
+
 /* Protect PT_GNU_RELRO area.  */
 extern void _dl_protect_relro (struct link_map *map) attribute_hidden;
 
@@ -1080,6 +1107,11 @@ extern void _dl_get_tls_static_info (size_t *sizep, size_t *alignp);
 
 extern void _dl_allocate_static_tls (struct link_map *map) attribute_hidden;
 
+/* Try to place the TLS block of MAP in the surplus of the static TLS
+   area.  Return 0 on success.  */
+extern int _dl_try_allocate_static_tls (struct link_map *map, bool optional)
+     attribute_hidden;
+
 /* These are internal entry points to the two halves of _dl_allocate_tls,
    only used within rtld.c itself at startup time.  */
 extern void *_dl_allocate_tls_storage (void) attribute_hidden;
@@ -1117,9 +1149,11 @@ extern int _dl_scope_free (void *) attribute_hidden;
 /* Add module to slot information data.  */
 extern void _dl_add_to_slotinfo (struct link_map  *l) attribute_hidden;
 
-/* Update slot information data for at least the generation of the
-   module with the given index.  */
-extern struct link_map *_dl_update_slotinfo (unsigned long int req_modid)
+/* Update the DTV of the calling thread to generation NEW_GEN, which
+   must be at least the generation of the module with the given index.
+   Return the link map of that module if its entry was reset.  */
+extern struct link_map *_dl_update_slotinfo (unsigned long int req_modid,
+					     size_t new_gen)
      attribute_hidden;
 
 /* Look up the module's TLS block as for __tls_get_addr,
@@ -26,3 +26,43 @@ check_may_shrink_heap (void)
 {
   return __libc_enable_secure;
 }
+
+/* Return the size of a transparent huge page if malloc should advise
+   the kernel to use them, or 0 if there is no such support.  */
+static inline size_t
+malloc_thp_pagesize (void)
+{
+  return 0;
+}
+
+/* Compute the page size and the mmap flags to use for allocations
+   backed by explicit huge pages.  Without support from the system
+   *PAGESIZE and *FLAGS are left unchanged.  */
+static inline void
+malloc_hugepage_config (size_t requested, size_t *pagesize, int *flags)
+{
+}
+
+/* Return the number of the CPU the calling thread is running on, or -1
+   if it cannot be determined.  If NODE is not NULL, store the NUMA node
+   of that CPU in *NODE.  */
+static inline int
+malloc_getcpu (int *node)
+{
+  return -1;
+}
+
+/* Return the number of NUMA nodes the system can have, or 0 if
+   unknown.  */
+static inline int
+malloc_numa_nodes (void)
+{
+  return 0;
+}
+
+/* Ask the system to take the pages of the LEN bytes at ADDR from NUMA
+   node NODE if possible.  */
+static inline void
+malloc_bind_node (void *addr, size_t len, int node)
+{
+}
@@ -56,6 +56,8 @@ enum
 #ifdef __USE_GNU
   /* For compatibility.  */
   , PTHREAD_MUTEX_FAST_NP = PTHREAD_MUTEX_TIMED_NP
+  /* Waiters are queued and get the mutex in FIFO order.  */
+  , PTHREAD_MUTEX_QUEUED_NP = PTHREAD_MUTEX_ADAPTIVE_NP + 1
 #endif
 };
 
@@ -117,6 +119,9 @@ enum
   PTHREAD_RWLOCK_PREFER_READER_NP,
   PTHREAD_RWLOCK_PREFER_WRITER_NP,
   PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP,
+  /* Prefer readers, and let readers avoid writing to the lock while
+     there are no writers.  */
+  PTHREAD_RWLOCK_PREFER_READER_BIASED_NP,
   PTHREAD_RWLOCK_DEFAULT_NP = PTHREAD_RWLOCK_PREFER_READER_NP
 };
 
@@ -1148,6 +1153,35 @@ extern int pthread_atfork (void (*__prepare) (void),
 			   void (*__child) (void)) __THROW;
 
 
+#ifdef __USE_GNU
+/* Handle of a thread pool.  */
+typedef struct __pthread_pool *pthread_pool_t;
+
+/* Create a thread pool with NTHREADS worker threads and store its
+   handle in *POOL.  */
+extern int pthread_pool_create_np (pthread_pool_t *__pool,
+				   unsigned int __nthreads)
+     __THROW __nonnull ((1));
+
+/* Run FUNC (ARG) on one of the worker threads of POOL.  Tasks submitted
+   by a worker are preferably run by the same worker, most recently
+   submitted first; idle workers take them over otherwise.  */
+extern int pthread_pool_submit_np (pthread_pool_t __pool,
+				   void (*__func) (void *), void *__arg)
+     __THROW __nonnull ((1, 2));
+
+/* Wait until all tasks submitted to POOL have completed, including the
+   tasks which they submit.  */
+extern int pthread_pool_wait_np (pthread_pool_t __pool)
+     __THROW __nonnull ((1));
+
+/* Wait for the tasks of POOL like pthread_pool_wait_np, then terminate
+   its worker threads and free it.  */
+extern int pthread_pool_destroy_np (pthread_pool_t __pool)
+     __THROW __nonnull ((1));
+#endif
+
+
 #ifdef __USE_EXTERN_INLINES
 /* Optimizations.  */
 __extern_inline int
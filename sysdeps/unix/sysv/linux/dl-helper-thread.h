@@ -0,0 +1,105 @@
+/* Helper threads for the dynamic linker.  Linux version.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#ifndef _DL_HELPER_THREAD_H
+#define _DL_HELPER_THREAD_H	1
+
+#include <atomic.h>
+#include <ldsodefs.h>
+#include <limits.h>
+#include <lowlevellock-futex.h>
+#include <sched.h>
+#include <stackinfo.h>
+#include <stdbool.h>
+#include <sysdep.h>
+#include <sys/mman.h>
+
+/* See elf/dl-helper-thread.h.  The threads are created with a raw
+   clone system call.  */
+
+struct dl_helper_thread
+{
+  void *stack;
+  size_t stack_size;
+  /* Set by the kernel when the thread starts and cleared when it has
+     terminated.  */
+  pid_t tid;
+};
+
+static inline bool
+_dl_helper_thread_start (struct dl_helper_thread *t, int (*fn) (void *),
+			 void *arg, size_t stack_size)
+{
+  int prot = PROT_READ | PROT_WRITE;
+  if (GL(dl_stack_flags) & PF_X)
+    prot |= PROT_EXEC;
+  void *stack = __mmap (NULL, stack_size, prot,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+  if (stack == MAP_FAILED)
+    return false;
+
+  t->stack = stack;
+  t->stack_size = stack_size;
+#if _STACK_GROWS_DOWN
+  void *stack_start = (char *) stack + stack_size;
+#else
+  void *stack_start = stack;
+#endif
+  /* CLONE_PARENT_SETTID stores the thread ID before the thread can
+     terminate and clear it again.  */
+  const int flags = (CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND
+		     | CLONE_THREAD | CLONE_SYSVSEM | CLONE_PARENT_SETTID
+		     | CLONE_CHILD_CLEARTID);
+  if (__clone (fn, stack_start, flags, arg, &t->tid, NULL, &t->tid) == -1)
+    {
+      __munmap (stack, stack_size);
+      return false;
+    }
+  return true;
+}
+
+static inline void
+_dl_helper_thread_join (struct dl_helper_thread *t)
+{
+  pid_t tid;
+  /* The kernel wakes the futex after clearing the thread ID.  */
+  while ((tid = atomic_load_acquire (&t->tid)) != 0)
+    lll_futex_wait (&t->tid, tid, LLL_SHARED);
+  __munmap (t->stack, t->stack_size);
+}
+
+static inline int
+_dl_helper_thread_self (void)
+{
+  INTERNAL_SYSCALL_DECL (err);
+  return INTERNAL_SYSCALL (gettid, err, 0);
+}
+
+static inline void
+_dl_helper_thread_wait (unsigned int *addr, unsigned int val)
+{
+  lll_futex_wait (addr, val, LLL_PRIVATE);
+}
+
+static inline void
+_dl_helper_thread_wake_all (unsigned int *addr)
+{
+  lll_futex_wake (addr, INT_MAX, LLL_PRIVATE);
+}
+
+#endif  /* dl-helper-thread.h */
@@ -17,7 +17,13 @@
    <http://www.gnu.org/licenses/>.  */
 
 #include <fcntl.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/param.h>
 #include <not-cancel.h>
+#include <sysdep.h>
 
 /* The Linux kernel overcommits address space by default and if there is not
    enough memory available, it uses various parameters to decide the process to
@@ -56,4 +62,213 @@ check_may_shrink_heap (void)
   return may_shrink_heap;
 }
 
+/* Read at most LEN - 1 bytes from the start of the file PATH into BUF
+   and NUL-terminate the result.  Return the number of bytes read, or 0
+   if the file could not be read.  */
+static inline size_t
+malloc_read_sysfile (const char *path, char *buf, size_t len)
+{
+  int fd = __open_nocancel (path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return 0;
+  ssize_t n = __read_nocancel (fd, buf, len - 1);
+  __close_nocancel_nostatus (fd);
+  if (n <= 0)
+    return 0;
+  buf[n] = '\0';
+  return n;
+}
+
+/* Parse the decimal number at the start of S (after leading blanks).  */
+static inline size_t
+malloc_parse_size (const char *s)
+{
+  size_t r = 0;
+  while (*s == ' ' || *s == '\t')
+    s++;
+  for (; *s >= '0' && *s <= '9'; s++)
+    r = r * 10 + (*s - '0');
+  return r;
+}
+
+/* Return the size of a transparent huge page if the kernel has THP
+   support configured in "madvise" mode, and 0 otherwise.  In "always"
+   mode the kernel already backs suitable regions with huge pages
+   without any help from malloc, and in "never" mode an madvise call
+   would be wasted.  */
+static inline size_t
+malloc_thp_pagesize (void)
+{
+  char buf[64];
+
+  if (malloc_read_sysfile ("/sys/kernel/mm/transparent_hugepage/enabled",
+			   buf, sizeof (buf)) == 0
+      || strstr (buf, "[madvise]") == NULL)
+    return 0;
+
+  if (malloc_read_sysfile
+      ("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size",
+       buf, sizeof (buf)) == 0)
+    return 0;
+
+  return malloc_parse_size (buf);
+}
+
+/* Return the default huge page size of the hugetlbfs pool, as reported
+   by the "Hugepagesize:" line of /proc/meminfo, or 0 if unknown.  */
+static inline size_t
+malloc_default_hugetlb_pagesize (void)
+{
+  static const char key[] = "Hugepagesize:";
+  int fd = __open_nocancel ("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return 0;
+
+  /* The line might straddle two reads, so keep track of how much of
+     the key has been matched at the start of the current line and
+     keep the number in VAL once the key is found.  */
+  char buf[512];
+  size_t matched = 0;
+  bool at_line_start = true;
+  bool in_value = false;
+  size_t val = 0;
+  ssize_t n;
+  while (!in_value || val == 0)
+    {
+      n = __read_nocancel (fd, buf, sizeof (buf));
+      if (n <= 0)
+	break;
+      for (ssize_t i = 0; i < n; i++)
+	{
+	  char c = buf[i];
+	  if (in_value)
+	    {
+	      if (c >= '0' && c <= '9')
+		val = val * 10 + (c - '0');
+	      else if (c != ' ' || val != 0)
+		goto out;
+	    }
+	  else if (at_line_start && c == key[matched])
+	    {
+	      if (++matched == sizeof (key) - 1)
+		in_value = true;
+	    }
+	  else
+	    {
+	      at_line_start = c == '\n';
+	      matched = 0;
+	    }
+	}
+    }
+ out:
+  __close_nocancel_nostatus (fd);
+
+  /* The value is reported in kB.  */
+  return val * 1024;
+}
+
+/* Compute the page size and the mmap flags to use for allocations
+   backed by hugetlbfs.  If REQUESTED is 0 the default huge page size
+   of the system is used, otherwise REQUESTED must be a power of two
+   that the kernel supports as a huge page size.  On failure *PAGESIZE
+   and *FLAGS are left unchanged.  */
+static inline void
+malloc_hugepage_config (size_t requested, size_t *pagesize, int *flags)
+{
+#ifdef MAP_HUGETLB
+  size_t def = malloc_default_hugetlb_pagesize ();
+  if (def == 0)
+    return;
+
+  if (requested == 0 || requested == def)
+    {
+      *pagesize = def;
+      *flags = MAP_HUGETLB;
+      return;
+    }
+
+  if (!powerof2 (requested) || requested < 1024)
+    return;
+
+  /* A non-default size must be selected explicitly in the flags.  The
+     kernel only accepts sizes for which a pool directory exists.  */
+  char path[80] = "/sys/kernel/mm/hugepages/hugepages-";
+  char digits[24];
+  char *d = digits + sizeof (digits);
+  for (size_t kb = requested / 1024; kb != 0; kb /= 10)
+    *--d = '0' + kb % 10;
+  char *p = path + strlen (path);
+  p = __mempcpy (p, d, digits + sizeof (digits) - d);
+  strcpy (p, "kB/nr_hugepages");
+  char buf[32];
+  if (malloc_read_sysfile (path, buf, sizeof (buf)) == 0)
+    return;
+
+  *pagesize = requested;
+  *flags = MAP_HUGETLB | (__builtin_ctzll (requested) << MAP_HUGE_SHIFT);
+#endif
+}
+
+/* Return the number of the CPU the calling thread is running on, or -1
+   if it cannot be determined.  If NODE is not NULL, store the NUMA node
+   of that CPU in *NODE.  */
+static inline int
+malloc_getcpu (int *node)
+{
+  unsigned int cpu, n;
+  if (__getcpu (&cpu, &n) != 0)
+    return -1;
+  if (node != NULL)
+    *node = n;
+  return cpu;
+}
+
+/* Return the number of NUMA nodes the system can have, or 0 if
+   unknown.  */
+static inline int
+malloc_numa_nodes (void)
+{
+  char buf[128];
+  size_t n = malloc_read_sysfile ("/sys/devices/system/node/possible",
+				  buf, sizeof (buf));
+  if (n == 0)
+    return 0;
+
+  /* The file contains a list of ranges such as "0-3" or "0,2", which
+     ends with the highest node number.  */
+  while (n > 0 && (buf[n - 1] < '0' || buf[n - 1] > '9'))
+    n--;
+  if (n == 0)
+    return 0;
+  while (n > 0 && buf[n - 1] >= '0' && buf[n - 1] <= '9')
+    n--;
+  return malloc_parse_size (buf + n) + 1;
+}
+
+/* Maximum node number malloc_bind_node supports.  */
+#define MALLOC_MAX_NODES 1024
+
+/* Set the memory policy of the LEN bytes at ADDR so that their pages
+   are taken from node NODE if possible.  A preferred rather than a
+   strict policy is used, so that allocations do not fail when the node
+   runs out of memory.  Errors are ignored.  */
+static inline void
+malloc_bind_node (void *addr, size_t len, int node)
+{
+#ifdef __NR_mbind
+  enum { mpol_preferred = 1 };
+  unsigned long int mask[MALLOC_MAX_NODES / (8 * sizeof (long int))]
+    = { 0, };
+  if (node < 0 || node >= MALLOC_MAX_NODES)
+    return;
+  mask[node / (8 * sizeof (long int))]
+    = 1UL << (node % (8 * sizeof (long int)));
+
+  /* The kernel expects the number of bits in MASK plus one.  */
+  INTERNAL_SYSCALL_DECL (err);
+  (void) INTERNAL_SYSCALL_CALL (mbind, err, addr, len, mpol_preferred,
+				mask, MALLOC_MAX_NODES + 1, 0);
+#endif
+}
+
 #define HAVE_MREMAP 1
@@ -0,0 +1,31 @@
+/* Restartable Sequences registration data.  Linux version.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include <stddef.h>
+
+/* Do not include <sys/rseq.h>, which declares the public names as
+   const; they are only written by rseq_register_main_thread.  */
+
+ptrdiff_t __rseq_offset_internal attribute_hidden;
+unsigned int __rseq_size_internal attribute_hidden;
+
+strong_alias (__rseq_offset_internal, __rseq_offset)
+strong_alias (__rseq_size_internal, __rseq_size)
+
+/* No flags are used for the registration.  */
+const unsigned int __rseq_flags;
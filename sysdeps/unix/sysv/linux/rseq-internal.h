@@ -0,0 +1,122 @@
+/* Restartable Sequences internal API.  Linux implementation.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#ifndef RSEQ_INTERNAL_H
+#define RSEQ_INTERNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sysdep.h>
+#include <tls.h>
+#include <sys/rseq.h>
+
+/* Each thread registers the rseq_area member of its struct pthread
+   with the kernel, which keeps the cpu_id field up to date and
+   restarts the critical section described by the rseq_cs field when
+   the thread is preempted or migrated.  The initial thread is
+   registered when libc is initialized, unless the glibc.pthread.rseq
+   tunable is 0.  Other threads are registered in start_thread if the
+   initial thread was.  __rseq_size is 0 if the initial thread is not
+   registered, and the cpu_id field of a thread whose registration
+   failed is RSEQ_CPU_ID_REGISTRATION_FAILED.  */
+
+/* Size of the original struct rseq.  The kernel rejects registrations
+   of smaller areas.  */
+#define RSEQ_AREA_SIZE 32
+
+_Static_assert (sizeof (((struct pthread *) 0)->rseq_area) == RSEQ_AREA_SIZE,
+		"rseq_area does not match the original struct rseq");
+
+#if TLS_TCB_AT_TP
+/* The thread pointer points to the thread descriptor.  */
+# define RSEQ_THREAD_POINTER(self) ((char *) (self))
+#else
+/* The thread pointer points TLS_TCB_OFFSET bytes past the TCB, which
+   follows the thread descriptor.  */
+# ifdef TLS_TCB_OFFSET
+#  define RSEQ_TCB_OFFSET TLS_TCB_OFFSET
+# else
+#  define RSEQ_TCB_OFFSET 0
+# endif
+# define RSEQ_THREAD_POINTER(self) \
+  ((char *) (self) + TLS_PRE_TCB_SIZE + RSEQ_TCB_OFFSET)
+#endif
+
+/* Register the rseq area of SELF, which must be the calling thread.
+   Return true on success.  */
+static inline bool
+rseq_register_current_thread (struct pthread *self)
+{
+  self->rseq_area.cpu_id_start = 0;
+  self->rseq_area.cpu_id = RSEQ_CPU_ID_UNINITIALIZED;
+  self->rseq_area.rseq_cs = 0;
+  self->rseq_area.flags = 0;
+#if defined RSEQ_SIG && defined __NR_rseq
+  INTERNAL_SYSCALL_DECL (err);
+  int ret = INTERNAL_SYSCALL_CALL (rseq, err, &self->rseq_area,
+				   RSEQ_AREA_SIZE, 0, RSEQ_SIG);
+  if (!INTERNAL_SYSCALL_ERROR_P (ret, err))
+    return true;
+#endif
+  self->rseq_area.cpu_id = RSEQ_CPU_ID_REGISTRATION_FAILED;
+  return false;
+}
+
+#if IS_IN (libc)
+# if HAVE_TUNABLES
+#  include <elf/dl-tunables.h>
+# endif
+
+/* Internal aliases of __rseq_offset and __rseq_size, which are written
+   only by rseq_register_main_thread.  */
+extern ptrdiff_t __rseq_offset_internal attribute_hidden;
+extern unsigned int __rseq_size_internal attribute_hidden;
+
+/* Return true if the calling thread can use its rseq area.  */
+static inline bool
+rseq_available (void)
+{
+  return (__rseq_size_internal != 0
+	  && (int) THREAD_GETMEM (THREAD_SELF, rseq_area.cpu_id) >= 0);
+}
+
+/* Register the rseq area of the initial thread and publish its
+   location.  */
+static inline void
+rseq_register_main_thread (void)
+{
+  struct pthread *self = THREAD_SELF;
+
+# if HAVE_TUNABLES
+  if (TUNABLE_GET_FULL (glibc, pthread, rseq, int32_t, NULL) == 0)
+    {
+      self->rseq_area.cpu_id = RSEQ_CPU_ID_REGISTRATION_FAILED;
+      return;
+    }
+# endif
+
+  if (rseq_register_current_thread (self))
+    {
+      __rseq_offset_internal = ((char *) &self->rseq_area
+				- RSEQ_THREAD_POINTER (self));
+      __rseq_size_internal = RSEQ_AREA_SIZE;
+    }
+}
+#endif /* IS_IN (libc) */
+
+#endif /* rseq-internal.h */
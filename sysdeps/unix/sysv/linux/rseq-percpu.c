@@ -0,0 +1,51 @@
+/* Per-CPU operations using restartable sequences.  Stub version.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include <stddef.h>
+#include <sys/rseq.h>
+
+/* The critical sections need to be written in assembler, so the
+   functions always fail unless the architecture provides them.  */
+
+int
+rseq_percpu_add (void *base, size_t stride, intptr_t value)
+{
+  return -1;
+}
+
+int
+rseq_percpu_cmpxchg (void *base, size_t stride, int cpu,
+		     intptr_t expected, intptr_t desired)
+{
+  return -1;
+}
+
+void *
+rseq_percpu_pop (void *base, size_t stride, size_t next_offset, int *cpu)
+{
+  if (cpu != NULL)
+    *cpu = -1;
+  return NULL;
+}
+
+int
+rseq_percpu_push (void *base, size_t stride, size_t next_offset,
+		  void *node)
+{
+  return -1;
+}
@@ -18,6 +18,7 @@
 #include <errno.h>
 #include <sched.h>
 #include <sysdep.h>
+#include <rseq-internal.h>
 
 #ifdef HAVE_GETCPU_VSYSCALL
 # define HAVE_VSYSCALL
@@ -27,6 +28,10 @@
 int
 sched_getcpu (void)
 {
+  /* The kernel keeps the CPU number in the rseq area up to date.  */
+  if (rseq_available ())
+    return THREAD_GETMEM (THREAD_SELF, rseq_area.cpu_id);
+
 #ifdef __NR_getcpu
   unsigned int cpu;
   int r = INLINE_VSYSCALL (getcpu, 3, &cpu, NULL, NULL);
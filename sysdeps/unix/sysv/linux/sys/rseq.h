@@ -0,0 +1,199 @@
+/* Restartable Sequences exported symbols.  Linux header.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#ifndef _SYS_RSEQ_H
+#define _SYS_RSEQ_H	1
+
+/* Architecture-specific rseq signature.  */
+#include <bits/rseq.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+#ifdef __has_include
+# if __has_include ("linux/rseq.h")
+#  define __GLIBC_HAVE_KERNEL_RSEQ
+# endif
+#else
+# include <linux/version.h>
+# if LINUX_VERSION_CODE >= KERNEL_VERSION (4, 18, 0)
+#  define __GLIBC_HAVE_KERNEL_RSEQ
+# endif
+#endif
+
+#ifdef __GLIBC_HAVE_KERNEL_RSEQ
+/* We use the structures declarations from the kernel headers.  */
+# include <linux/rseq.h>
+#else
+/* We use a copy of the include/uapi/linux/rseq.h kernel header.  */
+
+enum rseq_cpu_id_state
+  {
+    RSEQ_CPU_ID_UNINITIALIZED = -1,
+    RSEQ_CPU_ID_REGISTRATION_FAILED = -2,
+  };
+
+enum rseq_flags
+  {
+    RSEQ_FLAG_UNREGISTER = (1 << 0),
+  };
+
+enum rseq_cs_flags_bit
+  {
+    RSEQ_CS_FLAG_NO_RESTART_ON_PREEMPT_BIT = 0,
+    RSEQ_CS_FLAG_NO_RESTART_ON_SIGNAL_BIT = 1,
+    RSEQ_CS_FLAG_NO_RESTART_ON_MIGRATE_BIT = 2,
+  };
+
+enum rseq_cs_flags
+  {
+    RSEQ_CS_FLAG_NO_RESTART_ON_PREEMPT =
+      (1U << RSEQ_CS_FLAG_NO_RESTART_ON_PREEMPT_BIT),
+    RSEQ_CS_FLAG_NO_RESTART_ON_SIGNAL =
+      (1U << RSEQ_CS_FLAG_NO_RESTART_ON_SIGNAL_BIT),
+    RSEQ_CS_FLAG_NO_RESTART_ON_MIGRATE =
+      (1U << RSEQ_CS_FLAG_NO_RESTART_ON_MIGRATE_BIT),
+  };
+
+/* struct rseq_cs is aligned on 32 bytes to ensure it is always
+   contained within a single cache-line.  It is usually declared as
+   link-time constant data.  */
+struct rseq_cs
+  {
+    /* Version of this structure.  */
+    uint32_t version;
+    /* enum rseq_cs_flags.  */
+    uint32_t flags;
+    uint64_t start_ip;
+    /* Offset from start_ip.  */
+    uint64_t post_commit_offset;
+    uint64_t abort_ip;
+  } __attribute__ ((__aligned__ (32)));
+
+/* struct rseq is aligned on 32 bytes to ensure it is always
+   contained within a single cache-line.
+
+   A single struct rseq per thread is allowed.  */
+struct rseq
+  {
+    /* Restartable sequences cpu_id_start field.  Updated by the
+       kernel.  Read by user-space with single-copy atomicity
+       semantics.  This field should only be read by the thread which
+       registered this data structure.  Aligned on 32-bit.  Always
+       contains a value in the range of possible CPUs, although the
+       value may not be the actual current CPU (e.g. if rseq is not
+       initialized).  This CPU number value should always be compared
+       against the value of the cpu_id field before performing a rseq
+       commit or returning a value read from a data structure indexed
+       using the cpu_id_start value.  */
+    uint32_t cpu_id_start;
+    /* Restartable sequences cpu_id field.  Updated by the kernel.
+       Read by user-space with single-copy atomicity semantics.  This
+       field should only be read by the thread which registered this
+       data structure.  Aligned on 32-bit.  Values
+       RSEQ_CPU_ID_UNINITIALIZED and RSEQ_CPU_ID_REGISTRATION_FAILED
+       have a special semantic: the former means "rseq uninitialized",
+       and latter means "rseq initialization failed".  This value is
+       meant to be read within rseq critical sections and compared
+       with the cpu_id_start value previously read, before performing
+       the commit instruction, or read and compared with the cpu number
+       of per-CPU data structures.  */
+    uint32_t cpu_id;
+    /* Restartable sequences rseq_cs field.
+
+       Contains NULL when no critical section is active for the current
+       thread, or holds a pointer to the currently active struct rseq_cs.
+
+       Updated by user-space, which sets the address of the currently
+       active rseq_cs at the beginning of assembly instruction sequence
+       block, and set to NULL by the kernel when it restarts an assembly
+       instruction sequence block, as well as when the kernel detects
+       that it is preempting or delivering a signal outside of the range
+       targeted by the rseq_cs.  Also needs to be set to NULL by
+       user-space before reclaiming memory that contains the targeted
+       struct rseq_cs.
+
+       Read and set by the kernel.  Set by user-space with single-copy
+       atomicity semantics.  This field should only be updated by the
+       thread which registered this data structure.  Aligned on
+       64-bit.  32-bit architectures zero-extend the pointer.  */
+    uint64_t rseq_cs;
+    /* Restartable sequences flags field.
+
+       This field should only be updated by the thread which registered
+       this data structure.  Read by the kernel.  Mainly used for
+       single-stepping through rseq critical sections with debuggers.  */
+    uint32_t flags;
+  } __attribute__ ((__aligned__ (32)));
+
+#endif /* __GLIBC_HAVE_KERNEL_RSEQ */
+
+__BEGIN_DECLS
+
+/* Offset from the thread pointer to the rseq area of the thread.  */
+extern const ptrdiff_t __rseq_offset;
+
+/* Size of the registered rseq area.  0 if the registration was
+   unsuccessful or has been disabled with the glibc.pthread.rseq
+   tunable.  */
+extern const unsigned int __rseq_size;
+
+/* Flags used during rseq registration.  */
+extern const unsigned int __rseq_flags;
+
+/* The following functions operate on per-CPU data.  The data for CPU
+   number N is at BASE + N * STRIDE.  Each function is a restartable
+   sequence which either completes on the CPU it started on without
+   interruption, or is restarted; no atomic instructions are used.  All
+   of them fail if the calling thread has no registered rseq area.  */
+
+/* Add VALUE to the intptr_t for the current CPU.  Return the number of
+   that CPU, or -1 on failure.  */
+extern int rseq_percpu_add (void *__base, size_t __stride,
+			    intptr_t __value) __THROW __nonnull ((1));
+
+/* If the calling thread runs on CPU and the intptr_t for CPU is equal
+   to EXPECTED, replace it with DESIRED and return 0.  Return 1 if the
+   intptr_t is not equal to EXPECTED.  Return -1 if the calling thread
+   does not run on CPU, or on failure.  */
+extern int rseq_percpu_cmpxchg (void *__base, size_t __stride, int __cpu,
+				intptr_t __expected, intptr_t __desired)
+     __THROW __nonnull ((1));
+
+/* For the following two functions, the data for each CPU is the head
+   of a singly-linked list, and each list element stores the pointer to
+   the next element NEXT_OFFSET bytes from its beginning.  */
+
+/* Remove the first element from the list for the current CPU and
+   return it, or return NULL if the list is empty.  If CPU is not NULL,
+   store the number of the CPU in *CPU, or -1 on failure.  On failure,
+   NULL is returned.  */
+extern void *rseq_percpu_pop (void *__base, size_t __stride,
+			      size_t __next_offset, int *__cpu)
+     __THROW __nonnull ((1));
+
+/* Add NODE to the beginning of the list for the current CPU.  Return
+   the number of that CPU, or -1 on failure.  */
+extern int rseq_percpu_push (void *__base, size_t __stride,
+			     size_t __next_offset, void *__node)
+     __THROW __nonnull ((1, 4));
+
+__END_DECLS
+
+#endif /* sys/rseq.h */
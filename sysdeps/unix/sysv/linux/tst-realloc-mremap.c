@@ -0,0 +1,87 @@
+/* Test that realloc moves large growing blocks to mremap.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* Grow a block which starts out in the heap beyond
+   glibc.malloc.realloc_mmap_threshold, which is set to 1 MiB.  The
+   block is followed by another one, so it cannot grow in place.  It
+   must move to a mapping of its own once, and then be grown by mremap,
+   keeping its contents throughout.  */
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <support/check.h>
+
+static unsigned char
+pattern (size_t i)
+{
+  return (i * 7) ^ (i >> 9);
+}
+
+static void
+fill (unsigned char *p, size_t from, size_t to)
+{
+  for (size_t i = from; i < to; ++i)
+    p[i] = pattern (i);
+}
+
+static void
+check (const unsigned char *p, size_t size)
+{
+  for (size_t i = 0; i < size; ++i)
+    if (p[i] != pattern (i))
+      FAIL_EXIT1 ("byte %zu of %zu changed", i, size);
+}
+
+static int
+do_test (void)
+{
+  size_t size = 64 * 1024;
+  unsigned char *p = malloc (size);
+  TEST_VERIFY_EXIT (p != NULL);
+  void *guard = malloc (1000);
+  TEST_VERIFY_EXIT (guard != NULL);
+  fill (p, 0, size);
+
+  struct malloc_global_stats before, after;
+  TEST_COMPARE (malloc_global_stats (&before), 0);
+
+  while (size < 32 * 1024 * 1024)
+    {
+      size_t new_size = size + size / 4 + 1000;
+      p = realloc (p, new_size);
+      TEST_VERIFY_EXIT (p != NULL);
+      check (p, size);
+      fill (p, size, new_size);
+      size = new_size;
+    }
+
+  TEST_COMPARE (malloc_global_stats (&after), 0);
+  TEST_VERIFY (after.mmap_count > before.mmap_count);
+  TEST_VERIFY (after.mremap_count > before.mremap_count);
+
+  /* Shrinking keeps the contents, too.  */
+  p = realloc (p, 5000);
+  TEST_VERIFY_EXIT (p != NULL);
+  check (p, 5000);
+  free (p);
+  free (guard);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,207 @@
+/* Test rseq registration and the rseq_percpu_* functions.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+/* If the initial thread has registered an rseq area, every thread must
+   find the CPU number in it, and the per-CPU operations must not lose
+   updates when threads are preempted or migrated in the middle of
+   them.  */
+
+#include <errno.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/rseq.h>
+#include <rseq-internal.h>
+#include <support/check.h>
+#include <support/xthread.h>
+
+enum { threads = 8, iterations = 20000, max_cpus = 1024 };
+
+/* One cache line per CPU.  */
+#define STRIDE 64
+
+static char counters[max_cpus * STRIDE] __attribute__ ((aligned (STRIDE)));
+static char heads[max_cpus * STRIDE] __attribute__ ((aligned (STRIDE)));
+
+struct node
+{
+  bool popped;
+  struct node *next;
+};
+
+static struct node nodes[threads][iterations];
+static unsigned int popped[threads];
+
+static struct rseq *
+rseq_area (void)
+{
+  struct pthread *self = THREAD_SELF;
+  struct rseq *area = (struct rseq *) (RSEQ_THREAD_POINTER (self)
+				       + __rseq_offset);
+  TEST_VERIFY ((void *) area == (void *) &self->rseq_area);
+  return area;
+}
+
+/* Return true if the kernel accepts the registration of an rseq area
+   of the original size.  Only called if glibc has not registered the
+   area of the initial thread.  */
+static bool
+kernel_supports_rseq (void)
+{
+#if defined RSEQ_SIG && defined __NR_rseq
+  static struct rseq area __attribute__ ((aligned (32)));
+  if (syscall (__NR_rseq, &area, RSEQ_AREA_SIZE, 0, RSEQ_SIG) != 0)
+    {
+      if (errno != ENOSYS)
+	printf ("warning: rseq registration failed: %m\n");
+      return false;
+    }
+  TEST_COMPARE (syscall (__NR_rseq, &area, RSEQ_AREA_SIZE,
+			 RSEQ_FLAG_UNREGISTER, RSEQ_SIG), 0);
+  return true;
+#else
+  return false;
+#endif
+}
+
+/* Return true if registration has been disabled with the
+   glibc.pthread.rseq tunable.  */
+static bool
+rseq_disabled (void)
+{
+  const char *tunables = getenv ("GLIBC_TUNABLES");
+  return tunables != NULL && strstr (tunables, "glibc.pthread.rseq=0");
+}
+
+static void *
+thread_func (void *closure)
+{
+  int id = (uintptr_t) closure;
+
+  TEST_VERIFY ((int) rseq_area ()->cpu_id >= 0);
+  TEST_VERIFY (sched_getcpu () >= 0);
+  /* The CPU number matches the one the getcpu system call returns,
+     unless the thread is migrated between the two reads.  */
+  bool match = false;
+  for (int i = 0; i < 100 && !match; ++i)
+    {
+      unsigned int cpu;
+      TEST_COMPARE (syscall (__NR_getcpu, &cpu, NULL, NULL), 0);
+      match = rseq_area ()->cpu_id == cpu;
+    }
+  TEST_VERIFY (match);
+  for (int i = 0; i < iterations; ++i)
+    {
+      int cpu = rseq_percpu_add (counters, STRIDE, 1);
+      TEST_VERIFY (cpu >= 0 && cpu < max_cpus);
+
+      TEST_VERIFY (rseq_percpu_push (heads, STRIDE,
+				     offsetof (struct node, next),
+				     &nodes[id][i]) >= 0);
+      /* The list may be empty if the thread has been migrated since the
+	 push, and the node may belong to another thread.  */
+      struct node *node = rseq_percpu_pop (heads, STRIDE,
+					   offsetof (struct node, next),
+					   &cpu);
+      TEST_VERIFY (cpu >= 0 && cpu < max_cpus);
+      if (node != NULL)
+	{
+	  TEST_VERIFY (!node->popped);
+	  node->popped = true;
+	  ++popped[id];
+	}
+      if (i % 1024 == 0)
+	sched_yield ();
+    }
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  if (__rseq_size == 0)
+    {
+      if (rseq_disabled ())
+	FAIL_UNSUPPORTED ("rseq disabled with glibc.pthread.rseq");
+      if (!kernel_supports_rseq ())
+	FAIL_UNSUPPORTED ("kernel does not support rseq");
+      FAIL_EXIT1 ("rseq supported by the kernel but not registered");
+    }
+  if (rseq_disabled ())
+    FAIL_EXIT1 ("rseq registered although glibc.pthread.rseq is 0");
+  /* The area contains the fields of the original struct rseq.  */
+  TEST_COMPARE (__rseq_size, RSEQ_AREA_SIZE);
+  TEST_VERIFY ((int) rseq_area ()->cpu_id >= 0);
+  if (sysconf (_SC_NPROCESSORS_CONF) > max_cpus)
+    FAIL_UNSUPPORTED ("too many CPUs");
+
+  pthread_t thr[threads];
+  for (int i = 0; i < threads; ++i)
+    thr[i] = xpthread_create (NULL, thread_func, (void *) (uintptr_t) i);
+  for (int i = 0; i < threads; ++i)
+    xpthread_join (thr[i]);
+
+  /* Every node has been popped once or is still on a list.  */
+  intptr_t total = 0;
+  unsigned int count = 0;
+  for (int i = 0; i < threads; ++i)
+    count += popped[i];
+  for (int i = 0; i < max_cpus; ++i)
+    {
+      total += *(intptr_t *) (counters + i * STRIDE);
+      for (struct node *node = *(struct node **) (heads + i * STRIDE);
+	   node != NULL; node = node->next)
+	{
+	  TEST_VERIFY (!node->popped);
+	  ++count;
+	}
+    }
+  TEST_COMPARE (total, threads * iterations);
+  TEST_COMPARE (count, threads * iterations);
+
+  /* Replace the counter of the current CPU.  Retry if the thread is
+     migrated in the meantime.  */
+  int ret;
+  do
+    {
+      int cpu = sched_getcpu ();
+      TEST_VERIFY_EXIT (cpu >= 0 && cpu < max_cpus);
+      intptr_t *counter = (intptr_t *) (counters + cpu * STRIDE);
+      intptr_t old = *counter;
+      ret = rseq_percpu_cmpxchg (counters, STRIDE, cpu, old + 1, -1);
+      if (ret == -1)
+	continue;
+      TEST_COMPARE (ret, 1);
+      TEST_COMPARE (*counter, old);
+      ret = rseq_percpu_cmpxchg (counters, STRIDE, cpu, old, -1);
+      if (ret == 0)
+	TEST_COMPARE (*counter, -1);
+      else
+	TEST_COMPARE (ret, -1);
+    }
+  while (ret != 0);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,195 @@
+/* Per-CPU operations using restartable sequences.  x86-64 version.
+   Copyright (C) 2019 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <http://www.gnu.org/licenses/>.  */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <rseq-internal.h>
+
+/* Each critical section starts at label 1 and ends with the commit
+   instruction just before label 2.  Its struct rseq_cs descriptor at
+   label 3 is emitted into the __rseq_cs section, and its abort handler
+   at label 4 into the __rseq_failure section, preceded by RSEQ_SIG
+   encoded in an undefined instruction as the kernel requires.  The
+   abort handler jumps to the C label ABORT, which retries the
+   operation.  The descriptor is stored to the rseq_cs field of the
+   thread's rseq area before the critical section starts; the kernel
+   clears it after the thread has left the critical section.  Results
+   are stored through pointer operands because asm goto statements
+   cannot have outputs.  */
+
+#define RSEQ_STR_1(x) #x
+#define RSEQ_STR(x) RSEQ_STR_1 (x)
+
+#define RSEQ_CS_BEGIN							\
+  ".pushsection __rseq_cs, \"aw\"\n\t"					\
+  ".balign 32\n"							\
+  "3:\n\t"								\
+  ".long 0, 0\n\t"							\
+  ".quad 1f, 2f - 1f, 4f\n\t"						\
+  ".popsection\n\t"							\
+  ".pushsection __rseq_failure, \"ax\"\n\t"				\
+  ".byte 0x0f, 0xb9, 0x3d\n\t"						\
+  ".long " RSEQ_STR (RSEQ_SIG) "\n"					\
+  "4:\n\t"								\
+  "jmp %l[abort]\n\t"							\
+  ".popsection\n\t"							\
+  "leaq 3b(%%rip), %%rax\n\t"						\
+  "movq %%rax, %%fs:%P[rseq_cs]\n"					\
+  "1:\n\t"
+
+#define RSEQ_CS_END \
+  "2:\n\t"
+
+#define RSEQ_CS_INPUTS							\
+  [rseq_cs] "i" (offsetof (struct pthread, rseq_area.rseq_cs)),		\
+  [cpu_id] "i" (offsetof (struct pthread, rseq_area.cpu_id))
+
+int
+rseq_percpu_add (void *base, size_t stride, intptr_t value)
+{
+  int cpu;
+
+  if (!rseq_available ())
+    return -1;
+
+ retry:
+  asm goto (RSEQ_CS_BEGIN
+	    "movl %%fs:%P[cpu_id], %%eax\n\t"
+	    "movl %%eax, (%[cpup])\n\t"
+	    "imulq %[stride], %%rax\n\t"
+	    "addq %[value], (%[base], %%rax)\n\t"
+	    RSEQ_CS_END
+	    : /* No outputs.  */
+	    : RSEQ_CS_INPUTS, [cpup] "r" (&cpu), [base] "r" (base),
+	      [stride] "r" (stride), [value] "r" (value)
+	    : "memory", "cc", "rax"
+	    : abort);
+  return cpu;
+
+ abort:
+  goto retry;
+}
+
+int
+rseq_percpu_cmpxchg (void *base, size_t stride, int cpu,
+		     intptr_t expected, intptr_t desired)
+{
+  if (cpu < 0 || !rseq_available ())
+    return -1;
+
+  intptr_t *p = (intptr_t *) ((char *) base + (size_t) cpu * stride);
+ retry:
+  asm goto (RSEQ_CS_BEGIN
+	    "cmpl %[cpu], %%fs:%P[cpu_id]\n\t"
+	    "jne %l[migrated]\n\t"
+	    "cmpq %[expected], (%[p])\n\t"
+	    "jne %l[differ]\n\t"
+	    "movq %[desired], (%[p])\n\t"
+	    RSEQ_CS_END
+	    : /* No outputs.  */
+	    : RSEQ_CS_INPUTS, [cpu] "r" (cpu), [p] "r" (p),
+	      [expected] "r" (expected), [desired] "r" (desired)
+	    : "memory", "cc", "rax"
+	    : abort, migrated, differ);
+  return 0;
+
+ differ:
+  return 1;
+
+ migrated:
+  return -1;
+
+ abort:
+  goto retry;
+}
+
+void *
+rseq_percpu_pop (void *base, size_t stride, size_t next_offset, int *cpu)
+{
+  int c;
+  void *node;
+
+  if (!rseq_available ())
+    {
+      c = -1;
+      node = NULL;
+      goto out;
+    }
+
+ retry:
+  asm goto (RSEQ_CS_BEGIN
+	    "movl %%fs:%P[cpu_id], %%eax\n\t"
+	    "movl %%eax, (%[cpup])\n\t"
+	    "imulq %[stride], %%rax\n\t"
+	    "addq %[base], %%rax\n\t"
+	    "movq (%%rax), %%rcx\n\t"
+	    "testq %%rcx, %%rcx\n\t"
+	    "jz %l[empty]\n\t"
+	    "movq (%%rcx, %[next_offset]), %%rdx\n\t"
+	    "movq %%rcx, (%[nodep])\n\t"
+	    "movq %%rdx, (%%rax)\n\t"
+	    RSEQ_CS_END
+	    : /* No outputs.  */
+	    : RSEQ_CS_INPUTS, [cpup] "r" (&c), [nodep] "r" (&node),
+	      [base] "r" (base), [stride] "r" (stride),
+	      [next_offset] "r" (next_offset)
+	    : "memory", "cc", "rax", "rcx", "rdx"
+	    : abort, empty);
+  goto out;
+
+ empty:
+  node = NULL;
+ out:
+  if (cpu != NULL)
+    *cpu = c;
+  return node;
+
+ abort:
+  goto retry;
+}
+
+int
+rseq_percpu_push (void *base, size_t stride, size_t next_offset,
+		  void *node)
+{
+  int cpu;
+
+  if (!rseq_available ())
+    return -1;
+
+ retry:
+  asm goto (RSEQ_CS_BEGIN
+	    "movl %%fs:%P[cpu_id], %%eax\n\t"
+	    "movl %%eax, (%[cpup])\n\t"
+	    "imulq %[stride], %%rax\n\t"
+	    "addq %[base], %%rax\n\t"
+	    "movq (%%rax), %%rcx\n\t"
+	    "movq %%rcx, (%[node], %[next_offset])\n\t"
+	    "movq %[node], (%%rax)\n\t"
+	    RSEQ_CS_END
+	    : /* No outputs.  */
+	    : RSEQ_CS_INPUTS, [cpup] "r" (&cpu), [base] "r" (base),
+	      [stride] "r" (stride), [next_offset] "r" (next_offset),
+	      [node] "r" (node)
+	    : "memory", "cc", "rax", "rcx"
+	    : abort);
+  return cpu;
+
+ abort:
+  goto retry;
+}